@@ -10,6 +10,7 @@
 #include "alerta_manager.h"
 #include "ssd1306.h"
 #include "matriz.h"
+#include "metricas.h"
 
 // Inclusão do header gerado pelo pioasm para a matriz de LEDs
 #include "pio_matrix.pio.h"
@@ -69,7 +70,10 @@ void setup_button() {
 // ==========================================================
 
 /**
- * @brief Tarefa que gerencia a conexão Wi-Fi e o servidor web.
+ * @brief Tarefa que conecta ao Wi-Fi e inicia o servidor web.
+ * Depois disso a rede não precisa de polling: a interrupção do CYW43 acorda a tarefa do
+ * async_context (criada por cyw43_arch_init), que processa os pacotes e chama os
+ * callbacks do servidor. Esta tarefa então se encerra e devolve sua pilha ao heap.
  */
 void vServerTask()
 {
@@ -95,17 +99,7 @@ void vServerTask()
     ssd1306_draw_string(&ssd, "para iniciar...", 0, 40);
     ssd1306_send_data(&ssd);
 
-    // Loop principal da tarefa
-    while (true)
-    {
-        // Chama a função de polling da rede, essencial para manter a conexão Wi-Fi ativa
-        cyw43_arch_poll();
-        // Libera o processador para outras tarefas por 50ms
-        vTaskDelay(pdMS_TO_TICKS(50));
-    }
-
-    // Código de desinicialização (geralmente não é alcançado)
-    cyw43_arch_deinit();
+    vTaskDelete(NULL);
 }
 
 /**
@@ -119,10 +113,15 @@ void vSensorTask()
     // Loop principal da tarefa
     while (true)
     {
-        // Chama a função que lê os dados de todos os sensores
-        ler_sensores();
-        // Libera o processador para outras tarefas por 2000ms (2 segundos)
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        // Dispara as conversões e libera o processador enquanto os sensores medem
+        uint32_t conversao_ms = ler_sensores_iniciar();
+        vTaskDelay(pdMS_TO_TICKS(conversao_ms));
+        // Coleta as leituras e publica a amostra
+        ler_sensores_concluir();
+        // Envia a nova amostra aos clientes inscritos em /stream
+        http_server_publicar();
+        // Libera o processador para outras tarefas até completar o ciclo de 2 s
+        vTaskDelay(pdMS_TO_TICKS(2000 - conversao_ms));
     }
 }
 
@@ -135,8 +134,9 @@ void vAlerta1Task()
     PIO pio = pio0;
     uint sm = pio_init(pio); // Inicializa a máquina de estados do PIO
 
-    // Obtém o ponteiro para a estrutura de dados dos sensores
-    SENSOR_DATA *data = get_sensor_data();
+    // Retrato dos dados dos sensores, copiado a cada passada
+    SENSOR_DATA dados;
+    SENSOR_DATA *data = &dados;
 
     // Loop principal da tarefa
     while (true)
@@ -144,15 +144,18 @@ void vAlerta1Task()
         // Só executa a lógica se o sistema foi ativado pelo botão
         if (connected) 
         {
+            // Alertas e displays usam a mesma cópia: o OLED mostra os valores que dispararam o alerta
+            get_sensor_data(data);
+            uint8_t alertas = calcular_alertas_dados(data);
             // Verifica se algum valor ultrapassou o limite MÁXIMO
-            if (data->temperatura_bmp > data->limite_max_temp || data->pressao_hpa > data->limite_max_press || data->umidade_aht > data->limite_max_umid || data->altitude > data->limite_max_alt) 
+            if (alertas & ALERTA_MASCARA_MAX) 
             {
                 desenhar_alerta_lim_superior(pio, sm); // Desenha padrão de alerta na matriz
                 desenha_display_alerta_sup(&ssd, data);  // Mostra alerta no OLED
                 alerta = true; // Ativa a flag global de alerta
             }
             // Verifica se algum valor ficou abaixo do limite MÍNIMO
-            else if (data->temperatura_bmp < data->limite_min_temp || data->pressao_hpa < data->limite_min_press || data->umidade_aht < data->limite_min_umid || data->altitude < data->limite_min_alt) 
+            else if (alertas & ALERTA_MASCARA_MIN) 
             {
                 desenhar_alerta_lim_inferior(pio, sm); // Desenha padrão de alerta na matriz
                 desenha_display_alerta_inf(&ssd, data);   // Mostra alerta no OLED
@@ -204,6 +207,15 @@ void vAlerta2Task(void *pvParameters) {
     }
 }
 
+/**
+ * @brief Ocupação do heap do FreeRTOS para /metrics (ver metricas.h).
+ */
+void metricas_heap(METRICAS_HEAP *heap) {
+    heap->tamanho = configTOTAL_HEAP_SIZE;
+    heap->livre = xPortGetFreeHeapSize();
+    heap->livre_minimo = xPortGetMinimumEverFreeHeapSize();
+}
+
 // ==========================================================
 // FUNÇÃO PRINCIPAL
 // ==========================================================
@@ -216,6 +228,9 @@ int main()
     // Configura o botão com interrupção
     setup_button();
 
+    // Configuração padrão antes das tarefas: o servidor a usa desde que sobe
+    init_global_manager();
+
     // Cria as quatro tarefas do sistema
     xTaskCreate(vServerTask, "Server Task", 2048, NULL, 1, NULL); // Aumentado stack para a rede
     xTaskCreate(vSensorTask, "Sensor Task", 1024, NULL, 1, NULL);
@@ -0,0 +1,30 @@
+# Converte um arquivo (já comprimido com gzip) em um header C com um array
+# constante, seu tamanho e um ETag derivado do conteúdo.
+#
+# Uso (modo script):
+#   cmake -DINPUT=<arquivo.gz> -DOUTPUT=<header.h> -DSYMBOL=<NOME> -P embed_asset.cmake
+
+if(NOT INPUT OR NOT OUTPUT OR NOT SYMBOL)
+    message(FATAL_ERROR "embed_asset.cmake: INPUT, OUTPUT e SYMBOL são obrigatórios")
+endif()
+
+file(READ ${INPUT} conteudo HEX)
+file(SIZE ${INPUT} tamanho)
+file(MD5 ${INPUT} hash)
+string(SUBSTRING ${hash} 0 16 etag)
+
+# Quebra o dump hexadecimal em bytes "0xNN," com 16 bytes por linha
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${conteudo}")
+string(REPEAT "0x[0-9a-f][0-9a-f]," 16 linha)
+string(REGEX REPLACE "(${linha})" "\\1\n    " bytes "${bytes}")
+
+get_filename_component(origem ${INPUT} NAME)
+file(WRITE ${OUTPUT}
+"// Arquivo gerado pelo CMake (cmake/embed_asset.cmake) a partir de ${origem}. Não editar.\n"
+"#ifndef ${SYMBOL}_H\n"
+"#define ${SYMBOL}_H\n\n"
+"#include <stdint.h>\n\n"
+"#define ${SYMBOL}_LEN ${tamanho}\n"
+"#define ${SYMBOL}_ETAG \"\\\"${etag}\\\"\"\n\n"
+"static const uint8_t ${SYMBOL}[${SYMBOL}_LEN] = {\n    ${bytes}\n};\n\n"
+"#endif\n")
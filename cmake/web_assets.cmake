@@ -0,0 +1,40 @@
+# Arquivos estáticos da interface web: comprimidos com gzip no build e embutidos
+# em flash como arrays constantes (ver cmake/embed_asset.cmake). Usado pelo firmware e
+# pelo teste de carga em tools/carga, que servem exatamente os mesmos bytes.
+
+find_program(GZIP_EXECUTABLE gzip REQUIRED)
+
+set(EMBED_ASSET_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/embed_asset.cmake)
+get_filename_component(WEB_DIR ${CMAKE_CURRENT_LIST_DIR}/../web ABSOLUTE)
+
+function(embed_gzip_asset target input symbol)
+    get_filename_component(nome ${input} NAME)
+    string(TOLOWER ${symbol} header_nome)
+    set(dir ${CMAKE_CURRENT_BINARY_DIR}/assets)
+    set(header ${dir}/${header_nome}.h)
+    add_custom_command(
+        OUTPUT ${header}
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${dir}
+        COMMAND ${CMAKE_COMMAND} -E copy ${input} ${dir}/${nome}
+        COMMAND ${GZIP_EXECUTABLE} -9 -n -f ${dir}/${nome}
+        COMMAND ${CMAKE_COMMAND} -DINPUT=${dir}/${nome}.gz -DOUTPUT=${header} -DSYMBOL=${symbol}
+                -P ${EMBED_ASSET_SCRIPT}
+        DEPENDS ${input} ${EMBED_ASSET_SCRIPT}
+        VERBATIM)
+    target_sources(${target} PRIVATE ${header})
+    target_include_directories(${target} PRIVATE ${dir})
+endfunction()
+
+# Embute a página (INDEX_HTML) e o gráfico (GRAFICO_JS) em target.
+# A página referencia /grafico.js?v=<hash do arquivo>: o script é servido com cache de
+# longa duração e uma nova versão muda a URL. O hash é calculado na configuração, que é
+# refeita quando grafico.js muda.
+function(embed_web_assets target)
+    embed_gzip_asset(${target} ${WEB_DIR}/grafico.js GRAFICO_JS)
+
+    file(MD5 ${WEB_DIR}/grafico.js GRAFICO_JS_VERSAO)
+    string(SUBSTRING ${GRAFICO_JS_VERSAO} 0 16 GRAFICO_JS_VERSAO)
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${WEB_DIR}/grafico.js)
+    configure_file(${WEB_DIR}/index.html ${CMAKE_CURRENT_BINARY_DIR}/web/index.html @ONLY)
+    embed_gzip_asset(${target} ${CMAKE_CURRENT_BINARY_DIR}/web/index.html INDEX_HTML)
+endfunction()
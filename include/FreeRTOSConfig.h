@@ -71,7 +71,16 @@
  /* Memory allocation related definitions. */
  #define configSUPPORT_STATIC_ALLOCATION         0
  #define configSUPPORT_DYNAMIC_ALLOCATION        1
- #define configTOTAL_HEAP_SIZE                   (128*1024)
+ /* O heap guarda só objetos do FreeRTOS: a lwIP tem o seu (MEM_SIZE) e malloc vem da
+  * newlib. Pilhas, em palavras de 4 bytes:
+  *   Server Task 2048, Sensor/Alerta1/Alerta2 1024 cada          20 KB
+  *   tcpip da lwIP (TCPIP_THREAD_STACKSIZE) e async_context do CYW43  8 KB
+  *   timers (configTIMER_TASK_STACK_DEPTH) e idle (mínima)           5 KB
+  * mais ~2 KB de TCBs, filas, mboxes e mutexes: ~35 KB ocupados. Os 29 KB restantes são
+  * folga; /metrics expõe o mínimo livre desde o boot (estacao_heap_livre_minimo_bytes),
+  * que deve ser conferido na placa antes de reduzir este valor. Os 128 KB de antes não
+  * cabem mais na RAM ao lado do pool de pbufs (~74 KB) e dos históricos (~58 KB). */
+ #define configTOTAL_HEAP_SIZE                   (64*1024)
  #define configAPPLICATION_ALLOCATED_HEAP        0
  
  /* Hook function related definitions. */
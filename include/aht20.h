@@ -10,16 +10,35 @@
 #define AHT20_CMD_TRIGGER   0xAC
 #define AHT20_CMD_RESET     0xBA
 
+// Duração de uma medição, do disparo até os dados ficarem disponíveis (datasheet, 5.4)
+#define AHT20_CONVERSAO_MS  80
+
 // Estrutura para armazenar os valores de temperatura e umidade
 typedef struct {
     float temperature;
     float humidity;
 } AHT20_Data;
 
+// Resultado de aht20_coletar
+typedef enum {
+    AHT20_PRONTO,   // Medição lida
+    AHT20_OCUPADO,  // Conversão ainda em andamento: coletar de novo mais tarde
+    AHT20_ERRO      // Falha no barramento ou sensor sem calibração
+} AHT20_Resultado;
+
 // Inicializa o sensor AHT20
 bool aht20_init(i2c_inst_t *i2c);
 
-// Faz a leitura de temperatura e umidade do AHT20
+// Dispara uma medição e retorna sem esperar: o resultado fica pronto em
+// AHT20_CONVERSAO_MS e é lido com aht20_coletar
+bool aht20_disparar(i2c_inst_t *i2c);
+
+// Lê a medição disparada por aht20_disparar. O status vem no mesmo quadro dos dados,
+// então não é preciso consultá-lo antes; data só é preenchido com AHT20_PRONTO.
+AHT20_Resultado aht20_coletar(i2c_inst_t *i2c, AHT20_Data *data);
+
+// Faz a leitura de temperatura e umidade do AHT20: dispara, espera a conversão com
+// sleep_ms e coleta
 bool aht20_read(i2c_inst_t *i2c, AHT20_Data *data);
 
 // Reseta o sensor AHT20
@@ -0,0 +1,31 @@
+#ifndef ALTITUDE_H
+#define ALTITUDE_H
+
+#include <stdint.h>
+
+// Altitude barométrica pela fórmula internacional, h = 44330 * (1 - (p/p0)^0,1903) m,
+// só com aritmética inteira: a razão p/p0 sai de duas divisões de 32 bits (o divisor de
+// hardware do SIO no RP2040) e a potência de uma tabela de 273 pontos em [0,25; 1,3125],
+// com interpolação linear.
+//
+// Erro máximo contra a fórmula em ponto flutuante, para p entre 300 e 1100 hPa e p0
+// entre ALTITUDE_REFERENCIA_MIN_PA e ALTITUDE_REFERENCIA_MAX_PA: 0,14 m, perto de 300 hPa;
+// entre 800 e 1100 hPa, 3 cm (medidos por tools/altimetro).
+
+// Faixa de referência (QNH) aceita pela configuração, em Pa
+#define ALTITUDE_REFERENCIA_MIN_PA    85000
+#define ALTITUDE_REFERENCIA_MAX_PA    110000
+// Atmosfera padrão ao nível do mar
+#define ALTITUDE_REFERENCIA_PADRAO_PA 101325
+
+/**
+ * @brief Altitude da pressão medida em relação à pressão de referência ao nível do mar.
+ * @param pressao_q8 Pressão em Pa, Q24.8 (a saída de bmp280_compensar). Acima de
+ *                   131071 Pa satura.
+ * @param referencia_pa Pressão ao nível do mar (QNH) em Pa, entre 1 e 131071.
+ * @return Altitude em cm. Razões p/p0 fora da tabela saturam nas suas pontas
+ *         (10279,33 m abaixo de 0,25 e -2354,43 m acima de 1,3125).
+ */
+int32_t altitude_cm(uint32_t pressao_q8, uint32_t referencia_pa);
+
+#endif
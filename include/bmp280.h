@@ -45,6 +45,47 @@
 
 #define NUM_CALIB_PARAMS 24
 
+// Perfis de medição (seções 3.3 a 3.8 do datasheet). Nos perfis em modo forçado o
+// sensor dorme entre as amostras e cada conversão é disparada por bmp280_disparar; no
+// modo normal ele converte continuamente e o filtro IIR suaviza as conversões entre
+// duas leituras.
+//
+// Tempos pela fórmula da seção 3.8.1. Resolução da pressão pela tabela de oversampling.
+// Consumo estimado proporcional ao tempo de conversão, a partir dos 2,74 µA a 1 Hz do
+// perfil de menor consumo (~0,5 mA durante a conversão), com uma amostra a cada 2 s:
+//
+//   perfil                  modo     osrs_p/t  IIR  conversão típ/máx  resolução  consumo
+//   ULTRA_BAIXO_CONSUMO     forçado  x1/x1     -     5,5 / 6,4 ms      2,62 Pa    ~1,5 µA
+//   ALTA_RESOLUCAO          forçado  x16/x2    -    37,5 / 43,2 ms     0,16 Pa    ~9,4 µA
+//   ALTA_TAXA (83 Hz)       normal   x4/x1     16   11,5 / 13,3 ms     0,66 Pa    ~480 µA
+//
+// No ALTA_TAXA o filtro (coeficiente 16, 22 conversões para 75% de um degrau) responde
+// em ~0,26 s e cada leitura resume as ~165 conversões desde a anterior, com ruído bem
+// menor que o de uma conversão isolada, ao custo do consumo contínuo.
+typedef enum {
+    BMP280_PERFIL_ULTRA_BAIXO_CONSUMO,
+    BMP280_PERFIL_ALTA_RESOLUCAO,
+    BMP280_PERFIL_ALTA_TAXA,
+    BMP280_N_PERFIS
+} bmp280_perfil_t;
+
+#define BMP280_PERFIL_PADRAO BMP280_PERFIL_ALTA_RESOLUCAO
+
+// Variante do cálculo da pressão na compensação (seção 8.2 do datasheet). A de 32 bits
+// arredonda para o Pa inteiro (até ~6 Pa de erro), mais grosso que a resolução dos perfis
+// com oversampling; a de 64 bits mantém 1/256 Pa (erro < 0,5 Pa), mas no M0+ as operações
+// de 64 bits viram chamadas da biblioteca. tools/compensacao mede as duas na placa.
+typedef enum {
+    BMP280_PRESSAO_32BITS,
+    BMP280_PRESSAO_64BITS
+} bmp280_precisao_t;
+
+// Leitura compensada
+typedef struct {
+    int32_t temperatura;    // 0,01 °C
+    uint32_t pressao_q8;    // Pa em Q24.8 (1/256 Pa); múltiplo de 256 na variante de 32 bits
+} bmp280_compensado_t;
+
 struct bmp280_calib_param {
     uint16_t dig_t1;
     int16_t dig_t2;
@@ -62,9 +103,24 @@ struct bmp280_calib_param {
 };
 
 //void bmp280_init(void);
+// Configura o perfil BMP280_PERFIL_PADRAO
 void bmp280_init(i2c_inst_t *i2c);
-void bmp280_read_raw(i2c_inst_t *i2c, int32_t* temp, int32_t* pressure);
+// Troca o perfil de medição. Retorna false se a escrita I2C falhou.
+bool bmp280_configurar(i2c_inst_t *i2c, bmp280_perfil_t perfil);
+// Dispara uma conversão nos perfis em modo forçado (no modo normal não faz nada); o
+// resultado pode ser lido depois de bmp280_tempo_conversao_ms(perfil)
+bool bmp280_disparar(i2c_inst_t *i2c, bmp280_perfil_t perfil);
+// Tempo máximo, em ms, de uma conversão disparada por bmp280_disparar (0 no modo normal,
+// em que sempre há uma conversão recente nos registradores)
+uint32_t bmp280_tempo_conversao_ms(bmp280_perfil_t perfil);
+// Retorna false se a transferência I2C falhou (temp e pressure ficam inalterados)
+bool bmp280_read_raw(i2c_inst_t *i2c, int32_t* temp, int32_t* pressure);
 void bmp280_reset(i2c_inst_t *i2c);
+// Compensa temperatura e pressão de uma mesma conversão, calculando a temperatura fina
+// (t_fine) uma só vez. Retorna false se a calibração leva a uma divisão por zero.
+bool bmp280_compensar(int32_t adc_t, int32_t adc_p, const struct bmp280_calib_param *params,
+                      bmp280_precisao_t precisao, bmp280_compensado_t *saida);
+// Compensações separadas (0,01 °C e Pa, variante de 32 bits), cada uma calculando t_fine
 int32_t bmp280_convert_temp(int32_t temp, struct bmp280_calib_param* params);
 int32_t bmp280_convert_pressure(int32_t pressure, int32_t temp, struct bmp280_calib_param* params);
 void bmp280_get_calib_params(i2c_inst_t *i2c, struct bmp280_calib_param* params);
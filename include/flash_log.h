@@ -0,0 +1,136 @@
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+// Log das leituras numa região reservada da flash, para que o histórico sobreviva a
+// reinícios. A região é escrita em círculo, setor a setor: cada setor é apagado quando
+// a escrita chega nele (descartando os dados mais antigos), então todos os setores se
+// desgastam por igual. As leituras se acumulam em RAM e vão para a flash uma página
+// inteira por vez (FLASH_LOG_REGISTROS_POR_PAGINA leituras, 40 s a cada 2 s).
+//
+//  Página (FLASH_LOG_PAGINA bytes)
+//  off  tipo  campo
+//   0   u32   magic FLASH_LOG_MAGIC
+//   4   u32   seq da página: cresce de 1 em 1 e nunca se repete
+//   8   u16   registros na página
+//  10   u16   boot: reinícios da estação desde a formatação
+//  12   u32   CRC-32 da página inteira, calculado com este campo zerado
+//  16   registros de 12 bytes: u32 tempo (s) + HIST_REGISTRO
+//
+// Uma página gravada pela metade (queda de energia durante a programação) falha no CRC
+// e é ignorada. O tempo é o relógio da estação: segundos desde a formatação, sem contar
+// os períodos com a estação desligada (no boot ele continua do último registro).
+//
+// As funções não são reentrantes: acrescentar e descarregar pertencem a uma só tarefa.
+// A leitura (flash_log_buscar/flash_log_ler) pode rodar em outra, desde que a flash
+// não seja apagada ou programada enquanto ela lê, como acontece no RP2040 com as
+// interrupções desligadas durante a gravação.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "global_manage.h"
+
+#define FLASH_LOG_SETOR                 4096
+#define FLASH_LOG_PAGINA                256
+#define FLASH_LOG_PAGINAS_POR_SETOR     (FLASH_LOG_SETOR / FLASH_LOG_PAGINA)
+// Muda com o formato de HIST_REGISTRO: páginas de outro formato são ignoradas como
+// inválidas e reaproveitadas à medida que a escrita passa por elas
+#define FLASH_LOG_MAGIC                 0x324C4D45u     // "EML2"
+#define FLASH_LOG_REGISTROS_POR_PAGINA  20
+
+// Maior região suportada (tamanho do índice em RAM: 4 bytes por setor)
+#define FLASH_LOG_SETORES_MAX           256
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t n_registros;
+    uint16_t boot;
+    uint32_t crc;
+} FLASH_LOG_CABECALHO;
+
+typedef struct {
+    uint32_t tempo_s;
+    HIST_REGISTRO valores;
+} FLASH_LOG_REGISTRO;
+
+// Acesso à flash. Leituras vão direto pela região mapeada em memória (XIP no RP2040);
+// apagar e programar seguem as regras da NOR: apagar deixa o setor em 0xFF e programar
+// só leva bits de 1 para 0.
+typedef struct {
+    const uint8_t *base;    // Início da região mapeada
+    uint32_t tamanho;       // Bytes da região, múltiplo de FLASH_LOG_SETOR
+    void (*apagar_setor)(uint32_t offset);
+    void (*programar_pagina)(uint32_t offset, const uint8_t *dados);
+} FLASH_LOG_OPS;
+
+// Estado de uma consulta por faixa de tempo
+typedef struct {
+    uint32_t pagina;        // Próxima página a ler (índice na região)
+    uint32_t restantes;     // Páginas que ainda faltam até a posição de escrita da consulta
+    uint32_t seq_max;       // Páginas gravadas depois da consulta começar são ignoradas
+    uint32_t seq_pagina;    // Página atual já validada (0 = nenhuma)
+    uint16_t registro;      // Próximo registro da página atual
+    uint32_t de;
+    uint32_t ate;
+    bool concluido;
+} FLASH_LOG_CURSOR;
+
+// Contadores para diagnóstico e para a simulação em tools/flash_log
+typedef struct {
+    uint32_t paginas_gravadas;      // Desde o boot
+    uint32_t setores_apagados;      // Desde o boot
+    uint32_t paginas_invalidas;     // Encontradas na recuperação (gravações interrompidas)
+    uint32_t ultimo_seq;            // Seq da última página gravada (0 = log vazio)
+    uint16_t boot;
+} FLASH_LOG_STATS;
+
+/**
+ * @brief Região de flash da plataforma: lib/flash_log_pico.c no firmware.
+ * @return NULL se não há região disponível (o log fica desativado).
+ */
+const FLASH_LOG_OPS *flash_log_regiao(void);
+
+/**
+ * @brief Abre o log: percorre a região, reconstrói o índice de tempo e encontra a
+ * posição de escrita, pulando páginas gravadas pela metade. Uma região sem nenhuma
+ * página válida começa vazia.
+ * @param ops Acesso à flash (NULL desativa o log).
+ * @param uptime_s Segundos desde o boot agora; o relógio do log continua do último registro.
+ */
+void flash_log_iniciar(const FLASH_LOG_OPS *ops, uint32_t uptime_s);
+
+/**
+ * @brief Relógio do log (segundos desde a formatação, só com a estação ligada).
+ */
+uint32_t flash_log_agora(uint32_t uptime_s);
+
+/**
+ * @brief Acrescenta uma leitura feita em `uptime_s`. Grava uma página quando o buffer
+ * enche (e apaga o próximo setor quando a página é a primeira dele).
+ */
+void flash_log_acrescentar(uint32_t uptime_s, const HIST_REGISTRO *valores);
+
+/**
+ * @brief Grava na flash as leituras pendentes no buffer, numa página incompleta.
+ */
+void flash_log_descarregar(void);
+
+/**
+ * @brief Prepara a consulta dos registros com tempo em [de, ate], do mais antigo para o
+ * mais recente. A página inicial é achada por busca binária no índice de setores.
+ * Registros ainda no buffer em RAM (até 40 s) não entram.
+ */
+void flash_log_buscar(FLASH_LOG_CURSOR *cursor, uint32_t de, uint32_t ate);
+
+/**
+ * @brief Lê o próximo registro da consulta sem avançar (chamadas repetidas devolvem o
+ * mesmo registro até flash_log_avancar).
+ * @return false quando a consulta terminou.
+ */
+bool flash_log_ler(FLASH_LOG_CURSOR *cursor, FLASH_LOG_REGISTRO *registro);
+
+void flash_log_avancar(FLASH_LOG_CURSOR *cursor);
+
+void flash_log_get_stats(FLASH_LOG_STATS *stats);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef FMT_NUM_H
+#define FMT_NUM_H
+
+#include <stdint.h>
+
+// Formatação de números só com aritmética inteira, no lugar de snprintf("%.Nf") / ("%d").
+// Todas as funções escrevem a partir de p, terminam a string com '\0' e retornam um
+// ponteiro para esse '\0', para que os trechos possam ser encadeados:
+//     char *p = fmt_texto(buf, "T: ");
+//     p = fmt_fixo(p, temperatura, 1);
+//     fmt_texto(p, " C");
+
+// Maior saída de uma chamada de fmt_fixo/fmt_int/fmt_uint, incluindo o '\0'
+#define FMT_NUM_MAX         32
+#define FMT_CASAS_MAX       6
+
+/**
+ * @brief Escreve v com `casas` casas decimais (0 a FMT_CASAS_MAX).
+ * O resultado é o mesmo de printf("%.*f", casas, v): o valor exato do float é arredondado
+ * para o par mais próximo no empate, e "-0.0" mantém o sinal. NaN e infinito saem como
+ * "nan"/"inf"; valores com módulo a partir de 2^63 saturam.
+ */
+char *fmt_fixo(char *p, float v, uint8_t casas);
+
+char *fmt_int(char *p, int32_t v);
+char *fmt_uint(char *p, uint32_t v);
+
+/**
+ * @brief Copia s (como stpcpy).
+ */
+char *fmt_texto(char *p, const char *s);
+
+#endif
@@ -3,22 +3,34 @@
 
 #include "pico/stdlib.h"
 
-// Estrutura completa para armazenar todos os dados e configurações do sistema.
-typedef struct {
-    
-    // Dados lidos dos sensores
-    float temperatura_bmp;
-    float umidade_aht;
-    float pressao_hpa;
-    float altitude;
+// Número de amostras mantidas no histórico (anel em global_manage.c). O padrão guarda
+// uma hora de leituras a cada 2 s; pode ser trocado na compilação com -DHIST_LEN=<n>.
+#ifndef HIST_LEN
+#define HIST_LEN 1800
+#endif
+
+// Níveis do histórico agregado (mínimo, média e máximo por intervalo), do mais fino ao
+// mais grosso: intervalos de 1 min por 6 h, de 15 min por 3 dias e de 1 h por 30 dias
+#define AGREG_NIVEIS 3
 
-    // Offsets de calibração configurados via web
+// Configuração da estação, ajustada pela interface web. É sempre lida e gravada inteira
+// (get_config/aplicar_config), para que ninguém veja um par min/max pela metade.
+typedef struct {
+    // Offsets de calibração
     float offset_temp;
     float offset_press;
-    float offset_umid; 
+    float offset_umid;
     float offset_alt;
 
-    // [EXPANDIDO] Limites de alerta para todas as propriedades
+    // Pressão ao nível do mar (QNH) usada como referência da altitude, em hPa. Acompanha
+    // o tempo: com a padrão (1013,25 hPa) a altitude varia com o clima.
+    float pressao_nivel_mar;
+
+    // Perfil de medição do BMP280 (BMP280_PERFIL_* de bmp280.h), trocado pela tarefa dos
+    // sensores no início da leitura seguinte
+    int perfil_bmp280;
+
+    // Limites de alerta para todas as propriedades
     int limite_min_temp;
     int limite_max_temp;
     int limite_min_umid;
@@ -27,31 +39,242 @@ typedef struct {
     int limite_max_press;
     int limite_min_alt;
     int limite_max_alt;
+} CONFIG_ESTACAO;
+
+// Maior offset de calibração aceito (em módulo), na unidade da grandeza
+#define CONFIG_OFFSET_MAX 1000.0f
+
+// Sensores, na ordem dos contadores de SENSOR_DATA
+enum {
+    SENSOR_BMP280,
+    SENSOR_AHT20,
+    N_SENSORES
+};
+
+// Retrato do estado da estação, copiado por get_sensor_data. As leituras vêm todas da
+// mesma amostra e a configuração vem inteira, de uma mesma versão.
+typedef struct {
     
-    // Dados históricos para o gráfico da interface web (últimos 20 valores)
-    float hist_temp[20];
-    float hist_umid[20];
-    float hist_press[20];
-    float hist_alt[20];
+    // Dados lidos dos sensores
+    float temperatura_bmp;
+    float umidade_aht;
+    float pressao_hpa;
+    float altitude;
+
+    // Offsets e limites configurados via web. Gravados só por aplicar_config().
+    CONFIG_ESTACAO config;
+    // Incrementada a cada configuração aplicada
+    uint32_t config_versao;
+    
+    // Número de sequência desta amostra (0 = nenhuma amostra ainda). Cresce de 1 em 1 a
+    // cada leitura; as últimas HIST_LEN ficam no histórico (get_amostra).
+    uint32_t seq;
+    // Momento da amostra mais recente, em ms desde o boot
+    uint32_t timestamp_ms;
+    // Leituras de sensor que falharam no barramento I2C (BMP280 ou AHT20)
+    uint32_t erros_i2c;
+    // Por sensor (SENSOR_*): leituras que falharam ou vieram inválidas, e amostras
+    // publicadas com o valor anterior do sensor por não haver leitura nova
+    uint32_t falhas[N_SENSORES];
+    uint32_t desatualizadas[N_SENSORES];
 
 } SENSOR_DATA;
 
+// Uma amostra do histórico identificada pelo seu número de sequência
+typedef struct {
+    uint32_t seq;
+    float temperatura;
+    float umidade;
+    float pressao;
+    float altitude;
+} AMOSTRA;
+
+// Uma leitura no ponto fixo do histórico (8 bytes), a mesma usada pelo log em flash
+typedef struct {
+    int16_t temperatura;    // 0,01 °C
+    uint16_t umidade;       // 0,01 %
+    uint16_t pressao;       // 1/HIST_PRESSAO_ESCALA hPa acima de HIST_PRESSAO_BASE
+    int16_t altitude;       // 1/HIST_ALTITUDE_ESCALA m
+} HIST_REGISTRO;
+
+// Faixas do ponto fixo, para cobrir toda a faixa de medida do BMP280 (300 a 1100 hPa, e
+// até ~9200 m de altitude) com folga para os offsets. Em 16 bits, 0,01 hPa só chegaria a
+// 955 hPa: a pressão vai em passos de 0,02 hPa (300,00 a 1610,70 hPa), abaixo do ruído
+// do sensor, e a altitude em passos de 0,5 m (-16384 a 16383,5 m).
+#define HIST_PRESSAO_BASE       300.0f
+#define HIST_PRESSAO_ESCALA     50.0f
+#define HIST_ALTITUDE_ESCALA    2.0f
+
+// Grandezas medidas, na ordem usada pelos arrays de AGREGADO
+enum {
+    GRANDEZA_TEMP,
+    GRANDEZA_UMID,
+    GRANDEZA_PRESS,
+    GRANDEZA_ALT,
+    N_GRANDEZAS
+};
+
+// Resumo das leituras de um intervalo de um nível do histórico agregado
+typedef struct {
+    uint32_t inicio_s;          // Início do intervalo, em segundos desde o boot
+    uint32_t amostras;          // Leituras agregadas
+    float min[N_GRANDEZAS];
+    float media[N_GRANDEZAS];
+    float max[N_GRANDEZAS];
+} AGREGADO;
+
+// Bits da máscara de alertas retornada por calcular_alertas()
+#define ALERTA_TEMP_MAX   (1u << 0)
+#define ALERTA_TEMP_MIN   (1u << 1)
+#define ALERTA_UMID_MAX   (1u << 2)
+#define ALERTA_UMID_MIN   (1u << 3)
+#define ALERTA_PRESS_MAX  (1u << 4)
+#define ALERTA_PRESS_MIN  (1u << 5)
+#define ALERTA_ALT_MAX    (1u << 6)
+#define ALERTA_ALT_MIN    (1u << 7)
+#define ALERTA_MASCARA_MAX (ALERTA_TEMP_MAX | ALERTA_UMID_MAX | ALERTA_PRESS_MAX | ALERTA_ALT_MAX)
+#define ALERTA_MASCARA_MIN (ALERTA_TEMP_MIN | ALERTA_UMID_MIN | ALERTA_PRESS_MIN | ALERTA_ALT_MIN)
+
+/**
+ * @brief Inicializa os locks, o histórico e a configuração padrão. Chamada uma vez em
+ * main, antes de criar as tarefas (o servidor lê o histórico e lê e grava a configuração
+ * desde que sobe).
+ */
+void init_global_manager(void);
 
 /**
  * @brief Inicializa o hardware (I2C, sensores, pinos de alerta) e o timer para leitura periódica.
- * Deve ser chamada uma vez no início do programa.
+ * Deve ser chamada uma vez no início do programa, depois de init_global_manager.
  */
 void init_sensor_manager(void);
 
 /**
- * @brief Retorna um ponteiro para a estrutura de dados global.
- * Usado pelo servidor web para obter os dados atuais e enviá-los como JSON.
- * @return SENSOR_DATA* Ponteiro para os dados dos sensores.
+ * @brief Copia as leituras mais recentes e a configuração atual.
+ * A cópia é consistente (nunca mistura duas amostras nem duas configurações) e não
+ * bloqueia a tarefa dos sensores; pode ser chamada de qualquer tarefa ou callback da lwIP.
  */
-SENSOR_DATA* get_sensor_data(void);
+void get_sensor_data(SENSOR_DATA *dados);
 
+/**
+ * @brief Primeira fase de uma leitura: dispara as conversões dos sensores e retorna sem
+ * esperar por elas.
+ * @return Tempo, em ms, até os resultados ficarem prontos para ler_sensores_concluir.
+ */
+uint32_t ler_sensores_iniciar(void);
+
+/**
+ * @brief Segunda fase: coleta as conversões disparadas, converte, aplica os offsets e
+ * publica a amostra. Um sensor sem leitura nova mantém o valor anterior, contado em
+ * SENSOR_DATA.desatualizadas; uma conversão que ainda não terminou é coletada no ciclo
+ * seguinte, sem novo disparo.
+ */
+void ler_sensores_concluir(void);
+
+/**
+ * @brief As duas fases, esperando as conversões com sleep_ms (ferramentas no host).
+ */
 void ler_sensores();
 
+/**
+ * @brief Perfil em uso no BMP280. Difere do configurado (CONFIG_ESTACAO.perfil_bmp280)
+ * até a próxima leitura, ou enquanto a escrita da troca no sensor falhar.
+ */
+uint8_t get_perfil_bmp280(void);
+
+/**
+ * @brief Retorna o número de sequência da amostra mais recente (0 se ainda não houve leitura).
+ */
+uint32_t get_ultima_seq(void);
+
+/**
+ * @brief Número de sequência da amostra mais antiga ainda no histórico quando a mais
+ * recente é `ultima`. O histórico é a faixa [hist_primeira_seq(ultima), ultima], vazia
+ * (primeira > ultima) antes da primeira leitura; percorrê-la com get_amostra visita as
+ * amostras da mais antiga para a mais recente.
+ */
+static inline uint32_t hist_primeira_seq(uint32_t ultima) {
+    return ultima >= HIST_LEN ? ultima - HIST_LEN + 1 : 1;
+}
+
+/**
+ * @brief Busca uma amostra do histórico pelo número de sequência, em O(1).
+ * Os valores voltam com a resolução do histórico: 0,01 °C, 0,01 %, 0,01 hPa e 0,1 m.
+ * @param seq Número de sequência desejado.
+ * @param amostra Destino dos valores.
+ * @return false se a amostra ainda não existe ou já saiu do histórico.
+ */
+bool get_amostra(uint32_t seq, AMOSTRA *amostra);
+
+/**
+ * @brief Converte uma leitura em ponto fixo para AMOSTRA, com o número de sequência `seq`.
+ */
+void hist_decodificar(const HIST_REGISTRO *r, uint32_t seq, AMOSTRA *amostra);
+
+/**
+ * @brief Duração de cada intervalo de um nível do histórico agregado, em segundos.
+ */
+uint32_t agreg_periodo_s(uint8_t nivel);
+
+/**
+ * @brief Escolhe o nível mais fino cujo histórico cobre uma janela de `janela_s` segundos
+ * (o mais grosso, se nenhum cobre). Assim o número de intervalos de uma consulta fica
+ * limitado pela capacidade do nível, qualquer que seja a janela.
+ */
+uint8_t agreg_escolher_nivel(uint32_t janela_s);
+
+/**
+ * @brief Faixa de intervalos de `nivel` que cobre os últimos `janela_s` segundos,
+ * limitada ao que o nível guarda. O último é o intervalo em andamento.
+ * @param primeiro,ultimo Números dos intervalos (início = número * agreg_periodo_s(nivel)).
+ */
+void agreg_faixa(uint8_t nivel, uint32_t janela_s, uint32_t *primeiro, uint32_t *ultimo);
+
+/**
+ * @brief Busca um intervalo do histórico agregado; o intervalo em andamento traz as
+ * leituras recebidas até agora.
+ * @return false se o intervalo não tem leituras ou já saiu do histórico.
+ */
+bool get_agregado(uint8_t nivel, uint32_t numero, AGREGADO *agregado);
+
+/**
+ * @brief Segundos desde o boot, a base de tempo do histórico agregado.
+ */
+uint32_t get_tempo_s(void);
+
+/**
+ * @brief Compara os valores atuais com os limites configurados.
+ * @return Máscara com um bit ALERTA_* para cada limite violado (0 = sem alertas).
+ */
+uint8_t calcular_alertas(void);
+
+/**
+ * @brief Como calcular_alertas, sobre um retrato já copiado por get_sensor_data (para que
+ * os alertas correspondam aos valores exibidos junto com eles).
+ */
+uint8_t calcular_alertas_dados(const SENSOR_DATA *dados);
+
+/**
+ * @brief Copia a configuração atual de uma só vez (nunca vê uma atualização pela metade).
+ */
+void get_config(CONFIG_ESTACAO *config);
+
+uint32_t get_config_versao(void);
+
+/**
+ * @brief Valida uma configuração completa: offsets finitos e até CONFIG_OFFSET_MAX,
+ * pressão ao nível do mar na faixa de altitude.h, perfil do BMP280 existente e limite
+ * mínimo menor que o máximo em cada grandeza.
+ * @return NULL se válida; senão o nome do primeiro campo rejeitado.
+ */
+const char *validar_config(const CONFIG_ESTACAO *config);
+
+/**
+ * @brief Substitui toda a configuração num único passo. Pode ser chamada de qualquer
+ * contexto (tarefas ou callbacks da lwIP); não valida (ver validar_config).
+ * @return A nova versão da configuração.
+ */
+uint32_t aplicar_config(const CONFIG_ESTACAO *config);
+
 /**
  * @brief Define o offset de calibração para o sensor de temperatura.
  * @param offset Valor do offset recebido da interface web.
@@ -67,6 +290,12 @@ void set_press_offset(float offset);
 void set_umid_offset(float offset);
 void set_alt_offset(float offset);
 
+/**
+ * @brief Define o perfil de medição do BMP280 (BMP280_PERFIL_* de bmp280.h).
+ * @return false se o perfil não existe.
+ */
+bool set_perfil_bmp280(int perfil);
+
 /**
  * @brief Define os limites mínimo e máximo de temperatura para os alertas.
  * @param min Limite mínimo recebido da interface web.
@@ -0,0 +1,123 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Limites dos campos guardados de uma requisição. Cabeçalhos que o servidor não usa são
+// lidos e descartados byte a byte, então não há limite para o tamanho total do cabeçalho.
+#define HTTP_METODO_MAX     8
+#define HTTP_CAMINHO_MAX    32
+#define HTTP_QUERY_MAX      192
+#define HTTP_VALOR_MAX      48
+#define HTTP_NOME_MAX       24
+#define HTTP_CORPO_MAX      256     // Maior corpo aceito (Content-Length); acima disso: 413
+
+// Cabeçalhos cujo valor é guardado
+typedef enum {
+    HTTP_CAB_CONNECTION,
+    HTTP_CAB_IF_NONE_MATCH,
+    HTTP_CAB_ACCEPT_ENCODING,
+    HTTP_CAB_UPGRADE,
+    HTTP_CAB_WS_KEY,
+    HTTP_CAB_WS_VERSION,
+    HTTP_CAB_CONTENT_LENGTH,
+    HTTP_CAB_TRANSFER_ENCODING,
+    HTTP_CAB_N
+} HTTP_CABECALHO;
+
+typedef enum {
+    HTTP_PARSE_METODO,
+    HTTP_PARSE_CAMINHO,
+    HTTP_PARSE_QUERY,
+    HTTP_PARSE_VERSAO,
+    HTTP_PARSE_CAB_NOME,
+    HTTP_PARSE_CAB_VALOR,
+    HTTP_PARSE_CORPO,       // Lendo os Content-Length bytes do corpo
+    HTTP_PARSE_COMPLETA,    // Requisição inteira lida: os campos abaixo estão prontos
+    HTTP_PARSE_ERRO         // Requisição inválida: ver `erro`
+} HTTP_PARSE_ESTADO;
+
+// Requisição em leitura. Os bytes podem chegar em qualquer fragmentação (segmentos TCP,
+// cadeias de pbufs); o estado é mantido entre as chamadas de http_parser_alimentar.
+typedef struct {
+    uint8_t estado;
+    uint16_t erro;                      // Status HTTP a responder quando estado == HTTP_PARSE_ERRO
+                                        // (400, 411, 413, 414 ou 505)
+    bool http11;
+    bool tem_query;                     // Havia '?' no alvo (mesmo que a query seja vazia)
+    uint32_t hash_caminho;              // FNV-1a do caminho, calculado durante a leitura
+
+    char metodo[HTTP_METODO_MAX];
+    char caminho[HTTP_CAMINHO_MAX];
+    char query[HTTP_QUERY_MAX];         // Sem o '?', ainda com o percent-encoding
+    char versao[HTTP_METODO_MAX + 1];
+    uint8_t metodo_len, caminho_len, versao_len;
+    uint16_t query_len;
+
+    char nome[HTTP_NOME_MAX];           // Nome do cabeçalho em leitura (minúsculas)
+    uint8_t nome_len;
+    int8_t cab_atual;                   // HTTP_CABECALHO em captura, ou -1 para descartar
+    char cabecalhos[HTTP_CAB_N][HTTP_VALOR_MAX];
+    uint8_t cab_len[HTTP_CAB_N];
+    bool presente[HTTP_CAB_N];
+
+    char corpo[HTTP_CORPO_MAX + 1];     // Terminado em '\0'
+    uint16_t corpo_len;                 // Tamanho declarado em Content-Length
+    uint16_t corpo_lido;
+} HTTP_REQUISICAO;
+
+// FNV-1a de 32 bits, usado no caminho das rotas
+#define HTTP_FNV_INICIO  2166136261u
+#define HTTP_FNV_PRIMO   16777619u
+
+uint32_t http_hash(const char *s);
+
+/**
+ * @brief Prepara a estrutura para ler uma nova requisição.
+ */
+void http_parser_iniciar(HTTP_REQUISICAO *req);
+
+/**
+ * @brief Consome bytes da requisição. Para logo após o fim do cabeçalho (ou do corpo, se
+ * houver Content-Length), para que os bytes seguintes (requisições em pipeline) fiquem
+ * para a próxima. Corpos com Transfer-Encoding não são aceitos (411).
+ * @return Quantos bytes de `dados` foram consumidos. Depois da chamada, `estado` indica se
+ *         a requisição está completa, com erro ou ainda aguardando mais bytes.
+ */
+size_t http_parser_alimentar(HTTP_REQUISICAO *req, const char *dados, size_t len);
+
+/**
+ * @brief Valor de um cabeçalho guardado ("" se ausente), terminado em '\0'.
+ */
+const char *http_cabecalho(const HTTP_REQUISICAO *req, HTTP_CABECALHO cab);
+
+/**
+ * @brief Extrai o próximo elemento de uma lista separada por vírgulas, como as de
+ * If-None-Match e Accept-Encoding, sem os espaços em volta. Não altera o texto; elementos
+ * vazios são pulados.
+ * @param cursor Posição atual na lista; avançada a cada chamada.
+ * @param item Recebe o início do elemento; len, o seu tamanho.
+ * @return false quando não há mais elementos.
+ */
+bool http_lista_proximo(const char **cursor, const char **item, size_t *len);
+
+/**
+ * @brief Extrai o próximo par chave=valor de uma query string, numa única passada e no
+ * próprio buffer: separa em '&' e '=', decodifica '+' e %XX.
+ * @param cursor Posição atual na query; avançada a cada chamada. Começa no início da query.
+ * @return false quando não há mais pares.
+ */
+bool http_query_proximo(char **cursor, char **chave, char **valor);
+
+/**
+ * @brief Extrai o próximo membro de um objeto JSON plano ({"chave": valor, ...}), no
+ * próprio buffer. Valores aninhados (objetos e arrays) não são aceitos; strings perdem as
+ * aspas e números/literais são devolvidos como texto.
+ * @param cursor Posição atual; começa no início do texto (antes do '{').
+ * @return 1 quando extraiu um membro, 0 no fim do objeto, -1 se o JSON é inválido.
+ */
+int http_json_proximo(char **cursor, char **chave, char **valor);
+
+#endif
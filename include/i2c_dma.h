@@ -0,0 +1,55 @@
+#ifndef I2C_DMA_H
+#define I2C_DMA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hardware/i2c.h"
+
+// Transações I2C por DMA. Enquanto os bytes andam no barramento (~23 µs cada a 400 kHz,
+// 23 ms para um quadro do OLED) a tarefa que pediu a transação fica bloqueada e a CPU
+// fica livre para as outras; a interrupção de fim de transação (STOP) a acorda por uma
+// notificação do FreeRTOS. Tarefas que disputam o mesmo barramento esperam a vez no mutex
+// dele, na ordem de prioridade.
+//
+// Antes de o escalonador rodar (display_init em main), ou num barramento sem
+// i2c_dma_iniciar, as transações caem nas funções bloqueantes do SDK.
+
+// Barramentos do RP2040 (i2c0 e i2c1)
+#define I2C_DMA_BARRAMENTOS 2
+
+// Contadores de um barramento, desde o boot
+typedef struct {
+    uint32_t transacoes;    // Transações concluídas ou abortadas
+    uint32_t bytes;         // Bytes escritos + lidos
+    uint32_t erros;         // NACK, perda de arbitragem ou tempo esgotado
+    uint32_t bloqueantes;   // Transações feitas com as funções bloqueantes do SDK
+    uint64_t tempo_us;      // Tempo de barramento das transações por DMA: a espera ativa
+                            // que o i2c_*_blocking teria gasto na CPU
+} I2C_DMA_STATS;
+
+/**
+ * @brief Prepara o barramento para transações por DMA: reserva dois canais (comandos e
+ * leitura) e instala a interrupção. Chamar depois de i2c_init, uma vez por barramento.
+ * @param max_bytes Maior transação esperada (escrita + leitura). Transações maiores
+ *                  usam as funções bloqueantes.
+ * @return false se não há canais de DMA ou memória (o barramento segue bloqueante).
+ */
+bool i2c_dma_iniciar(i2c_inst_t *i2c, size_t max_bytes);
+
+/**
+ * @brief Executa uma transação: escreve n_escrita bytes e, se n_leitura > 0, lê n_leitura
+ * bytes após um START repetido, terminando com STOP. Qualquer das partes pode ser vazia.
+ * Bloqueia a tarefa chamadora até o fim da transação.
+ * @return true se todos os bytes foram transferidos (o dispositivo respondeu com ACK).
+ */
+bool i2c_dma_transferir(i2c_inst_t *i2c, uint8_t destino,
+                        const uint8_t *escrita, size_t n_escrita,
+                        uint8_t *leitura, size_t n_leitura);
+
+/**
+ * @brief Copia os contadores dos barramentos (índice 0 para i2c0, 1 para i2c1).
+ */
+void i2c_dma_get_stats(I2C_DMA_STATS stats[I2C_DMA_BARRAMENTOS]);
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef JSON_DADOS_H
+#define JSON_DADOS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "global_manage.h"
+#include "flash_log.h"
+
+// Documentos emitidos pelo serializador
+enum {
+    JSON_DOC_COMPLETO,      // /dados_sensores
+    JSON_DOC_INCREMENTAL,   // /dados_sensores?since=<seq>: só as amostras novas
+    JSON_DOC_AGREGADO,      // /historico: primeira e ultima são números de intervalos
+    JSON_DOC_LOG            // /log: registros do log em flash
+};
+
+// Posição do serializador dentro do JSON de /dados_sensores (ou de /historico e /log).
+// Permite gerar o documento em partes, à medida que há espaço no buffer de envio TCP, e
+// retomar de onde parou.
+typedef struct {
+    uint8_t documento;  // JSON_DOC_*
+    uint8_t secao;      // Seção atual (valores, offsets, limites, históricos)
+    uint16_t indice;    // Posição dentro da seção (elemento do histórico)
+    bool concluido;     // Documento emitido por completo
+    uint8_t nivel;      // Nível do histórico agregado
+    bool separador;     // Já há elementos emitidos: o próximo leva ','
+    uint32_t primeira;  // Faixa de números de sequência emitida, fixada no início
+    uint32_t ultima;    // para que o documento seja coerente mesmo que cheguem amostras
+    uint32_t agora_s;   // Momento da consulta ao histórico agregado ou ao log
+    union {
+        SENSOR_DATA dados;      // Valores atuais e configuração, copiados no início pelo mesmo motivo
+        FLASH_LOG_CURSOR log;   // Consulta ao log em flash
+    };
+} JSON_CURSOR;
+
+/**
+ * @brief Prepara o cursor para emitir um novo documento.
+ *
+ * Documento completo: valores atuais, offsets, limites e o histórico inteiro, com os
+ * números de sequência em "hist_labels" e a última sequência em "seq".
+ *
+ * Documento incremental, usado quando o cliente já tem o histórico até `desde`:
+ * {"seq":N,"amostras":[[seq,temp,umid,press,alt],...]} só com as amostras posteriores.
+ * Se `desde` já saiu do histórico (ou é maior que a última sequência, como após um
+ * reinício), o documento completo é emitido no lugar.
+ *
+ * @param desde Última sequência que o cliente possui.
+ * @param tem_desde false para pedir sempre o documento completo.
+ */
+void json_dados_iniciar(JSON_CURSOR *cursor, uint32_t desde, bool tem_desde);
+
+/**
+ * @brief Prepara o cursor para emitir o histórico agregado dos últimos `janela_s` segundos,
+ * do nível escolhido por agreg_escolher_nivel:
+ *
+ * {"nivel":N,"periodo":P,"agora":T,"intervalos":[[inicio,amostras,temp_min,temp_med,
+ *  temp_max,umid_min,...,alt_max],...]}
+ *
+ * Tempos em segundos desde o boot (o cliente ancora "agora" no seu relógio). Intervalos
+ * sem leituras são omitidos; o último é o intervalo em andamento.
+ */
+void json_dados_iniciar_agregado(JSON_CURSOR *cursor, uint32_t janela_s);
+
+/**
+ * @brief Prepara o cursor para emitir os registros do log em flash com tempo em [de, ate]:
+ *
+ * {"agora":T,"registros":[[tempo,temp,umid,press,alt],...]}
+ *
+ * Tempos no relógio do log (flash_log.h), do qual "agora" é o valor atual.
+ */
+void json_dados_iniciar_log(JSON_CURSOR *cursor, uint32_t de, uint32_t ate);
+
+/**
+ * @brief Emite o próximo trecho do JSON de /dados_sensores em buf.
+ * Só são escritos itens completos; o que não couber fica para a próxima chamada.
+ * @param cursor Estado do serializador, atualizado a cada item emitido.
+ * @param buf Destino dos bytes (não é terminado em '\0').
+ * @param cap Espaço disponível em buf. Com pelo menos JSON_DADOS_MIN_CAP bytes
+ *            a chamada sempre avança.
+ * @return Número de bytes escritos em buf.
+ */
+size_t json_dados_escrever(JSON_CURSOR *cursor, char *buf, size_t cap);
+
+/**
+ * @brief Escreve uma amostra no formato [seq,temp,umid,press,alt] (termina em '\0').
+ * Usada também pelos eventos de /stream e /ws.
+ * @return Ponteiro para o '\0' final.
+ */
+char *json_dados_amostra(char *p, const AMOSTRA *a);
+
+// Maior item indivisível emitido pelo serializador (com folga): valores atuais com
+// quatro números de até 23 caracteres cada (fmt_fixo com 2 casas) e as chaves. Um
+// intervalo agregado tem doze números, mas vindos do ponto fixo do histórico: no
+// máximo 8 caracteres cada.
+#define JSON_DADOS_MIN_CAP 192
+// Maior saída de json_dados_amostra, incluindo o '\0'
+#define JSON_DADOS_AMOSTRA_MAX (2 + 10 + 4 * (1 + 23) + 1)
+
+#endif
@@ -4,7 +4,9 @@
 #define __LWIPOPTS_H__
 
 // --- Configurações Gerais Mantidas do Original ---
-#define NO_SYS                          1
+// A pilha roda sobre o FreeRTOS (pico_cyw43_arch_lwip_sys_freertos): a interrupção do
+// CYW43 acorda a tarefa do async_context, que processa os pacotes e os timers da lwIP.
+#define NO_SYS                          0
 #define LWIP_SOCKET                     0
 #if PICO_CYW43_ARCH_POLL
 #define MEM_LIBC_MALLOC                 1
@@ -36,6 +38,9 @@
 // [ALTERADO] Aumenta o tamanho total da memória disponível para a lwIP.
 #define MEM_SIZE                        16000
 
+// PCBs TCP: conexões HTTP do pool, assinantes de /stream e folga para recusar com 503
+#define MEMP_NUM_TCP_PCB                16
+
 // [ALTERADO] Aumenta o número de segmentos TCP que podem ser enfileirados.
 // Ajuda no envio de arquivos grandes em pedaços.
 #define MEMP_NUM_TCP_SEG                64
@@ -53,6 +58,21 @@
 #define TCP_WND                         (8 * TCP_MSS)
 #define TCP_SND_QUEUELEN                ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS))
 
+// --- Integração com o FreeRTOS ---
+#if !NO_SYS
+// Os pacotes recebidos são processados direto na tarefa do async_context, com o lock
+// do núcleo da lwIP, sem passar pela fila da tarefa tcpip
+#define LWIP_TCPIP_CORE_LOCKING_INPUT   1
+#define TCPIP_THREAD_STACKSIZE          1024
+#define TCPIP_THREAD_PRIO               4   // Igual à tarefa do CYW43; acima das tarefas da aplicação (1)
+#define TCPIP_MBOX_SIZE                 8
+#define DEFAULT_THREAD_STACKSIZE        1024
+#define DEFAULT_RAW_RECVMBOX_SIZE       8
+#define DEFAULT_TCP_RECVMBOX_SIZE       8
+#define DEFAULT_ACCEPTMBOX_SIZE         8
+#define LWIP_TIMEVAL_PRIVATE            0
+#endif
+
 
 // --- Configurações de Debug (mantidas do original) ---
 #ifndef NDEBUG
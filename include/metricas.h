@@ -0,0 +1,40 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "server.h"
+
+// Maior exposição possível de /metrics: as 11 rotas, os 2 barramentos e os 2 sensores,
+// com todo contador em 10 dígitos, todo inteiro em 11 e todo float nos 23 caracteres de
+// fmt_fixo (~6,5 KB com valores reais). Refazer a conta ao acrescentar uma série.
+#define METRICAS_PIOR_CASO 7100
+// Espaço reservado: o pior caso mais 10% de folga, arredondado. O que não couber faz
+// metricas_renderizar falhar (e /metrics responder 503), não sumir da exposição.
+#define METRICAS_MAX 8192
+
+/**
+ * @brief Renderiza as métricas da estação no formato de texto do Prometheus (0.0.4):
+ * leituras atuais, offsets, limites, alertas, versão da configuração, contadores de
+ * amostras, de erros I2C e de leituras por sensor, os contadores dos barramentos I2C
+ * (i2c_dma.h), a ocupação do heap do FreeRTOS e os do servidor HTTP em `http`.
+ * @param len Recebe os bytes escritos em buf (sem '\0').
+ * @return false se alguma linha não coube: a exposição está incompleta e não deve ser
+ *         servida (o coletor tomaria as séries ausentes por contadores zerados).
+ */
+bool metricas_renderizar(char *buf, size_t cap, const HTTP_SERVER_STATS *http, size_t *len);
+
+// Ocupação do heap do FreeRTOS (pilhas, TCBs, filas e semáforos), em bytes
+typedef struct {
+    uint32_t tamanho;           // configTOTAL_HEAP_SIZE
+    uint32_t livre;
+    uint32_t livre_minimo;      // Menor valor livre desde o boot
+} METRICAS_HEAP;
+
+/**
+ * @brief Lê a ocupação do heap. Fornecida pela plataforma: no firmware, em
+ * Estacao_Meteorologica.c, com xPortGetFreeHeapSize e xPortGetMinimumEverFreeHeapSize.
+ */
+void metricas_heap(METRICAS_HEAP *heap);
+
+#endif
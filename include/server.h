@@ -3,6 +3,44 @@
 
 #include "lwip/tcp.h"   // Lightweight IP stack - fornece funções e estruturas para trabalhar com o protocolo TCP
 
+#define HTTP_SERVER_ROTAS_MAX 12
+
+// Requisições atendidas por uma rota (método + caminho)
+typedef struct {
+    const char *metodo;
+    const char *caminho;
+    uint32_t requisicoes;
+} HTTP_ROTA_STATS;
+
+// Contadores do servidor HTTP, exportados para diagnóstico e em /metrics
+typedef struct {
+    uint16_t conns_active;      // Conexões ocupando slots do pool agora
+    uint16_t conns_high_water;  // Maior número de slots ocupados simultaneamente
+    uint32_t conns_rejected;    // Conexões recusadas com 503 por falta de slot
+    uint16_t sse_subscribers;   // Clientes inscritos em /stream
+    uint16_t ws_clients;        // Clientes conectados em /ws
+    uint32_t bytes_sent;        // Bytes entregues à lwIP (respostas, eventos e quadros WebSocket)
+    uint32_t requests_other;    // Requisições sem rota (404, 405) ou malformadas
+    uint8_t n_rotas;
+    HTTP_ROTA_STATS rotas[HTTP_SERVER_ROTAS_MAX];
+} HTTP_SERVER_STATS;
+
+/**
+ * @brief Abre o servidor na porta 80. Chamada de uma tarefa, depois de connect_wifi();
+ * faz o próprio lock da lwIP.
+ */
 void start_http_server();
 
+/**
+ * @brief Copia os contadores atuais do servidor HTTP.
+ * Deve ser chamada no contexto da lwIP (ou entre cyw43_arch_lwip_begin/end).
+ */
+void http_server_get_stats(HTTP_SERVER_STATS *stats);
+
+/**
+ * @brief Envia a amostra mais recente (e a máscara de alertas) a todos os clientes de /stream e /ws.
+ * Chamada pela tarefa de sensores após cada leitura; faz o próprio lock da lwIP.
+ */
+void http_server_publicar(void);
+
 #endif
\ No newline at end of file
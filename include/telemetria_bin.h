@@ -0,0 +1,155 @@
+#ifndef TELEMETRIA_BIN_H
+#define TELEMETRIA_BIN_H
+
+// Formato binário de /dados.bin, compartilhado pelo firmware e pelo decodificador do
+// host (tools/decode_telemetria.c). Todos os campos são little-endian e sem padding;
+// o acesso é sempre byte a byte, então o formato não depende da arquitetura que lê.
+//
+// Resposta = cabeçalho (TELEMETRIA_CABECALHO_LEN) + n_amostras blocos de histórico
+// (TELEMETRIA_AMOSTRA_LEN cada), do mais antigo para o mais recente.
+//
+//  Cabeçalho                             Bloco de histórico
+//  off  tipo  campo                      off  tipo  campo
+//   0   u8[4] magic "EMTB"                0   u32   seq (0 = amostra indisponível)
+//   4   u8    versão                      4   i16   temperatura (0,01 °C)
+//   5   u8    máscara de alertas          6   u16   umidade (0,01 %)
+//   6   u16   n_amostras                  8   u32   pressão (Pa = 0,01 hPa)
+//   8   u32   seq da leitura atual       12   i32   altitude (cm)
+//  12   u32   timestamp (ms desde o boot)
+//  16   i16   temperatura (0,01 °C)
+//  18   u16   umidade (0,01 %)
+//  20   u32   pressão (Pa = 0,01 hPa)
+//  24   i32   altitude (cm)
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TELEMETRIA_MAGIC            "EMTB"
+#define TELEMETRIA_VERSAO           1
+#define TELEMETRIA_CABECALHO_LEN    28
+#define TELEMETRIA_AMOSTRA_LEN      16
+
+// Uma leitura em ponto fixo (mesma resolução dos %.2f do JSON)
+typedef struct {
+    uint32_t seq;
+    int16_t temperatura;    // 0,01 °C
+    uint16_t umidade;       // 0,01 %
+    uint32_t pressao;       // Pa
+    int32_t altitude;       // cm
+} TELEMETRIA_LEITURA;
+
+typedef struct {
+    uint8_t versao;
+    uint8_t alertas;        // Bits ALERTA_* de global_manage.h
+    uint16_t n_amostras;
+    uint32_t timestamp_ms;
+    TELEMETRIA_LEITURA atual;
+} TELEMETRIA_CABECALHO;
+
+static inline void tlm_put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void tlm_put32(uint8_t *p, uint32_t v) {
+    tlm_put16(p, (uint16_t)v);
+    tlm_put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint16_t tlm_get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static inline uint32_t tlm_get32(const uint8_t *p) {
+    return tlm_get16(p) | (uint32_t)tlm_get16(p + 2) << 16;
+}
+
+// Campos de medição: mesma disposição no cabeçalho (a partir do offset 16) e nos blocos (offset 4)
+static inline void tlm_codificar_medidas(uint8_t *p, const TELEMETRIA_LEITURA *l) {
+    tlm_put16(p, (uint16_t)l->temperatura);
+    tlm_put16(p + 2, l->umidade);
+    tlm_put32(p + 4, l->pressao);
+    tlm_put32(p + 8, (uint32_t)l->altitude);
+}
+
+static inline void tlm_decodificar_medidas(const uint8_t *p, TELEMETRIA_LEITURA *l) {
+    l->temperatura = (int16_t)tlm_get16(p);
+    l->umidade = tlm_get16(p + 2);
+    l->pressao = tlm_get32(p + 4);
+    l->altitude = (int32_t)tlm_get32(p + 8);
+}
+
+static inline void telemetria_codificar_cabecalho(uint8_t *p, const TELEMETRIA_CABECALHO *c) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)TELEMETRIA_MAGIC[i];
+    p[4] = c->versao;
+    p[5] = c->alertas;
+    tlm_put16(p + 6, c->n_amostras);
+    tlm_put32(p + 8, c->atual.seq);
+    tlm_put32(p + 12, c->timestamp_ms);
+    tlm_codificar_medidas(p + 16, &c->atual);
+}
+
+/**
+ * @return false se os bytes não começam com o magic ou a versão não é suportada.
+ */
+static inline bool telemetria_decodificar_cabecalho(const uint8_t *p, TELEMETRIA_CABECALHO *c) {
+    for (int i = 0; i < 4; i++) {
+        if (p[i] != (uint8_t)TELEMETRIA_MAGIC[i]) return false;
+    }
+    c->versao = p[4];
+    if (c->versao != TELEMETRIA_VERSAO) return false;
+    c->alertas = p[5];
+    c->n_amostras = tlm_get16(p + 6);
+    c->atual.seq = tlm_get32(p + 8);
+    c->timestamp_ms = tlm_get32(p + 12);
+    tlm_decodificar_medidas(p + 16, &c->atual);
+    return true;
+}
+
+static inline void telemetria_codificar_amostra(uint8_t *p, const TELEMETRIA_LEITURA *l) {
+    tlm_put32(p, l->seq);
+    tlm_codificar_medidas(p + 4, l);
+}
+
+static inline void telemetria_decodificar_amostra(const uint8_t *p, TELEMETRIA_LEITURA *l) {
+    l->seq = tlm_get32(p);
+    tlm_decodificar_medidas(p + 4, l);
+}
+
+// =================================================================================
+// SERIALIZADOR (firmware)
+// =================================================================================
+
+// Posição do serializador de /dados.bin, no mesmo esquema do JSON_CURSOR: a resposta
+// é emitida em partes, à medida que há espaço no buffer de envio TCP.
+typedef struct {
+    uint32_t primeira;      // Faixa de amostras do histórico, fixada no início
+    uint32_t ultima;
+    uint32_t proxima;       // Próxima amostra a emitir
+    TELEMETRIA_CABECALHO cabecalho;     // Montado no início, da mesma leitura que `ultima`
+    bool cabecalho_enviado;
+    bool concluido;
+} TELEMETRIA_CURSOR;
+
+/**
+ * @brief Prepara o cursor para uma nova resposta.
+ * @param historico false para enviar só o cabeçalho com a leitura atual.
+ * @param desde Última sequência que o cliente possui: só as amostras posteriores vão como
+ *              histórico. Se já saiu do histórico (ou é maior que a última, como após um
+ *              reinício), o histórico inteiro é enviado.
+ */
+void telemetria_bin_iniciar(TELEMETRIA_CURSOR *cursor, bool historico, uint32_t desde);
+
+/**
+ * @brief Tamanho total da resposta preparada (para o Content-Length).
+ */
+size_t telemetria_bin_tamanho(const TELEMETRIA_CURSOR *cursor);
+
+/**
+ * @brief Emite o próximo trecho da resposta em buf; só registros inteiros são escritos.
+ * @return Número de bytes escritos.
+ */
+size_t telemetria_bin_escrever(TELEMETRIA_CURSOR *cursor, uint8_t *buf, size_t cap);
+
+#endif
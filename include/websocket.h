@@ -0,0 +1,73 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Opcodes de quadro (RFC 6455, seção 5.2)
+#define WS_OP_CONTINUACAO  0x0
+#define WS_OP_TEXTO        0x1
+#define WS_OP_BINARIO      0x2
+#define WS_OP_FECHAR       0x8
+#define WS_OP_PING         0x9
+#define WS_OP_PONG         0xA
+
+// Códigos de status do quadro de fechamento (RFC 6455, seção 7.4.1)
+#define WS_FECHA_NORMAL         1000
+#define WS_FECHA_PROTOCOLO      1002
+#define WS_FECHA_NAO_SUPORTADO  1003
+#define WS_FECHA_GRANDE_DEMAIS  1009
+
+#define WS_ACEITE_LEN       28   // Sec-WebSocket-Accept: base64 de um SHA-1 (20 bytes)
+#define WS_CABECALHO_MAX    4    // Cabeçalho de quadro do servidor (payload < 64 KiB, sem máscara)
+
+// Resultado de ws_quadro_ler quando os bytes não formam um quadro válido
+#define WS_QUADRO_INVALIDO  (-1)  // Quadro do cliente sem máscara, com bits RSV (nenhuma
+                                  // extensão é negociada), controle fragmentado/longo ou
+                                  // tamanho de 64 bits com o bit mais significativo em 1
+#define WS_QUADRO_GRANDE    (-2)  // Payload maior que o buffer de recepção
+
+typedef struct {
+    bool fin;                // Último fragmento da mensagem
+    uint8_t opcode;
+    uint8_t *payload;        // Aponta para dentro do buffer lido, já sem máscara
+    size_t payload_len;
+} WS_QUADRO;
+
+/**
+ * @brief Calcula o valor de Sec-WebSocket-Accept para a chave enviada pelo cliente:
+ * base64(SHA-1(chave + GUID)).
+ * @param chave Valor do cabeçalho Sec-WebSocket-Key (sem espaços ao redor).
+ * @param chave_len Tamanho da chave.
+ * @param aceite Destino, com espaço para WS_ACEITE_LEN + 1 bytes (termina em '\0').
+ */
+void ws_calcular_aceite(const char *chave, size_t chave_len, char *aceite);
+
+/**
+ * @brief Lê um quadro do cliente no início de buf e remove a máscara do payload (no lugar).
+ * @param buf Bytes recebidos e ainda não processados.
+ * @param len Quantidade de bytes em buf.
+ * @param cap Capacidade do buffer de recepção: quadros maiores nunca caberiam nele.
+ * @param quadro Preenchido quando um quadro completo é encontrado.
+ * @return Tamanho total do quadro (cabeçalho + payload), 0 se ainda incompleto, ou
+ *         WS_QUADRO_INVALIDO / WS_QUADRO_GRANDE.
+ */
+int ws_quadro_ler(uint8_t *buf, size_t len, size_t cap, WS_QUADRO *quadro);
+
+/**
+ * @brief Código a devolver em resposta a um quadro de fechamento do cliente: o recebido,
+ * se for um dos que podem ir num quadro (1000 a 1003, 1007 a 1014 ou 3000 a 4999,
+ * seção 7.4); WS_FECHA_NORMAL se o quadro não traz código; WS_FECHA_PROTOCOLO se traz um
+ * código reservado (1004 a 1006, 1015), inválido ou truncado em 1 byte.
+ */
+uint16_t ws_codigo_fechamento(const WS_QUADRO *quadro);
+
+/**
+ * @brief Escreve o cabeçalho de um quadro do servidor (FIN, sem máscara).
+ * @param out Destino, com pelo menos WS_CABECALHO_MAX bytes.
+ * @return Tamanho do cabeçalho (2 ou 4 bytes).
+ */
+size_t ws_quadro_cabecalho(uint8_t *out, uint8_t opcode, uint16_t payload_len);
+
+#endif
@@ -2,6 +2,7 @@
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "aht20.h"
+#include "i2c_dma.h"
 
 #define AHT20_I2C_ADDR      0x38
 #define AHT20_CMD_INIT      0xBE
@@ -12,13 +13,13 @@
 
 bool aht20_init(i2c_inst_t *i2c) {
     uint8_t init_cmd[3] = {AHT20_CMD_INIT, 0x08, 0x00};
-    i2c_write_blocking(i2c, AHT20_I2C_ADDR, init_cmd, 3, false);
+    i2c_dma_transferir(i2c, AHT20_I2C_ADDR, init_cmd, 3, NULL, 0);
     sleep_ms(50);  // Aguarda o sensor inicializar
 
     // Verifica status até que o sensor esteja pronto
     uint8_t status;
     for (int i = 0; i < 10; i++) {
-        i2c_read_blocking(i2c, AHT20_I2C_ADDR, &status, 1, false);
+        i2c_dma_transferir(i2c, AHT20_I2C_ADDR, NULL, 0, &status, 1);
         if ((status & AHT20_STATUS_CALIBRATED) == AHT20_STATUS_CALIBRATED) {
             return true;  // Sensor calibrado e pronto
         }
@@ -28,31 +29,23 @@ bool aht20_init(i2c_inst_t *i2c) {
     return false;  // Falhou na calibração
 }
 
-bool aht20_read(i2c_inst_t *i2c, AHT20_Data *data) {
+bool aht20_disparar(i2c_inst_t *i2c) {
     uint8_t trigger_cmd[3] = {AHT20_CMD_TRIGGER, 0x33, 0x00};
+    return i2c_dma_transferir(i2c, AHT20_I2C_ADDR, trigger_cmd, 3, NULL, 0);
+}
+
+AHT20_Resultado aht20_coletar(i2c_inst_t *i2c, AHT20_Data *data) {
     uint8_t buffer[6];
 
-    // Envia comando de medição
-    i2c_write_blocking(i2c, AHT20_I2C_ADDR, trigger_cmd, 3, false);
-    
-    // Aguarda até o sensor estar pronto
-    uint8_t status;
-    for (int i = 0; i < 10; i++) {
-        i2c_read_blocking(i2c, AHT20_I2C_ADDR, &status, 1, false);
-        if (!(status & AHT20_STATUS_BUSY)) {
-            break;
-        }
-        sleep_ms(10);
+    // Status seguido dos 5 bytes de dados
+    if (!i2c_dma_transferir(i2c, AHT20_I2C_ADDR, NULL, 0, buffer, 6)) {
+        return AHT20_ERRO;
     }
-    
-    // Se ainda estiver ocupado, falha na leitura
-    if (status & AHT20_STATUS_BUSY) {
-        return false;
+    if (buffer[0] & AHT20_STATUS_BUSY) {
+        return AHT20_OCUPADO;
     }
-
-    // Lê os 6 bytes de dados
-    if (i2c_read_blocking(i2c, AHT20_I2C_ADDR, buffer, 6, false) != 6) {
-        return false;
+    if (!(buffer[0] & AHT20_STATUS_CALIBRATED)) {
+        return AHT20_ERRO;
     }
 
     // Processa os dados de umidade (20 bits)
@@ -63,17 +56,34 @@ bool aht20_read(i2c_inst_t *i2c, AHT20_Data *data) {
     uint32_t raw_temp = ((uint32_t)(buffer[3] & 0x0F) << 16) | ((uint32_t)buffer[4] << 8) | buffer[5];
     data->temperature = ((float)raw_temp * 200.0 / 1048576.0) - 50.0;
 
-    return true;
+    return AHT20_PRONTO;
+}
+
+bool aht20_read(i2c_inst_t *i2c, AHT20_Data *data) {
+    if (!aht20_disparar(i2c)) {
+        return false;
+    }
+    sleep_ms(AHT20_CONVERSAO_MS);
+
+    // A conversão pode passar um pouco do tempo típico
+    for (int i = 0; i < 5; i++) {
+        AHT20_Resultado r = aht20_coletar(i2c, data);
+        if (r != AHT20_OCUPADO) {
+            return r == AHT20_PRONTO;
+        }
+        sleep_ms(10);
+    }
+    return false;
 }
 
 void aht20_reset(i2c_inst_t *i2c) {
     uint8_t reset_cmd = AHT20_CMD_RESET;
-    i2c_write_blocking(i2c, AHT20_I2C_ADDR, &reset_cmd, 1, false);
+    i2c_dma_transferir(i2c, AHT20_I2C_ADDR, &reset_cmd, 1, NULL, 0);
     sleep_ms(20);
     aht20_init(i2c);
 }
 
 bool aht20_check(i2c_inst_t *i2c) {
     uint8_t status;
-    return i2c_read_blocking(i2c, AHT20_I2C_ADDR, &status, 1, false) == 1;
+    return i2c_dma_transferir(i2c, AHT20_I2C_ADDR, NULL, 0, &status, 1);
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+// Ficheiro: altitude.c
+// Altitude barométrica em ponto fixo (ver altitude.h). A razão r = p/p0 é calculada em
+// Q2.30 e procurada numa tabela de 44330 * (1 - r^0,1903) em cm, com um ponto a cada
+// 1/256 de r; a curvatura da potência é maior nas razões baixas, por isso o erro da
+// interpolação cresce em direção a 300 hPa. A tabela é gerada por tools/altimetro -t.
+
+#include "altitude.h"
+
+// Primeira razão da tabela e passo entre os pontos, em Q2.30
+#define ALTITUDE_RAZAO_MIN      (1u << 28)      // 0,25
+#define ALTITUDE_PASSO_BITS     22              // 1/256
+#define ALTITUDE_PONTOS         273             // Até 1,3125
+
+// 44330 * (1 - (0,25 + i/256)^0,1903) em cm
+static const int32_t ALTITUDE_TABELA[ALTITUDE_PONTOS] = {
+    1027933, 1017871, 1007935, 998119, 988421, 978838, 969367, 960005,
+    950749, 941597, 932545, 923592, 914735, 905972, 897301, 888719,
+    880225, 871816, 863491, 855248, 847085, 839000, 830992, 823058,
+    815199, 807411, 799694, 792046, 784465, 776951, 769503, 762118,
+    754795, 747535, 740334, 733193, 726110, 719084, 712115, 705200,
+    698340, 691532, 684777, 678074, 671421, 664817, 658263, 651757,
+    645298, 638885, 632518, 626196, 619919, 613685, 607495, 601346,
+    595240, 589174, 583149, 577164, 571217, 565310, 559441, 553609,
+    547815, 542057, 536335, 530648, 524997, 519380, 513797, 508248,
+    502732, 497249, 491798, 486379, 480992, 475635, 470310, 465014,
+    459749, 454513, 449306, 444128, 438978, 433856, 428762, 423696,
+    418657, 413644, 408658, 403698, 398764, 393856, 388972, 384114,
+    379280, 374471, 369686, 364925, 360187, 355473, 350782, 346113,
+    341467, 336844, 332242, 327663, 323105, 318568, 314053, 309559,
+    305085, 300632, 296199, 291787, 287394, 283021, 278668, 274333,
+    270018, 265722, 261445, 257186, 252946, 248724, 244520, 240334,
+    236165, 232014, 227881, 223764, 219665, 215583, 211517, 207468,
+    203435, 199419, 195419, 191435, 187466, 183514, 179577, 175655,
+    171749, 167858, 163982, 160121, 156274, 152443, 148626, 144823,
+    141035, 137260, 133500, 129754, 126022, 122303, 118598, 114906,
+    111228, 107563, 103911, 100272, 96647, 93034, 89434, 85846,
+    82271, 78709, 75158, 71620, 68095, 64581, 61079, 57590,
+    54112, 50645, 47191, 43748, 40316, 36896, 33487, 30089,
+    26702, 23327, 19962, 16608, 13265, 9933, 6612, 3301,
+    0, -3290, -6570, -9839, -13099, -16348, -19587, -22816,
+    -26035, -29244, -32444, -35634, -38814, -41984, -45145, -48297,
+    -51439, -54572, -57695, -60810, -63915, -67011, -70098, -73176,
+    -76245, -79305, -82357, -85399, -88433, -91459, -94476, -97484,
+    -100484, -103475, -106458, -109433, -112399, -115357, -118307, -121249,
+    -124183, -127109, -130027, -132937, -135839, -138733, -141620, -144498,
+    -147369, -150233, -153089, -155937, -158778, -161611, -164437, -167256,
+    -170067, -172871, -175668, -178457, -181239, -184015, -186783, -189544,
+    -192298, -195045, -197785, -200519, -203245, -205965, -208678, -211384,
+    -214083, -216776, -219462, -222142, -224815, -227482, -230142, -232795,
+    -235443,
+};
+
+int32_t altitude_cm(uint32_t pressao_q8, uint32_t referencia_pa) {
+    // p/p0 em Q2.30: (p * 2^8 * 2^7) / p0 dá a parte de Q15, e o resto, com mais 15 bits,
+    // o restante. Cada divisão cabe em 32 bits, desde que p < 2^17 Pa e p0 < 2^17 Pa.
+    if (pressao_q8 >= (1u << 25)) {
+        pressao_q8 = (1u << 25) - 1;
+    }
+    uint32_t num = pressao_q8 << 7;
+    uint32_t alta = num / referencia_pa;
+    uint32_t resto = num % referencia_pa;
+    if (alta >= (ALTITUDE_RAZAO_MIN >> 15) + ((ALTITUDE_PONTOS - 1) << (ALTITUDE_PASSO_BITS - 15))) {
+        return ALTITUDE_TABELA[ALTITUDE_PONTOS - 1];
+    }
+    uint32_t razao = (alta << 15) | ((resto << 15) / referencia_pa);
+    if (razao < ALTITUDE_RAZAO_MIN) {
+        return ALTITUDE_TABELA[0];
+    }
+
+    // Interpolação entre os pontos i e i + 1, com a fração em 16 bits. A altitude cai com
+    // a razão: a diferença é positiva e até ~10100 cm, então o produto cabe em 32 bits.
+    uint32_t i = (razao - ALTITUDE_RAZAO_MIN) >> ALTITUDE_PASSO_BITS;
+    uint32_t fracao = (razao >> (ALTITUDE_PASSO_BITS - 16)) & 0xFFFF;
+    uint32_t queda = (uint32_t)(ALTITUDE_TABELA[i] - ALTITUDE_TABELA[i + 1]);
+    return ALTITUDE_TABELA[i] - (int32_t)((queda * fracao + 0x8000) >> 16);
+}
@@ -1,90 +1,180 @@
 #include "bmp280.h"
 #include "hardware/i2c.h"
+#include "i2c_dma.h"
 
 #define ADDR _u(0x76)
 
+// Campos dos registradores ctrl_meas (0xF4) e config (0xF5)
+#define OSRS_X1     1
+#define OSRS_X2     2
+#define OSRS_X4     3
+#define OSRS_X16    5
+#define MODO_SLEEP  0x00
+#define MODO_FORCADO 0x01
+#define MODO_NORMAL 0x03
+#define FILTRO_OFF  0
+#define FILTRO_16   4
+#define T_SB_0_5MS  0
+
+typedef struct {
+    uint8_t osrs_t;
+    uint8_t osrs_p;
+    uint8_t filtro;
+    uint8_t t_sb;
+    uint8_t modo;
+} BMP280_PERFIL;
+
+static const BMP280_PERFIL perfis[BMP280_N_PERFIS] = {
+    [BMP280_PERFIL_ULTRA_BAIXO_CONSUMO] = { OSRS_X1, OSRS_X1,  FILTRO_OFF, T_SB_0_5MS, MODO_FORCADO },
+    [BMP280_PERFIL_ALTA_RESOLUCAO]      = { OSRS_X2, OSRS_X16, FILTRO_OFF, T_SB_0_5MS, MODO_FORCADO },
+    [BMP280_PERFIL_ALTA_TAXA]           = { OSRS_X1, OSRS_X4,  FILTRO_16,  T_SB_0_5MS, MODO_NORMAL },
+};
+
+static uint8_t ctrl_meas(const BMP280_PERFIL *p, uint8_t modo) {
+    return (uint8_t)((p->osrs_t << 5) | (p->osrs_p << 2) | modo);
+}
+
+static bool bmp280_escrever(i2c_inst_t *i2c, uint8_t reg, uint8_t valor) {
+    uint8_t buf[2] = { reg, valor };
+    return i2c_dma_transferir(i2c, ADDR, buf, 2, NULL, 0);
+}
+
 void bmp280_init(i2c_inst_t *i2c) {
-    uint8_t buf[2];
-    const uint8_t reg_config_val = ((0x04 << 5) | (0x05 << 2)) & 0xFC;
-    buf[0] = REG_CONFIG;
-    buf[1] = reg_config_val;
-   
-    i2c_write_blocking(i2c, ADDR, buf, 2, false);
-
-    const uint8_t reg_ctrl_meas_val = (0x01 << 5) | (0x03 << 2) | (0x03);
-    buf[0] = REG_CTRL_MEAS;
-    buf[1] = reg_ctrl_meas_val;
-    i2c_write_blocking(i2c, ADDR, buf, 2, false);
- //   printf("Ctrl_meas register value: %x\n", reg_ctrl_meas_val);
+    bmp280_configurar(i2c, BMP280_PERFIL_PADRAO);
+}
+
+bool bmp280_configurar(i2c_inst_t *i2c, bmp280_perfil_t perfil) {
+    const BMP280_PERFIL *p = &perfis[perfil];
+    // No modo normal a escrita em config pode ser ignorada (seção 5.4.6): o sensor
+    // dorme antes, e só então recebe o filtro e o modo do perfil
+    return bmp280_escrever(i2c, REG_CTRL_MEAS, ctrl_meas(p, MODO_SLEEP)) &&
+           bmp280_escrever(i2c, REG_CONFIG, (uint8_t)((p->t_sb << 5) | (p->filtro << 2))) &&
+           (p->modo != MODO_NORMAL || bmp280_escrever(i2c, REG_CTRL_MEAS, ctrl_meas(p, MODO_NORMAL)));
 }
 
-void bmp280_read_raw(i2c_inst_t *i2c, int32_t* temp, int32_t* pressure) {
+bool bmp280_disparar(i2c_inst_t *i2c, bmp280_perfil_t perfil) {
+    const BMP280_PERFIL *p = &perfis[perfil];
+    if (p->modo != MODO_FORCADO) {
+        return true;
+    }
+    // Ao fim da conversão o sensor volta sozinho ao modo sleep
+    return bmp280_escrever(i2c, REG_CTRL_MEAS, ctrl_meas(p, MODO_FORCADO));
+}
+
+uint32_t bmp280_tempo_conversao_ms(bmp280_perfil_t perfil) {
+    const BMP280_PERFIL *p = &perfis[perfil];
+    if (p->modo != MODO_FORCADO) {
+        return 0;
+    }
+    // Tempo máximo da seção 3.8.1, em µs: 1,25 ms + 2,3 ms por amostra de temperatura +
+    // 2,3 ms por amostra de pressão + 0,575 ms (oversampling xN = 1 << (osrs - 1))
+    uint32_t n_t = 1u << (p->osrs_t - 1);
+    uint32_t n_p = 1u << (p->osrs_p - 1);
+    uint32_t us = 1250 + 2300 * n_t + 2300 * n_p + 575;
+    return (us + 999) / 1000;
+}
+
+bool bmp280_read_raw(i2c_inst_t *i2c, int32_t* temp, int32_t* pressure) {
     uint8_t buf[6];
     uint8_t reg = REG_PRESSURE_MSB;
-    i2c_write_blocking(i2c, ADDR, &reg, 1, true);
-    i2c_read_blocking(i2c, ADDR, buf, 6, false);
+    if (!i2c_dma_transferir(i2c, ADDR, &reg, 1, buf, 6)) {
+        return false;
+    }
 
     *pressure = (buf[0] << 12) | (buf[1] << 4) | (buf[2] >> 4);
     *temp = (buf[3] << 12) | (buf[4] << 4) | (buf[5] >> 4);
-
-
+    return true;
 }
 
 void bmp280_reset(i2c_inst_t *i2c) {
     uint8_t buf[2] = { REG_RESET, 0xB6 };
-    i2c_write_blocking(i2c, ADDR, buf, 2, false);
+    i2c_dma_transferir(i2c, ADDR, buf, 2, NULL, 0);
 }
 
-// função intermediária que calcula a temperatura de resolução fina
-// usada tanto para conversões de pressão quanto de temperatura
-int32_t bmp280_convert(int32_t temp, struct bmp280_calib_param* params) {
-    // usa os 32 bits de compensação de ponto fixo implementados no datasheet
+// =================================================================================
+// COMPENSAÇÃO (seção 8.2 do datasheet)
+// =================================================================================
+// Os cálculos seguem o código de referência da Bosch passo a passo, para dar os mesmos
+// resultados bit a bit (conferidos por tools/compensacao). Os deslocamentos à esquerda de
+// valores que podem ser negativos viraram multiplicações, que o compilador transforma de
+// volta em deslocamentos sem o comportamento indefinido.
+
+// Temperatura de resolução fina, comum às duas compensações
+static int32_t bmp280_t_fine(int32_t adc_t, const struct bmp280_calib_param *params) {
     int32_t var1, var2;
-    var1 = ((((temp >> 3) - ((int32_t)params->dig_t1 << 1))) * ((int32_t)params->dig_t2)) >> 11;
-    var2 = (((((temp >> 4) - ((int32_t)params->dig_t1)) * ((temp >> 4) - ((int32_t)params->dig_t1))) >> 12) * ((int32_t)params->dig_t3)) >> 14;
+    var1 = ((((adc_t >> 3) - ((int32_t)params->dig_t1 * 2))) * ((int32_t)params->dig_t2)) >> 11;
+    var2 = (((((adc_t >> 4) - ((int32_t)params->dig_t1)) * ((adc_t >> 4) - ((int32_t)params->dig_t1))) >> 12) * ((int32_t)params->dig_t3)) >> 14;
     return var1 + var2;
 }
 
-int32_t bmp280_convert_temp(int32_t temp, struct bmp280_calib_param* params) {
-    // Utiliza os parâmetros de calibração do BMP280 para compensar o valor de temperatura lido de seus registradores
-    int32_t t_fine = bmp280_convert(temp, params);
-    return (t_fine * 5 + 128) >> 8;
-}
-
-
-int32_t bmp280_convert_pressure(int32_t pressure, int32_t temp, struct bmp280_calib_param* params) {
-    // Utiliza os parâmetros de calibração do BMP280 para compensar o valor de pressão lido de seus registradores
-
-    int32_t t_fine = bmp280_convert(temp, params);
-
+// Pressão em Pa, em 32 bits (bmp280_compensate_P_int32)
+static uint32_t bmp280_pressao_32(int32_t adc_p, int32_t t_fine, const struct bmp280_calib_param *params) {
     int32_t var1, var2;
-    uint32_t converted = 0.0;
-    var1 = (((int32_t)t_fine) >> 1) - (int32_t)64000;
+    uint32_t p;
+    var1 = (t_fine >> 1) - (int32_t)64000;
     var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * ((int32_t)params->dig_p6);
-    var2 += ((var1 * ((int32_t)params->dig_p5)) << 1);
-    var2 = (var2 >> 2) + (((int32_t)params->dig_p4) << 16);
+    var2 += (var1 * ((int32_t)params->dig_p5)) * 2;
+    var2 = (var2 >> 2) + ((int32_t)params->dig_p4 * 65536);
     var1 = (((params->dig_p3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3) + ((((int32_t)params->dig_p2) * var1) >> 1)) >> 18;
     var1 = ((((32768 + var1)) * ((int32_t)params->dig_p1)) >> 15);
     if (var1 == 0) {
-        return 0;  // avoid exception caused by division by zero
+        return 0;  // Evita a divisão por zero
+    }
+    p = (((uint32_t)(((int32_t)1048576) - adc_p) - (var2 >> 12))) * 3125;
+    if (p < 0x80000000) {
+        p = (p << 1) / ((uint32_t)var1);
+    } else {
+        p = (p / (uint32_t)var1) * 2;
+    }
+    var1 = (((int32_t)params->dig_p9) * ((int32_t)(((p >> 3) * (p >> 3)) >> 13))) >> 12;
+    var2 = (((int32_t)(p >> 2)) * ((int32_t)params->dig_p8)) >> 13;
+    return (uint32_t)((int32_t)p + ((var1 + var2 + params->dig_p7) >> 4));
+}
+
+// Pressão em Pa no formato Q24.8, em 64 bits (bmp280_compensate_P_int64)
+static uint32_t bmp280_pressao_64(int32_t adc_p, int32_t t_fine, const struct bmp280_calib_param *params) {
+    int64_t var1, var2, p;
+    var1 = (int64_t)t_fine - 128000;
+    var2 = var1 * var1 * (int64_t)params->dig_p6;
+    var2 = var2 + ((var1 * (int64_t)params->dig_p5) * ((int64_t)1 << 17));
+    var2 = var2 + ((int64_t)params->dig_p4 * ((int64_t)1 << 35));
+    var1 = ((var1 * var1 * (int64_t)params->dig_p3) >> 8) + ((var1 * (int64_t)params->dig_p2) * ((int64_t)1 << 12));
+    var1 = ((((int64_t)1 << 47) + var1) * (int64_t)params->dig_p1) >> 33;
+    if (var1 == 0) {
+        return 0;  // Evita a divisão por zero
     }
-    converted = (((uint32_t)(((int32_t)1048576) - pressure) - (var2 >> 12))) * 3125;
-    if (converted < 0x80000000) {
-        converted = (converted << 1) / ((uint32_t)var1);
+    p = 1048576 - adc_p;
+    p = ((p * ((int64_t)1 << 31)) - var2) * 3125 / var1;
+    var1 = ((int64_t)params->dig_p9 * (p >> 13) * (p >> 13)) >> 25;
+    var2 = ((int64_t)params->dig_p8 * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + ((int64_t)params->dig_p7 * 16);
+    return (uint32_t)p;
+}
+
+bool bmp280_compensar(int32_t adc_t, int32_t adc_p, const struct bmp280_calib_param *params,
+                      bmp280_precisao_t precisao, bmp280_compensado_t *saida) {
+    int32_t t_fine = bmp280_t_fine(adc_t, params);
+    saida->temperatura = (t_fine * 5 + 128) >> 8;
+    if (precisao == BMP280_PRESSAO_64BITS) {
+        saida->pressao_q8 = bmp280_pressao_64(adc_p, t_fine, params);
     } else {
-        converted = (converted / (uint32_t)var1) * 2;
+        saida->pressao_q8 = bmp280_pressao_32(adc_p, t_fine, params) << 8;
     }
-    var1 = (((int32_t)params->dig_p9) * ((int32_t)(((converted >> 3) * (converted >> 3)) >> 13))) >> 12;
-    var2 = (((int32_t)(converted >> 2)) * ((int32_t)params->dig_p8)) >> 13;
-    converted = (uint32_t)((int32_t)converted + ((var1 + var2 + params->dig_p7) >> 4));
-    return converted;
+    return saida->pressao_q8 != 0;
+}
+
+int32_t bmp280_convert_temp(int32_t temp, struct bmp280_calib_param* params) {
+    return (bmp280_t_fine(temp, params) * 5 + 128) >> 8;
+}
+
+int32_t bmp280_convert_pressure(int32_t pressure, int32_t temp, struct bmp280_calib_param* params) {
+    return (int32_t)bmp280_pressao_32(pressure, bmp280_t_fine(temp, params), params);
 }
 
 void bmp280_get_calib_params(i2c_inst_t *i2c, struct bmp280_calib_param* params) {
     uint8_t buf[NUM_CALIB_PARAMS] = { 0 };
     uint8_t reg = REG_DIG_T1_LSB;
-    i2c_write_blocking(i2c, ADDR, &reg, 1, true);
-    i2c_read_blocking(i2c, ADDR, buf, NUM_CALIB_PARAMS, false);
+    i2c_dma_transferir(i2c, ADDR, &reg, 1, buf, NUM_CALIB_PARAMS);
 
     params->dig_t1 = (uint16_t)(buf[1] << 8) | buf[0];
     params->dig_t2 = (int16_t)(buf[3] << 8) | buf[2];
@@ -0,0 +1,298 @@
+// Ficheiro: flash_log.c
+// Log circular das leituras em flash (formato em flash_log.h). Não depende do hardware:
+// a região chega por FLASH_LOG_OPS, implementada por lib/flash_log_pico.c no firmware e
+// por uma flash simulada em RAM no host (tools/flash_log).
+
+#include "flash_log.h"
+#include <stddef.h>
+#include <string.h>
+
+// Página montada em RAM antes de ser programada
+typedef struct {
+    FLASH_LOG_CABECALHO cabecalho;
+    FLASH_LOG_REGISTRO registros[FLASH_LOG_REGISTROS_POR_PAGINA];
+} FLASH_LOG_PAGINA_T;
+
+_Static_assert(sizeof(FLASH_LOG_CABECALHO) == 16, "cabeçalho do log mudou de tamanho");
+_Static_assert(sizeof(FLASH_LOG_REGISTRO) == 12, "registro do log mudou de tamanho");
+_Static_assert(sizeof(FLASH_LOG_PAGINA_T) == FLASH_LOG_PAGINA, "a página do log deve ocupar uma página da flash");
+
+// Setor do índice sem nenhuma página válida
+#define FLASH_LOG_SEM_TEMPO 0xFFFFFFFFu
+
+static const FLASH_LOG_OPS *log_ops;
+static uint32_t n_setores;
+static uint32_t n_paginas;
+static uint32_t posicao;            // Próxima página a programar
+static uint32_t ultimo_seq;         // Seq da última página gravada (0 = nenhuma)
+static uint16_t boot;
+static uint32_t relogio_base;       // flash_log_agora() = relogio_base + uptime
+
+// Índice esparso: tempo do primeiro registro de cada setor. Como a região é escrita em
+// ordem, os setores lidos a partir do mais antigo têm tempos crescentes.
+static uint32_t indice[FLASH_LOG_SETORES_MAX];
+
+static FLASH_LOG_PAGINA_T buffer;
+static FLASH_LOG_STATS stats;
+
+// =================================================================================
+// PÁGINAS
+// =================================================================================
+
+/**
+ * @brief CRC-32 (o do zlib/Ethernet) com tabela de 16 entradas: meio byte por passo.
+ */
+static uint32_t flash_log_crc(uint32_t crc, const uint8_t *p, size_t len) {
+    static const uint32_t tabela[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    while (len--) {
+        crc = tabela[(crc ^ *p) & 0x0F] ^ (crc >> 4);
+        crc = tabela[(crc ^ (*p++ >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+/**
+ * @brief CRC de uma página inteira, com o campo crc do cabeçalho contado como zero.
+ */
+static uint32_t flash_log_crc_pagina(const uint8_t *pagina) {
+    static const uint8_t zero[sizeof(uint32_t)];
+    size_t off_crc = offsetof(FLASH_LOG_CABECALHO, crc);
+    uint32_t crc = flash_log_crc(0, pagina, off_crc);
+    crc = flash_log_crc(crc, zero, sizeof(zero));
+    return flash_log_crc(crc, pagina + off_crc + sizeof(zero), FLASH_LOG_PAGINA - off_crc - sizeof(zero));
+}
+
+static const uint8_t *flash_log_endereco(uint32_t pagina) {
+    return log_ops->base + pagina * FLASH_LOG_PAGINA;
+}
+
+static const FLASH_LOG_CABECALHO *flash_log_cabecalho(uint32_t pagina) {
+    return (const FLASH_LOG_CABECALHO *)flash_log_endereco(pagina);
+}
+
+static const FLASH_LOG_REGISTRO *flash_log_registros(uint32_t pagina) {
+    return (const FLASH_LOG_REGISTRO *)(flash_log_endereco(pagina) + sizeof(FLASH_LOG_CABECALHO));
+}
+
+static bool flash_log_pagina_valida(uint32_t pagina) {
+    const FLASH_LOG_CABECALHO *c = flash_log_cabecalho(pagina);
+    return c->magic == FLASH_LOG_MAGIC && c->seq != 0 && c->seq != 0xFFFFFFFFu &&
+           c->n_registros >= 1 && c->n_registros <= FLASH_LOG_REGISTROS_POR_PAGINA &&
+           c->crc == flash_log_crc_pagina(flash_log_endereco(pagina));
+}
+
+static bool flash_log_pagina_apagada(uint32_t pagina) {
+    const uint32_t *p = (const uint32_t *)flash_log_endereco(pagina);
+    for (size_t i = 0; i < FLASH_LOG_PAGINA / sizeof(uint32_t); i++) {
+        if (p[i] != 0xFFFFFFFFu) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// =================================================================================
+// ESCRITA
+// =================================================================================
+
+void flash_log_iniciar(const FLASH_LOG_OPS *ops, uint32_t uptime_s) {
+    log_ops = NULL;
+    posicao = 0;
+    ultimo_seq = 0;
+    boot = 0;
+    relogio_base = 0;
+    buffer.cabecalho.n_registros = 0;
+    memset(&stats, 0, sizeof(stats));
+    if (!ops || ops->tamanho < 2 * FLASH_LOG_SETOR) {
+        return;
+    }
+    log_ops = ops;
+    n_setores = ops->tamanho / FLASH_LOG_SETOR;
+    if (n_setores > FLASH_LOG_SETORES_MAX) {
+        n_setores = FLASH_LOG_SETORES_MAX;
+    }
+    n_paginas = n_setores * FLASH_LOG_PAGINAS_POR_SETOR;
+
+    // Uma passada pela região: índice de cada setor e a página mais recente
+    uint32_t cabeca = 0;
+    for (uint32_t s = 0; s < n_setores; s++) {
+        indice[s] = FLASH_LOG_SEM_TEMPO;
+        for (uint32_t p = s * FLASH_LOG_PAGINAS_POR_SETOR; p < (s + 1) * FLASH_LOG_PAGINAS_POR_SETOR; p++) {
+            if (!flash_log_pagina_valida(p)) {
+                if (!flash_log_pagina_apagada(p)) {
+                    stats.paginas_invalidas++;
+                }
+                continue;
+            }
+            if (indice[s] == FLASH_LOG_SEM_TEMPO) {
+                indice[s] = flash_log_registros(p)[0].tempo_s;
+            }
+            if (flash_log_cabecalho(p)->seq > ultimo_seq) {
+                ultimo_seq = flash_log_cabecalho(p)->seq;
+                cabeca = p;
+            }
+        }
+    }
+
+    if (ultimo_seq != 0) {
+        const FLASH_LOG_CABECALHO *c = flash_log_cabecalho(cabeca);
+        boot = c->boot + 1;
+        // O relógio continua um segundo depois do último registro gravado
+        relogio_base = flash_log_registros(cabeca)[c->n_registros - 1].tempo_s + 1 - uptime_s;
+        // Continua na página seguinte, pulando as gravadas pela metade no mesmo setor.
+        // Ao cruzar para outro setor ele é apagado antes da primeira gravação.
+        posicao = cabeca + 1;
+        while (posicao % FLASH_LOG_PAGINAS_POR_SETOR != 0 && !flash_log_pagina_apagada(posicao)) {
+            posicao++;
+        }
+        posicao %= n_paginas;
+    } else {
+        relogio_base = 0 - uptime_s;
+    }
+    stats.boot = boot;
+}
+
+uint32_t flash_log_agora(uint32_t uptime_s) {
+    return relogio_base + uptime_s;
+}
+
+void flash_log_acrescentar(uint32_t uptime_s, const HIST_REGISTRO *valores) {
+    if (!log_ops) {
+        return;
+    }
+    FLASH_LOG_REGISTRO *r = &buffer.registros[buffer.cabecalho.n_registros++];
+    r->tempo_s = flash_log_agora(uptime_s);
+    r->valores = *valores;
+    if (buffer.cabecalho.n_registros == FLASH_LOG_REGISTROS_POR_PAGINA) {
+        flash_log_descarregar();
+    }
+}
+
+void flash_log_descarregar(void) {
+    uint16_t n = buffer.cabecalho.n_registros;
+    if (!log_ops || n == 0) {
+        return;
+    }
+    uint32_t setor = posicao / FLASH_LOG_PAGINAS_POR_SETOR;
+    if (posicao % FLASH_LOG_PAGINAS_POR_SETOR == 0) {
+        // Primeira página do setor: descarta o setor mais antigo
+        log_ops->apagar_setor(setor * FLASH_LOG_SETOR);
+        indice[setor] = FLASH_LOG_SEM_TEMPO;
+        stats.setores_apagados++;
+    }
+
+    // Registros não usados ficam em 0xFF, como a flash apagada
+    memset(&buffer.registros[n], 0xFF, (FLASH_LOG_REGISTROS_POR_PAGINA - n) * sizeof(FLASH_LOG_REGISTRO));
+    buffer.cabecalho.magic = FLASH_LOG_MAGIC;
+    buffer.cabecalho.seq = ++ultimo_seq;
+    buffer.cabecalho.boot = boot;
+    buffer.cabecalho.crc = 0;
+    buffer.cabecalho.crc = flash_log_crc_pagina((const uint8_t *)&buffer);
+    log_ops->programar_pagina(posicao * FLASH_LOG_PAGINA, (const uint8_t *)&buffer);
+
+    if (indice[setor] == FLASH_LOG_SEM_TEMPO) {
+        indice[setor] = buffer.registros[0].tempo_s;
+    }
+    posicao = (posicao + 1) % n_paginas;
+    buffer.cabecalho.n_registros = 0;
+    stats.paginas_gravadas++;
+}
+
+// =================================================================================
+// CONSULTA
+// =================================================================================
+
+void flash_log_buscar(FLASH_LOG_CURSOR *cursor, uint32_t de, uint32_t ate) {
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->de = de;
+    cursor->ate = ate;
+    cursor->seq_max = ultimo_seq;
+    if (!log_ops || ultimo_seq == 0 || de > ate) {
+        cursor->concluido = true;
+        return;
+    }
+
+    // Setores do mais antigo para o mais recente. Com a posição de escrita no início de
+    // um setor, ele é o mais antigo (o próximo a ser apagado); no meio, ele tem as
+    // páginas mais recentes e o mais antigo é o seguinte.
+    uint32_t setor_escrita = posicao / FLASH_LOG_PAGINAS_POR_SETOR;
+    uint32_t primeiro = (posicao % FLASH_LOG_PAGINAS_POR_SETOR == 0) ? setor_escrita : setor_escrita + 1;
+
+    // Busca binária pelo primeiro setor que começa depois de `de`; a consulta começa no
+    // anterior a ele. Setores sem páginas válidas (ainda não gravados) contam como antigos.
+    uint32_t lo = 0, hi = n_setores;
+    while (lo < hi) {
+        uint32_t meio = lo + (hi - lo) / 2;
+        uint32_t t = indice[(primeiro + meio) % n_setores];
+        if (t != FLASH_LOG_SEM_TEMPO && t > de) {
+            hi = meio;
+        } else {
+            lo = meio + 1;
+        }
+    }
+    uint32_t k = lo > 0 ? lo - 1 : 0;
+    cursor->pagina = ((primeiro + k) % n_setores) * FLASH_LOG_PAGINAS_POR_SETOR;
+    cursor->restantes = (posicao + n_paginas - cursor->pagina) % n_paginas;
+    if (cursor->restantes == 0) {
+        cursor->restantes = n_paginas;  // Começa no setor que será apagado: a região inteira
+    }
+}
+
+static void flash_log_proxima_pagina(FLASH_LOG_CURSOR *cursor) {
+    cursor->pagina = (cursor->pagina + 1) % n_paginas;
+    cursor->restantes--;
+    cursor->seq_pagina = 0;
+    cursor->registro = 0;
+}
+
+bool flash_log_ler(FLASH_LOG_CURSOR *cursor, FLASH_LOG_REGISTRO *registro) {
+    while (!cursor->concluido) {
+        if (cursor->restantes == 0) {
+            cursor->concluido = true;
+            break;
+        }
+        const FLASH_LOG_CABECALHO *c = flash_log_cabecalho(cursor->pagina);
+        if (cursor->seq_pagina == 0) {
+            // Página nova: valida o CRC uma vez. Páginas gravadas depois do início da
+            // consulta (o setor mais antigo foi reciclado) ficam de fora.
+            if (!flash_log_pagina_valida(cursor->pagina) || c->seq > cursor->seq_max) {
+                flash_log_proxima_pagina(cursor);
+                continue;
+            }
+            cursor->seq_pagina = c->seq;
+        }
+        if (cursor->registro >= c->n_registros) {
+            flash_log_proxima_pagina(cursor);
+            continue;
+        }
+        memcpy(registro, &flash_log_registros(cursor->pagina)[cursor->registro], sizeof(*registro));
+        if (c->magic != FLASH_LOG_MAGIC || c->seq != cursor->seq_pagina) {
+            // O setor foi apagado entre a validação e a cópia
+            flash_log_proxima_pagina(cursor);
+            continue;
+        }
+        if (registro->tempo_s < cursor->de) {
+            cursor->registro++;
+            continue;
+        }
+        if (registro->tempo_s > cursor->ate) {
+            cursor->concluido = true;
+            break;
+        }
+        return true;
+    }
+    return false;
+}
+
+void flash_log_avancar(FLASH_LOG_CURSOR *cursor) {
+    cursor->registro++;
+}
+
+void flash_log_get_stats(FLASH_LOG_STATS *s) {
+    *s = stats;
+    s->ultimo_seq = ultimo_seq;
+}
@@ -0,0 +1,51 @@
+// Ficheiro: flash_log_pico.c
+// Região do log (flash_log.c) na flash QSPI do Pico: o último FLASH_LOG_TAMANHO da flash,
+// lido pelo XIP e gravado com as funções da ROM do RP2040.
+
+#include "flash_log.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+// 1 MB no fim da flash de 2 MB: ~45 h de leituras a cada 2 s
+#define FLASH_LOG_TAMANHO   (1024 * 1024)
+#define FLASH_LOG_OFFSET    (PICO_FLASH_SIZE_BYTES - FLASH_LOG_TAMANHO)
+
+_Static_assert(FLASH_LOG_TAMANHO / FLASH_LOG_SETOR <= FLASH_LOG_SETORES_MAX, "aumente FLASH_LOG_SETORES_MAX");
+
+// Fim do programa gravado, definido pelo linker script do Pico SDK
+extern char __flash_binary_end;
+
+// Enquanto a flash é apagada ou programada o XIP fica indisponível: nada pode rodar da
+// flash, então as interrupções (e com elas o escalonador) ficam desligadas. Programar uma
+// página leva ~1 ms; apagar um setor ~50 ms, uma vez a cada 16 páginas (~11 min).
+
+static void pico_apagar_setor(uint32_t offset) {
+    uint32_t irq = save_and_disable_interrupts();
+    flash_range_erase(FLASH_LOG_OFFSET + offset, FLASH_LOG_SETOR);
+    restore_interrupts(irq);
+}
+
+static void pico_programar_pagina(uint32_t offset, const uint8_t *dados) {
+    uint32_t irq = save_and_disable_interrupts();
+    flash_range_program(FLASH_LOG_OFFSET + offset, dados, FLASH_LOG_PAGINA);
+    restore_interrupts(irq);
+}
+
+static const FLASH_LOG_OPS ops_pico = {
+    .base = (const uint8_t *)(XIP_BASE + FLASH_LOG_OFFSET),
+    .tamanho = FLASH_LOG_TAMANHO,
+    .apagar_setor = pico_apagar_setor,
+    .programar_pagina = pico_programar_pagina,
+};
+
+const FLASH_LOG_OPS *flash_log_regiao(void) {
+    uint32_t fim_programa = (uint32_t)((uintptr_t)&__flash_binary_end - XIP_BASE);
+    if (fim_programa > FLASH_LOG_OFFSET) {
+        printf("Log em flash desativado: o programa (%lu bytes) invade a região do log\n",
+               (unsigned long)fim_programa);
+        return NULL;
+    }
+    return &ops_pico;
+}
@@ -0,0 +1,117 @@
+// Ficheiro: fmt_num.c
+// Formatação de números sem o printf de ponto flutuante. O float é decomposto em
+// mantissa e expoente e escalado por 10^casas em aritmética inteira, o que dá o valor
+// exato antes do arredondamento; os dígitos saem por divisões de 32 bits (que no
+// RP2040 usam o divisor de hardware do SIO) sempre que o número cabe nessa faixa.
+
+#include "fmt_num.h"
+
+static const uint32_t FMT_POT10[FMT_CASAS_MAX + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+/**
+ * @brief Escreve os dígitos de v, com zeros à esquerda até completar min_digitos.
+ */
+static char *fmt_u32(char *p, uint32_t v, uint8_t min_digitos) {
+    char tmp[10];
+    uint8_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v || n < min_digitos);
+    while (n) {
+        *p++ = tmp[--n];
+    }
+    return p;
+}
+
+static char *fmt_u64(char *p, uint64_t v) {
+    if (v <= UINT32_MAX) {
+        return fmt_u32(p, (uint32_t)v, 1);
+    }
+    // Parte alta primeiro; os 9 dígitos baixos saem com zeros à esquerda
+    p = fmt_u64(p, v / 1000000000u);
+    return fmt_u32(p, (uint32_t)(v % 1000000000u), 9);
+}
+
+char *fmt_fixo(char *p, float v, uint8_t casas) {
+    union { float f; uint32_t u; } bits = { .f = v };
+    uint32_t expoente = (bits.u >> 23) & 0xFF;
+    uint32_t mantissa = bits.u & 0x7FFFFF;
+    if (casas > FMT_CASAS_MAX) {
+        casas = FMT_CASAS_MAX;
+    }
+
+    if (bits.u >> 31) {
+        *p++ = '-';
+    }
+    if (expoente == 0xFF) {
+        return fmt_texto(p, mantissa ? "nan" : "inf");
+    }
+
+    // v = mantissa * 2^e
+    int32_t e;
+    if (expoente == 0) {
+        e = -149;  // Subnormal
+    } else {
+        mantissa |= 0x800000;
+        e = (int32_t)expoente - 150;
+    }
+
+    uint64_t inteiro;
+    uint32_t fracao = 0;
+    if (e >= 0) {
+        // Valor inteiro: não há o que arredondar
+        inteiro = e <= 39 ? (uint64_t)mantissa << e : UINT64_MAX >> 1;
+    } else {
+        // q = mantissa * 10^casas / 2^-e, arredondado para o par mais próximo no empate.
+        // mantissa * 10^casas < 2^44, então o produto é exato em 64 bits.
+        uint64_t escalado = (uint64_t)mantissa * FMT_POT10[casas];
+        uint32_t s = (uint32_t)-e;
+        uint64_t q = 0;
+        if (s < 64) {
+            q = escalado >> s;
+            uint64_t resto = escalado & ((1ull << s) - 1);
+            uint64_t metade = 1ull << (s - 1);
+            if (resto > metade || (resto == metade && (q & 1))) {
+                q++;
+            }
+        }
+        if (q <= UINT32_MAX) {
+            inteiro = (uint32_t)q / FMT_POT10[casas];
+            fracao = (uint32_t)q % FMT_POT10[casas];
+        } else {
+            inteiro = q / FMT_POT10[casas];
+            fracao = (uint32_t)(q % FMT_POT10[casas]);
+        }
+    }
+
+    p = fmt_u64(p, inteiro);
+    if (casas > 0) {
+        *p++ = '.';
+        p = fmt_u32(p, fracao, casas);
+    }
+    *p = '\0';
+    return p;
+}
+
+char *fmt_int(char *p, int32_t v) {
+    uint32_t modulo = (uint32_t)v;
+    if (v < 0) {
+        *p++ = '-';
+        modulo = 0u - modulo;
+    }
+    return fmt_uint(p, modulo);
+}
+
+char *fmt_uint(char *p, uint32_t v) {
+    p = fmt_u32(p, v, 1);
+    *p = '\0';
+    return p;
+}
+
+char *fmt_texto(char *p, const char *s) {
+    while ((*p = *s++) != '\0') {
+        p++;
+    }
+    return p;
+}
@@ -5,85 +5,391 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
+#include "i2c_dma.h"
+#include "pico/sync.h"
 #include "aht20.h"      // Biblioteca do seu sensor de umidade/temperatura
 #include "bmp280.h"     // Biblioteca do seu sensor de pressão/temperatura
+#include "altitude.h"
+#include "flash_log.h"
 #include <math.h>
+#include <stdatomic.h>
 
 // --- Definições do Hardware ---
 #define I2C_PORT i2c0
 #define I2C_SDA_PIN 0
 #define I2C_SCL_PIN 1
-#define SEA_LEVEL_PRESSURE 101325.0 // Pressão ao nível do mar em Pa
 // --- Variáveis de Estado Globais (visíveis apenas neste ficheiro) ---
 
-// Estrutura que armazena todos os dados e configurações.
-// 'static' garante que esta variável só pode ser acessada pelas funções deste ficheiro.
-static SENSOR_DATA g_sensor_data;
+// Configuração atual e sua versão, lidas e gravadas inteiras sob config_lock. Seção
+// crítica (e não mutex do FreeRTOS) porque a configuração também é lida e gravada pelos
+// callbacks da lwIP, fora das tarefas.
+static CONFIG_ESTACAO config_atual;
+static uint32_t config_versao;
+static critical_section_t config_lock;
 
 // Parâmetros de calibração do BMP280, lidos uma vez na inicialização.
 static struct bmp280_calib_param bmp_params;
 
+// Perfil configurado no sensor. Só a tarefa dos sensores altera; get_perfil_bmp280 lê
+// de qualquer tarefa.
+static _Atomic uint8_t bmp_perfil = BMP280_PERFIL_PADRAO;
+// A conversão do BMP280 desta leitura foi disparada (sempre, no modo normal)
+static bool bmp_disparado;
+
+// Conversão do AHT20 entre as duas fases da leitura. Só a tarefa dos sensores usa.
+static enum {
+    AHT_OCIOSO,     // Nenhuma conversão disparada (ou o disparo falhou)
+    AHT_MEDINDO,    // Disparada em ler_sensores_iniciar
+    AHT_ATRASADO    // Ainda ocupada na coleta: será coletada no próximo ciclo
+} aht_estado;
+
+// =================================================================================
+// PUBLICAÇÃO DAS LEITURAS
+// =================================================================================
+// Só a tarefa dos sensores grava as leituras. Cada amostra é montada numa cópia privada
+// e publicada de uma vez em uma de duas posições: a tarefa grava sempre a posição que
+// não está publicada e então incrementa leitura_versao (a publicada é a de índice
+// versao & 1). Quem lê copia a posição publicada e confere que a versão não mudou
+// durante a cópia; se mudou, a posição pode ter sido regravada e a cópia é refeita.
+// Ninguém bloqueia a tarefa dos sensores, e um leitor de prioridade maior que a
+// interrompa no meio de uma gravação lê a outra posição, intacta, sem esperar por ela.
+
+typedef struct {
+    float temperatura_bmp;
+    float umidade_aht;
+    float pressao_hpa;
+    float altitude;
+    uint32_t seq;
+    uint32_t timestamp_ms;
+    uint32_t erros_i2c;
+    uint32_t falhas[N_SENSORES];
+    uint32_t desatualizadas[N_SENSORES];
+} LEITURA;
+
+static LEITURA leituras[2];
+static _Atomic uint32_t leitura_versao;
+
+/**
+ * @brief Copia a leitura publicada, refazendo a cópia se uma publicação a atravessou.
+ */
+static void leitura_copiar(LEITURA *leitura) {
+    uint32_t versao;
+    do {
+        versao = atomic_load_explicit(&leitura_versao, memory_order_acquire);
+        *leitura = leituras[versao & 1];
+        atomic_thread_fence(memory_order_acquire);
+    } while (atomic_load_explicit(&leitura_versao, memory_order_relaxed) != versao);
+}
+
+/**
+ * @brief Publica uma leitura completa. Só a tarefa dos sensores chama.
+ */
+static void leitura_publicar(const LEITURA *leitura) {
+    uint32_t versao = atomic_load_explicit(&leitura_versao, memory_order_relaxed);
+    // Um leitor atrasado ainda pode estar copiando a posição livre (publicada na versão
+    // anterior): a barreira garante que ele veja a versão atual antes de qualquer byte
+    // novo nela, e refaça a cópia
+    atomic_thread_fence(memory_order_seq_cst);
+    leituras[(versao + 1) & 1] = *leitura;
+    atomic_store_explicit(&leitura_versao, versao + 1, memory_order_release);
+}
+
+// =================================================================================
+// HISTÓRICO
+// =================================================================================
+// Anel de HIST_LEN registros: a amostra seq ocupa a posição seq % HIST_LEN. Uma leitura
+// nova sobrescreve a mais antiga e a busca por seq é um índice direto, ambas O(1) com
+// qualquer profundidade. Os valores ficam em ponto fixo, 8 bytes por amostra (14,4 KB
+// com o HIST_LEN padrão, metade do que ocupariam em float).
+
+_Static_assert(HIST_LEN >= 1 && HIST_LEN < UINT16_MAX,
+               "HIST_LEN precisa caber nos contadores de 16 bits do JSON e de /dados.bin");
+
+static HIST_REGISTRO hist[HIST_LEN];
+// Sequência da amostra mais recente do anel. Avança antes da publicação da leitura, então
+// a seq de qualquer retrato já está no histórico.
+static uint32_t hist_ultima;
+
+// Protege o anel e hist_ultima: quem lê uma amostra nunca a vê pela metade nem recebe
+// uma mais nova que ocupou a mesma posição
+static critical_section_t hist_lock;
+
+/**
+ * @brief Converte para ponto fixo com arredondamento, saturando em [min, max].
+ */
+static int32_t hist_fixo(float valor, float escala, int32_t min, int32_t max) {
+    float v = valor * escala;
+    v += (v < 0) ? -0.5f : 0.5f;
+    if (v <= (float)min) return min;
+    if (v >= (float)max) return max;
+    return (int32_t)v;
+}
+
+/**
+ * @brief Copia os campos de um registro para um array indexado por GRANDEZA_*, nas
+ * unidades do ponto fixo (a pressão continua relativa a HIST_PRESSAO_BASE).
+ */
+static void hist_unidades(const HIST_REGISTRO *r, int32_t v[N_GRANDEZAS]) {
+    v[GRANDEZA_TEMP] = r->temperatura;
+    v[GRANDEZA_UMID] = r->umidade;
+    v[GRANDEZA_PRESS] = r->pressao;
+    v[GRANDEZA_ALT] = r->altitude;
+}
+
+static void hist_de_unidades(HIST_REGISTRO *r, const int32_t v[N_GRANDEZAS]) {
+    r->temperatura = (int16_t)v[GRANDEZA_TEMP];
+    r->umidade = (uint16_t)v[GRANDEZA_UMID];
+    r->pressao = (uint16_t)v[GRANDEZA_PRESS];
+    r->altitude = (int16_t)v[GRANDEZA_ALT];
+}
+
+/**
+ * @brief Converte um valor em ponto fixo de volta para a unidade da grandeza.
+ */
+static float hist_valor(int grandeza, int32_t unidades) {
+    switch (grandeza) {
+        case GRANDEZA_PRESS: return HIST_PRESSAO_BASE + unidades / HIST_PRESSAO_ESCALA;
+        case GRANDEZA_ALT:   return unidades / HIST_ALTITUDE_ESCALA;
+        default:             return unidades / 100.0f;
+    }
+}
+
+// =================================================================================
+// HISTÓRICO AGREGADO
+// =================================================================================
+// Cada nível resume as leituras em intervalos de duração fixa (mínimo, média e máximo),
+// contados a partir do boot. O intervalo em andamento é acumulado em agreg_abertos; ao
+// virar o intervalo ele é fechado num anel por nível, na posição numero % capacidade.
+// Todos os níveis recebem cada leitura direto (as médias são exatas, sem média de
+// médias), com custo fixo por leitura: O(AGREG_NIVEIS).
+
+typedef struct {
+    uint32_t periodo_s;     // Duração de cada intervalo
+    uint16_t capacidade;    // Intervalos fechados guardados
+    uint16_t inicio;        // Posição do anel do nível em agreg_registros
+} AGREG_NIVEL;
+
+#define AGREG_CAP_1MIN      (6 * 60)        // 6 h
+#define AGREG_CAP_15MIN     (3 * 24 * 4)    // 3 dias
+#define AGREG_CAP_1H        (30 * 24)       // 30 dias
+
+static const AGREG_NIVEL agreg_niveis[AGREG_NIVEIS] = {
+    { 60,      AGREG_CAP_1MIN,  0 },
+    { 15 * 60, AGREG_CAP_15MIN, AGREG_CAP_1MIN },
+    { 60 * 60, AGREG_CAP_1H,    AGREG_CAP_1MIN + AGREG_CAP_15MIN },
+};
+
+// Intervalo fechado: 32 bytes, 43,8 KB nos três níveis
+typedef struct {
+    uint32_t numero;        // Intervalo guardado nesta posição
+    uint16_t amostras;      // 0 = posição vazia (saturado em UINT16_MAX)
+    HIST_REGISTRO min;
+    HIST_REGISTRO media;
+    HIST_REGISTRO max;
+} AGREG_REGISTRO;
+
+// Intervalo em andamento, em unidades do ponto fixo de HIST_REGISTRO
+typedef struct {
+    uint32_t numero;
+    uint32_t amostras;      // 0 = nenhum intervalo aberto
+    int32_t min[N_GRANDEZAS];
+    int32_t max[N_GRANDEZAS];
+    int64_t soma[N_GRANDEZAS];
+} AGREG_ABERTO;
+
+static AGREG_REGISTRO agreg_registros[AGREG_CAP_1MIN + AGREG_CAP_15MIN + AGREG_CAP_1H];
+static AGREG_ABERTO agreg_abertos[AGREG_NIVEIS];
+
+/**
+ * @brief Média arredondada ao inteiro mais próximo.
+ */
+static int32_t agreg_media(int64_t soma, uint32_t n) {
+    int64_t meio = n / 2;
+    return (int32_t)((soma >= 0 ? soma + meio : soma - meio) / (int64_t)n);
+}
+
+/**
+ * @brief Grava o intervalo em andamento de um nível no anel e o encerra.
+ */
+static void agreg_fechar(const AGREG_NIVEL *nivel, AGREG_ABERTO *a) {
+    AGREG_REGISTRO *r = &agreg_registros[nivel->inicio + a->numero % nivel->capacidade];
+    int32_t media[N_GRANDEZAS];
+    for (int g = 0; g < N_GRANDEZAS; g++) {
+        media[g] = agreg_media(a->soma[g], a->amostras);
+    }
+    r->numero = a->numero;
+    r->amostras = a->amostras > UINT16_MAX ? UINT16_MAX : (uint16_t)a->amostras;
+    hist_de_unidades(&r->min, a->min);
+    hist_de_unidades(&r->media, media);
+    hist_de_unidades(&r->max, a->max);
+    a->amostras = 0;
+}
+
+/**
+ * @brief Soma uma leitura, feita em `tempo_s`, ao intervalo em andamento de cada nível.
+ * Chamada com hist_lock.
+ */
+static void agreg_acrescentar(uint32_t tempo_s, const HIST_REGISTRO *leitura) {
+    int32_t v[N_GRANDEZAS];
+    hist_unidades(leitura, v);
+    for (int n = 0; n < AGREG_NIVEIS; n++) {
+        const AGREG_NIVEL *nivel = &agreg_niveis[n];
+        AGREG_ABERTO *a = &agreg_abertos[n];
+        uint32_t numero = tempo_s / nivel->periodo_s;
+        if (a->amostras > 0 && a->numero != numero) {
+            agreg_fechar(nivel, a);
+        }
+        if (a->amostras == 0) {
+            a->numero = numero;
+            for (int g = 0; g < N_GRANDEZAS; g++) {
+                a->min[g] = a->max[g] = v[g];
+                a->soma[g] = 0;
+            }
+        }
+        for (int g = 0; g < N_GRANDEZAS; g++) {
+            if (v[g] < a->min[g]) a->min[g] = v[g];
+            if (v[g] > a->max[g]) a->max[g] = v[g];
+            a->soma[g] += v[g];
+        }
+        a->amostras++;
+    }
+}
+
+/**
+ * @brief Acrescenta uma leitura ao histórico com o próximo número de sequência, que é
+ * anotado nela junto com o momento da amostra.
+ */
+static void hist_gravar(LEITURA *d) {
+    HIST_REGISTRO r;
+    r.temperatura = (int16_t)hist_fixo(d->temperatura_bmp, 100.0f, INT16_MIN, INT16_MAX);
+    r.umidade = (uint16_t)hist_fixo(d->umidade_aht, 100.0f, 0, UINT16_MAX);
+    r.pressao = (uint16_t)hist_fixo(d->pressao_hpa - HIST_PRESSAO_BASE, HIST_PRESSAO_ESCALA, 0, UINT16_MAX);
+    r.altitude = (int16_t)hist_fixo(d->altitude, HIST_ALTITUDE_ESCALA, INT16_MIN, INT16_MAX);
+    absolute_time_t agora = get_absolute_time();
+    uint32_t agora_s = (uint32_t)(to_us_since_boot(agora) / 1000000u);
+
+    critical_section_enter_blocking(&hist_lock);
+    uint32_t seq = ++hist_ultima;
+    hist[seq % HIST_LEN] = r;
+    agreg_acrescentar(agora_s, &r);
+    critical_section_exit(&hist_lock);
+
+    // Numera a nova amostra (usado por /dados_sensores?since=<seq>)
+    d->seq = seq;
+    d->timestamp_ms = to_ms_since_boot(agora);
+
+    // Fora da seção crítica: a cada 20 leituras a página vai para a flash
+    flash_log_acrescentar(agora_s, &r);
+}
+
+uint32_t ler_sensores_iniciar(void) {
+    critical_section_enter_blocking(&config_lock);
+    bmp280_perfil_t pedido = (bmp280_perfil_t)config_atual.perfil_bmp280;
+    critical_section_exit(&config_lock);
+    bmp280_perfil_t perfil = (bmp280_perfil_t)atomic_load(&bmp_perfil);
+    if (pedido != perfil && bmp280_configurar(I2C_PORT, pedido)) {
+        perfil = pedido;
+        atomic_store(&bmp_perfil, (uint8_t)perfil);
+    }
+
+    // As duas conversões correm ao mesmo tempo: a espera é a do sensor mais lento
+    bmp_disparado = bmp280_disparar(I2C_PORT, perfil);
+    if (aht_estado == AHT_OCIOSO && aht20_disparar(I2C_PORT)) {
+        aht_estado = AHT_MEDINDO;
+    }
+    uint32_t espera_ms = bmp280_tempo_conversao_ms(perfil);
+    return espera_ms > AHT20_CONVERSAO_MS ? espera_ms : AHT20_CONVERSAO_MS;
+}
+
 /**
- * @brief Callback chamado periodicamente pelo timer.
- * * Esta função é o núcleo da coleta de dados. Ela lê os valores brutos dos sensores,
- * aplica as conversões e os offsets de calibração, e atualiza a estrutura de dados global.
- * Também preenche o histórico de dados para o gráfico.
- * * @param t Ponteiro para a estrutura do timer (não utilizado aqui).
- * @return true para manter o timer agendado.
+ * @brief Coleta das conversões disparadas por ler_sensores_iniciar.
+ * * Lê os valores brutos dos sensores, aplica as conversões e os offsets de calibração,
+ * grava a amostra no histórico e a publica.
  */
-void ler_sensores() { // struct repeating_timer *t
+void ler_sensores_concluir(void) {
+    CONFIG_ESTACAO cfg;
+    get_config(&cfg);
+
+    // A nova amostra parte da anterior e só é publicada inteira, no fim
+    LEITURA leitura;
+    leitura_copiar(&leitura);
+
     // --- Leitura do Sensor BMP280 ---
+    // Em caso de falha no I2C os valores anteriores são mantidos. Sem o disparo, os
+    // registradores ainda teriam a conversão anterior.
     int32_t raw_temp_bmp, raw_pressure;
-    bmp280_read_raw(I2C_PORT, &raw_temp_bmp, &raw_pressure); 
-    
-    // Converte os valores brutos para unidades legíveis
-    int32_t temp_converted = bmp280_convert_temp(raw_temp_bmp, &bmp_params); 
-    int32_t press_converted = bmp280_convert_pressure(raw_pressure, raw_temp_bmp, &bmp_params); 
-
-    // // Aplica os offsets de calibração e armazena na estrutura global
-    // g_sensor_data.temperatura_bmp = (temp_converted / 100.0f) + g_sensor_data.offset_temp; 
-    // g_sensor_data.pressao_hpa = (press_converted / 100.0f) + g_sensor_data.offset_press; 
-
-    // // Calcula a altitude
-    // g_sensor_data.altitude = 44330.0 * (1.0 - pow(press_converted / SEA_LEVEL_PRESSURE, 0.1903)); 
-
-    // // --- Leitura do Sensor AHT20 ---
-    // AHT20_Data aht_data; 
-    // if (aht20_read(I2C_PORT, &aht_data)) { 
-    //     g_sensor_data.umidade_aht = aht_data.humidity; 
-    // } else {
-    //     printf("Erro na leitura do AHT20!\n"); 
-    // }
-
-    // [ATUALIZADO] Aplica todos os offsets
-    g_sensor_data.temperatura_bmp = (temp_converted / 100.0f) + g_sensor_data.offset_temp;
-    g_sensor_data.pressao_hpa = (press_converted / 100.0f) + g_sensor_data.offset_press;
-    double altitude_calculada = 44330.0 * (1.0 - pow(press_converted / SEA_LEVEL_PRESSURE, 0.1903));
-    g_sensor_data.altitude = altitude_calculada + g_sensor_data.offset_alt; // APLICA OFFSET DE ALTITUDE
+    bmp280_compensado_t bmp;
+    if (bmp_disparado && bmp280_read_raw(I2C_PORT, &raw_temp_bmp, &raw_pressure) &&
+        bmp280_compensar(raw_temp_bmp, raw_pressure, &bmp_params, BMP280_PRESSAO_64BITS, &bmp)) {
+        // Converte os valores compensados para unidades legíveis
+        float press_pa = bmp.pressao_q8 / 256.0f;
+
+        leitura.temperatura_bmp = (bmp.temperatura / 100.0f) + cfg.offset_temp;
+        leitura.pressao_hpa = (press_pa / 100.0f) + cfg.offset_press;
+        uint32_t referencia_pa = (uint32_t)(cfg.pressao_nivel_mar * 100.0f + 0.5f);
+        leitura.altitude = altitude_cm(bmp.pressao_q8, referencia_pa) / 100.0f + cfg.offset_alt; // APLICA OFFSET DE ALTITUDE
+    } else {
+        leitura.erros_i2c++;
+        leitura.falhas[SENSOR_BMP280]++;
+        leitura.desatualizadas[SENSOR_BMP280]++;
+    }
 
     // --- Leitura do Sensor AHT20 ---
     AHT20_Data aht_data;
-    if (aht20_read(I2C_PORT, &aht_data)) {
-        g_sensor_data.umidade_aht = aht_data.humidity + g_sensor_data.offset_umid; // APLICA OFFSET DE UMIDADE
+    AHT20_Resultado aht = aht_estado == AHT_OCIOSO ? AHT20_ERRO : aht20_coletar(I2C_PORT, &aht_data);
+    if (aht == AHT20_OCUPADO && aht_estado == AHT_ATRASADO) {
+        aht = AHT20_ERRO;   // Dois ciclos sem terminar: dispara de novo
+    }
+    if (aht == AHT20_PRONTO) {
+        leitura.umidade_aht = aht_data.humidity + cfg.offset_umid; // APLICA OFFSET DE UMIDADE
+        aht_estado = AHT_OCIOSO;
+    } else {
+        leitura.desatualizadas[SENSOR_AHT20]++;
+        if (aht == AHT20_OCUPADO) {
+            aht_estado = AHT_ATRASADO;
+        } else {
+            leitura.erros_i2c++;
+            leitura.falhas[SENSOR_AHT20]++;
+            aht_estado = AHT_OCIOSO;
+        }
     }
 
-    // =========================================================================
-    // --- [LÓGICA ALTERADA] Atualiza os Buffers de Histórico (Deslocamento) ---
-    // =========================================================================
+    // Grava a leitura no histórico, por cima da mais antiga, e a publica
+    hist_gravar(&leitura);
+    leitura_publicar(&leitura);
+}
 
-    // Desloca todos os valores existentes uma posição para a esquerda
-    for (int i = 0; i < 19; i++) {
-        g_sensor_data.hist_temp[i] = g_sensor_data.hist_temp[i + 1];
-        g_sensor_data.hist_umid[i] = g_sensor_data.hist_umid[i + 1];
-        g_sensor_data.hist_press[i] = g_sensor_data.hist_press[i + 1];
-        g_sensor_data.hist_alt[i] = g_sensor_data.hist_alt[i + 1];
-    }
+void ler_sensores() {
+    sleep_ms(ler_sensores_iniciar());
+    ler_sensores_concluir();
+}
 
-    // Adiciona os novos valores na última posição de cada array
-    g_sensor_data.hist_temp[19] = g_sensor_data.temperatura_bmp;
-    g_sensor_data.hist_umid[19] = g_sensor_data.umidade_aht;
-    g_sensor_data.hist_press[19] = g_sensor_data.pressao_hpa;
-    g_sensor_data.hist_alt[19] = g_sensor_data.altitude;
+/**
+ * @brief Inicializa os locks, o histórico vazio, o log na flash e a configuração padrão.
+ * Precede as tarefas: as callbacks da lwIP usam get_config/aplicar_config, o histórico
+ * (get_amostra, hist_primeira_seq) e o log assim que o servidor sobe, enquanto a tarefa
+ * dos sensores ainda espera o I2C e os sensores em init_sensor_manager.
+ */
+void init_global_manager(void) {
+    memset(leituras, 0, sizeof(leituras));
+    atomic_store(&leitura_versao, 0);
+    critical_section_init(&hist_lock);
+    hist_ultima = 0;
+    flash_log_iniciar(flash_log_regiao(), get_tempo_s());  // Lido por /log
+
+    critical_section_init(&config_lock);
+    config_versao = 0;
+    memset(&config_atual, 0, sizeof(config_atual));
+    config_atual.pressao_nivel_mar = ALTITUDE_REFERENCIA_PADRAO_PA / 100.0f;
+    config_atual.perfil_bmp280 = BMP280_PERFIL_PADRAO;
+    config_atual.limite_min_temp = 20; // Define um limite mínimo padrão
+    config_atual.limite_max_temp = 30; // Define um limite máximo padrão
+    config_atual.limite_min_umid = 40;
+    config_atual.limite_max_umid = 60;
+    config_atual.limite_min_press = 900;
+    config_atual.limite_max_press = 1100;
+    config_atual.limite_min_alt = -100;
+    config_atual.limite_max_alt = 1000;
 }
 
 /**
@@ -95,6 +401,7 @@ void ler_sensores() { // struct repeating_timer *t
 void init_sensor_manager(void) {
     // Inicializa o hardware I2C
     i2c_init(I2C_PORT, 400 * 1000); 
+    i2c_dma_iniciar(I2C_PORT, 32);  // Maior transação: calibração do BMP280 (1 + 24 bytes)
     gpio_set_function(I2C_SDA_PIN, GPIO_FUNC_I2C); 
     gpio_set_function(I2C_SCL_PIN, GPIO_FUNC_I2C); 
     gpio_pull_up(I2C_SDA_PIN); 
@@ -102,20 +409,11 @@ void init_sensor_manager(void) {
 
     // Inicializa os sensores
     bmp280_init(I2C_PORT); 
+    atomic_store(&bmp_perfil, BMP280_PERFIL_PADRAO);
     bmp280_get_calib_params(I2C_PORT, &bmp_params); 
     aht20_reset(I2C_PORT); 
     aht20_init(I2C_PORT); 
-    
-    // Zera os valores iniciais na estrutura de dados
-    memset(&g_sensor_data, 0, sizeof(SENSOR_DATA));
-    g_sensor_data.limite_min_temp = 20; // Define um limite mínimo padrão
-    g_sensor_data.limite_max_temp = 30; // Define um limite máximo padrão
-    g_sensor_data.limite_min_umid = 40;
-    g_sensor_data.limite_max_umid = 60;
-    g_sensor_data.limite_min_press = 900;
-    g_sensor_data.limite_max_press = 1100;
-    g_sensor_data.limite_min_alt = -100;
-    g_sensor_data.limite_max_alt = 1000;
+    aht_estado = AHT_OCIOSO;
 
     // Agenda o timer para chamar a função 'ler_sensores_callback' a cada 2000 ms (2 segundos)
     // static struct repeating_timer timer;
@@ -123,23 +421,201 @@ void init_sensor_manager(void) {
 }
 
 /**
- * @brief Retorna um ponteiro para a estrutura de dados dos sensores.
- * * O servidor web usará esta função para obter os dados mais recentes a serem enviados
- * para a interface web no formato JSON.
- * @return Ponteiro para a estrutura SENSOR_DATA global.
+ * @brief Copia os dados dos sensores e a configuração.
+ * * O servidor web e os displays usam esta função para obter os dados mais recentes; as
+ * leituras e a configuração vêm cada uma de uma só versão, sem travar a tarefa dos sensores.
  */
-SENSOR_DATA* get_sensor_data(void) {
-    return &g_sensor_data;
+void get_sensor_data(SENSOR_DATA *dados) {
+    LEITURA leitura;
+    leitura_copiar(&leitura);
+    dados->temperatura_bmp = leitura.temperatura_bmp;
+    dados->umidade_aht = leitura.umidade_aht;
+    dados->pressao_hpa = leitura.pressao_hpa;
+    dados->altitude = leitura.altitude;
+    dados->seq = leitura.seq;
+    dados->timestamp_ms = leitura.timestamp_ms;
+    dados->erros_i2c = leitura.erros_i2c;
+    memcpy(dados->falhas, leitura.falhas, sizeof(dados->falhas));
+    memcpy(dados->desatualizadas, leitura.desatualizadas, sizeof(dados->desatualizadas));
+
+    critical_section_enter_blocking(&config_lock);
+    dados->config = config_atual;
+    dados->config_versao = config_versao;
+    critical_section_exit(&config_lock);
+}
+
+uint8_t get_perfil_bmp280(void) {
+    return atomic_load(&bmp_perfil);
+}
+
+uint32_t get_ultima_seq(void) {
+    LEITURA leitura;
+    leitura_copiar(&leitura);
+    return leitura.seq;
+}
+
+uint8_t calcular_alertas(void) {
+    SENSOR_DATA d;
+    get_sensor_data(&d);
+    return calcular_alertas_dados(&d);
+}
+
+uint8_t calcular_alertas_dados(const SENSOR_DATA *d) {
+    const CONFIG_ESTACAO *cfg = &d->config;
+    uint8_t alertas = 0;
+    if (d->temperatura_bmp > cfg->limite_max_temp) alertas |= ALERTA_TEMP_MAX;
+    if (d->temperatura_bmp < cfg->limite_min_temp) alertas |= ALERTA_TEMP_MIN;
+    if (d->umidade_aht > cfg->limite_max_umid)     alertas |= ALERTA_UMID_MAX;
+    if (d->umidade_aht < cfg->limite_min_umid)     alertas |= ALERTA_UMID_MIN;
+    if (d->pressao_hpa > cfg->limite_max_press)    alertas |= ALERTA_PRESS_MAX;
+    if (d->pressao_hpa < cfg->limite_min_press)    alertas |= ALERTA_PRESS_MIN;
+    if (d->altitude > cfg->limite_max_alt)         alertas |= ALERTA_ALT_MAX;
+    if (d->altitude < cfg->limite_min_alt)         alertas |= ALERTA_ALT_MIN;
+    return alertas;
+}
+
+bool get_amostra(uint32_t seq, AMOSTRA *amostra) {
+    HIST_REGISTRO r;
+    critical_section_enter_blocking(&hist_lock);
+    uint32_t ultima = hist_ultima;
+    bool existe = seq <= ultima && seq >= hist_primeira_seq(ultima);
+    if (existe) {
+        r = hist[seq % HIST_LEN];
+    }
+    critical_section_exit(&hist_lock);
+    if (!existe) {
+        return false;
+    }
+    hist_decodificar(&r, seq, amostra);
+    return true;
+}
+
+void hist_decodificar(const HIST_REGISTRO *r, uint32_t seq, AMOSTRA *amostra) {
+    int32_t v[N_GRANDEZAS];
+    hist_unidades(r, v);
+    amostra->seq = seq;
+    amostra->temperatura = hist_valor(GRANDEZA_TEMP, v[GRANDEZA_TEMP]);
+    amostra->umidade = hist_valor(GRANDEZA_UMID, v[GRANDEZA_UMID]);
+    amostra->pressao = hist_valor(GRANDEZA_PRESS, v[GRANDEZA_PRESS]);
+    amostra->altitude = hist_valor(GRANDEZA_ALT, v[GRANDEZA_ALT]);
+}
+
+uint32_t get_tempo_s(void) {
+    return (uint32_t)(to_us_since_boot(get_absolute_time()) / 1000000u);
+}
+
+uint32_t agreg_periodo_s(uint8_t nivel) {
+    return agreg_niveis[nivel].periodo_s;
+}
+
+uint8_t agreg_escolher_nivel(uint32_t janela_s) {
+    for (uint8_t n = 0; n < AGREG_NIVEIS - 1; n++) {
+        if (janela_s <= agreg_niveis[n].periodo_s * agreg_niveis[n].capacidade) {
+            return n;
+        }
+    }
+    return AGREG_NIVEIS - 1;
+}
+
+void agreg_faixa(uint8_t nivel, uint32_t janela_s, uint32_t *primeiro, uint32_t *ultimo) {
+    const AGREG_NIVEL *def = &agreg_niveis[nivel];
+    uint32_t n = janela_s / def->periodo_s + (janela_s % def->periodo_s != 0);
+    if (n == 0) {
+        n = 1;
+    } else if (n > def->capacidade) {
+        n = def->capacidade;
+    }
+    *ultimo = get_tempo_s() / def->periodo_s;
+    *primeiro = *ultimo >= n - 1 ? *ultimo - (n - 1) : 0;
+}
+
+bool get_agregado(uint8_t nivel, uint32_t numero, AGREGADO *agregado) {
+    const AGREG_NIVEL *def = &agreg_niveis[nivel];
+    int32_t min[N_GRANDEZAS], media[N_GRANDEZAS], max[N_GRANDEZAS];
+    uint32_t amostras = 0;
+
+    critical_section_enter_blocking(&hist_lock);
+    const AGREG_ABERTO *a = &agreg_abertos[nivel];
+    const AGREG_REGISTRO *r = &agreg_registros[def->inicio + numero % def->capacidade];
+    if (a->amostras > 0 && a->numero == numero) {
+        amostras = a->amostras;
+        for (int g = 0; g < N_GRANDEZAS; g++) {
+            min[g] = a->min[g];
+            media[g] = agreg_media(a->soma[g], a->amostras);
+            max[g] = a->max[g];
+        }
+    } else if (r->amostras > 0 && r->numero == numero) {
+        amostras = r->amostras;
+        hist_unidades(&r->min, min);
+        hist_unidades(&r->media, media);
+        hist_unidades(&r->max, max);
+    }
+    critical_section_exit(&hist_lock);
+
+    if (amostras == 0) {
+        return false;
+    }
+    agregado->inicio_s = numero * def->periodo_s;
+    agregado->amostras = amostras;
+    for (int g = 0; g < N_GRANDEZAS; g++) {
+        agregado->min[g] = hist_valor(g, min[g]);
+        agregado->media[g] = hist_valor(g, media[g]);
+        agregado->max[g] = hist_valor(g, max[g]);
+    }
+    return true;
+}
+
+void get_config(CONFIG_ESTACAO *config) {
+    critical_section_enter_blocking(&config_lock);
+    *config = config_atual;
+    critical_section_exit(&config_lock);
+}
+
+uint32_t get_config_versao(void) {
+    critical_section_enter_blocking(&config_lock);
+    uint32_t versao = config_versao;
+    critical_section_exit(&config_lock);
+    return versao;
+}
+
+static bool offset_valido(float offset) {
+    return fabsf(offset) <= CONFIG_OFFSET_MAX;  // Falso também para NaN
+}
+
+const char *validar_config(const CONFIG_ESTACAO *c) {
+    if (!offset_valido(c->offset_temp))  return "offset_temp";
+    if (!offset_valido(c->offset_press)) return "offset_press";
+    if (!offset_valido(c->offset_umid))  return "offset_umid";
+    if (!offset_valido(c->offset_alt))   return "offset_alt";
+    if (!(c->pressao_nivel_mar >= ALTITUDE_REFERENCIA_MIN_PA / 100.0f &&
+          c->pressao_nivel_mar <= ALTITUDE_REFERENCIA_MAX_PA / 100.0f)) return "pressao_nivel_mar";
+    if (c->perfil_bmp280 < 0 || c->perfil_bmp280 >= BMP280_N_PERFIS) return "perfil_bmp280";
+    if (c->limite_min_temp >= c->limite_max_temp)   return "limite_min_temp";
+    if (c->limite_min_umid >= c->limite_max_umid)   return "limite_min_umid";
+    if (c->limite_min_press >= c->limite_max_press) return "limite_min_press";
+    if (c->limite_min_alt >= c->limite_max_alt)     return "limite_min_alt";
+    return NULL;
+}
+
+uint32_t aplicar_config(const CONFIG_ESTACAO *config) {
+    critical_section_enter_blocking(&config_lock);
+    config_atual = *config;
+    uint32_t versao = ++config_versao;
+    critical_section_exit(&config_lock);
+    return versao;
 }
 
 /**
  * @brief Define o valor do offset de calibração para a temperatura.
- * * Esta função será chamada pelo servidor web quando o utilizador submeter
- * um novo valor de offset no formulário da página.
+ * * Os setters individuais alteram um campo sobre a configuração atual e a reaplicam
+ * inteira. Para mudar vários campos de uma vez, use get_config + aplicar_config.
  * @param offset O novo valor do offset.
  */
 void set_temp_offset(float offset) {
-    g_sensor_data.offset_temp = offset;
+    CONFIG_ESTACAO c;
+    get_config(&c);
+    c.offset_temp = offset;
+    aplicar_config(&c);
 }
 
 /**
@@ -147,15 +623,35 @@ void set_temp_offset(float offset) {
  * @param offset O novo valor do offset.
  */
 void set_press_offset(float offset) {
-    g_sensor_data.offset_press = offset;
+    CONFIG_ESTACAO c;
+    get_config(&c);
+    c.offset_press = offset;
+    aplicar_config(&c);
 }
 
 void set_umid_offset(float offset) {
-    g_sensor_data.offset_umid = offset;
+    CONFIG_ESTACAO c;
+    get_config(&c);
+    c.offset_umid = offset;
+    aplicar_config(&c);
 }
 
 void set_alt_offset(float offset) {
-    g_sensor_data.offset_alt = offset;
+    CONFIG_ESTACAO c;
+    get_config(&c);
+    c.offset_alt = offset;
+    aplicar_config(&c);
+}
+
+bool set_perfil_bmp280(int perfil) {
+    if (perfil < 0 || perfil >= BMP280_N_PERFIS) {
+        return false;
+    }
+    CONFIG_ESTACAO c;
+    get_config(&c);
+    c.perfil_bmp280 = perfil;
+    aplicar_config(&c);
+    return true;
 }
 
 /**
@@ -164,21 +660,33 @@ void set_alt_offset(float offset) {
  * @param max Temperatura máxima.
  */
 void set_limites_temp(int min, int max) {
-    g_sensor_data.limite_min_temp = min;
-    g_sensor_data.limite_max_temp = max;
+    CONFIG_ESTACAO c;
+    get_config(&c);
+    c.limite_min_temp = min;
+    c.limite_max_temp = max;
+    aplicar_config(&c);
 }
 
 void set_limites_umid(int min, int max) {
-    g_sensor_data.limite_min_umid = min;
-    g_sensor_data.limite_max_umid = max;
+    CONFIG_ESTACAO c;
+    get_config(&c);
+    c.limite_min_umid = min;
+    c.limite_max_umid = max;
+    aplicar_config(&c);
 }
 
 void set_limites_press(int min, int max) {
-    g_sensor_data.limite_min_press = min;
-    g_sensor_data.limite_max_press = max;
+    CONFIG_ESTACAO c;
+    get_config(&c);
+    c.limite_min_press = min;
+    c.limite_max_press = max;
+    aplicar_config(&c);
 }
 
 void set_limites_alt(int min, int max) {
-    g_sensor_data.limite_min_alt = min;
-    g_sensor_data.limite_max_alt = max;
-}
\ No newline at end of file
+    CONFIG_ESTACAO c;
+    get_config(&c);
+    c.limite_min_alt = min;
+    c.limite_max_alt = max;
+    aplicar_config(&c);
+}
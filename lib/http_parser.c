@@ -0,0 +1,372 @@
+// Ficheiro: http_parser.c
+// Leitura incremental de requisições HTTP/1.x. Os bytes são consumidos um a um por uma
+// máquina de estados, então a requisição pode chegar dividida em qualquer ponto (vários
+// segmentos TCP, cadeias de pbufs). Só a linha de requisição e os cabeçalhos que o
+// servidor usa são guardados; o resto é descartado à medida que passa.
+
+#include "http_parser.h"
+#include <string.h>
+
+// Na mesma ordem de HTTP_CABECALHO, em minúsculas
+static const char *const HTTP_NOMES_CABECALHOS[HTTP_CAB_N] = {
+    "connection",
+    "if-none-match",
+    "accept-encoding",
+    "upgrade",
+    "sec-websocket-key",
+    "sec-websocket-version",
+    "content-length",
+    "transfer-encoding",
+};
+
+uint32_t http_hash(const char *s) {
+    uint32_t h = HTTP_FNV_INICIO;
+    while (*s) {
+        h = (h ^ (uint8_t)*s++) * HTTP_FNV_PRIMO;
+    }
+    return h;
+}
+
+void http_parser_iniciar(HTTP_REQUISICAO *req) {
+    memset(req, 0, sizeof(*req));
+    req->estado = HTTP_PARSE_METODO;
+    req->hash_caminho = HTTP_FNV_INICIO;
+    req->cab_atual = -1;
+}
+
+static void http_parser_erro(HTTP_REQUISICAO *req, uint16_t status) {
+    req->estado = HTTP_PARSE_ERRO;
+    req->erro = status;
+}
+
+static int8_t http_identificar_cabecalho(const HTTP_REQUISICAO *req) {
+    if (req->nome_len >= HTTP_NOME_MAX) {
+        return -1;
+    }
+    for (int i = 0; i < HTTP_CAB_N; i++) {
+        const char *nome = HTTP_NOMES_CABECALHOS[i];
+        if (strlen(nome) == req->nome_len && memcmp(nome, req->nome, req->nome_len) == 0) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+static void http_fim_linha_versao(HTTP_REQUISICAO *req) {
+    if (strncmp(req->versao, "HTTP/", 5) != 0) {
+        http_parser_erro(req, 400);
+    } else if (strncmp(req->versao, "HTTP/1.", 7) != 0) {
+        http_parser_erro(req, 505);
+    } else {
+        req->http11 = strcmp(req->versao, "HTTP/1.1") == 0;
+        req->estado = HTTP_PARSE_CAB_NOME;
+    }
+}
+
+/**
+ * @brief Fim do cabeçalho: decide se ainda há um corpo a ler.
+ */
+static void http_fim_cabecalho(HTTP_REQUISICAO *req) {
+    if (req->presente[HTTP_CAB_TRANSFER_ENCODING]) {
+        http_parser_erro(req, 411);  // Só corpos com Content-Length
+        return;
+    }
+    const char *cl = req->cabecalhos[HTTP_CAB_CONTENT_LENGTH];
+    uint32_t tamanho = 0;
+    if (req->presente[HTTP_CAB_CONTENT_LENGTH]) {
+        if (*cl == '\0') {
+            http_parser_erro(req, 400);
+            return;
+        }
+        for (; *cl; cl++) {
+            if (*cl < '0' || *cl > '9') {
+                http_parser_erro(req, 400);
+                return;
+            }
+            tamanho = tamanho * 10 + (uint32_t)(*cl - '0');
+            if (tamanho > HTTP_CORPO_MAX) {
+                http_parser_erro(req, 413);
+                return;
+            }
+        }
+    }
+    req->corpo_len = (uint16_t)tamanho;
+    req->estado = tamanho ? HTTP_PARSE_CORPO : HTTP_PARSE_COMPLETA;
+}
+
+static void http_fim_valor(HTTP_REQUISICAO *req) {
+    if (req->cab_atual >= 0) {
+        // Remove espaços no fim do valor
+        uint8_t *len = &req->cab_len[req->cab_atual];
+        char *valor = req->cabecalhos[req->cab_atual];
+        while (*len > 0 && (valor[*len - 1] == ' ' || valor[*len - 1] == '\t')) {
+            (*len)--;
+        }
+        valor[*len] = '\0';
+    }
+    req->estado = HTTP_PARSE_CAB_NOME;
+    req->nome_len = 0;
+    req->cab_atual = -1;
+}
+
+size_t http_parser_alimentar(HTTP_REQUISICAO *req, const char *dados, size_t len) {
+    size_t i = 0;
+    while (i < len && req->estado < HTTP_PARSE_COMPLETA) {
+        if (req->estado == HTTP_PARSE_CORPO) {
+            // O corpo é copiado em bloco, sem interpretar os bytes
+            size_t n = req->corpo_len - req->corpo_lido;
+            if (n > len - i) {
+                n = len - i;
+            }
+            memcpy(req->corpo + req->corpo_lido, dados + i, n);
+            req->corpo_lido += (uint16_t)n;
+            i += n;
+            if (req->corpo_lido == req->corpo_len) {
+                req->corpo[req->corpo_len] = '\0';
+                req->estado = HTTP_PARSE_COMPLETA;
+            }
+            continue;
+        }
+
+        char c = dados[i++];
+        if (c == '\r') {
+            continue;  // Aceita CRLF e LF puro como fim de linha
+        }
+
+        switch (req->estado) {
+            case HTTP_PARSE_METODO:
+                if (c == '\n' && req->metodo_len == 0) {
+                    break;  // Linhas vazias antes da requisição são ignoradas (RFC 7230, 3.5)
+                }
+                if (c == ' ' && req->metodo_len > 0) {
+                    req->estado = HTTP_PARSE_CAMINHO;
+                } else if (c == ' ' || c == '\n' || req->metodo_len == HTTP_METODO_MAX - 1) {
+                    http_parser_erro(req, 400);
+                } else {
+                    req->metodo[req->metodo_len++] = c;
+                }
+                break;
+
+            case HTTP_PARSE_CAMINHO:
+                if (c == ' ' && req->caminho_len > 0) {
+                    req->estado = HTTP_PARSE_VERSAO;
+                } else if (c == '?' && req->caminho_len > 0) {
+                    req->tem_query = true;
+                    req->estado = HTTP_PARSE_QUERY;
+                } else if (c == ' ' || c == '\n' || c == '?') {
+                    http_parser_erro(req, 400);
+                } else if (req->caminho_len == HTTP_CAMINHO_MAX - 1) {
+                    http_parser_erro(req, 414);
+                } else {
+                    req->caminho[req->caminho_len++] = c;
+                    req->hash_caminho = (req->hash_caminho ^ (uint8_t)c) * HTTP_FNV_PRIMO;
+                }
+                break;
+
+            case HTTP_PARSE_QUERY:
+                if (c == ' ') {
+                    req->estado = HTTP_PARSE_VERSAO;
+                } else if (c == '\n') {
+                    http_parser_erro(req, 400);
+                } else if (req->query_len == HTTP_QUERY_MAX - 1) {
+                    http_parser_erro(req, 414);
+                } else {
+                    req->query[req->query_len++] = c;
+                }
+                break;
+
+            case HTTP_PARSE_VERSAO:
+                if (c == '\n') {
+                    http_fim_linha_versao(req);
+                } else if (req->versao_len == sizeof(req->versao) - 1) {
+                    http_parser_erro(req, 400);
+                } else {
+                    req->versao[req->versao_len++] = c;
+                }
+                break;
+
+            case HTTP_PARSE_CAB_NOME:
+                if (c == '\n') {
+                    if (req->nome_len == 0) {
+                        http_fim_cabecalho(req);            // Linha vazia: fim do cabeçalho
+                    } else {
+                        http_parser_erro(req, 400);         // Linha de cabeçalho sem ':'
+                    }
+                } else if (c == ':') {
+                    req->cab_atual = http_identificar_cabecalho(req);
+                    if (req->cab_atual >= 0) {
+                        req->cab_len[req->cab_atual] = 0;
+                        req->presente[req->cab_atual] = true;
+                    }
+                    req->estado = HTTP_PARSE_CAB_VALOR;
+                } else if (req->nome_len < HTTP_NOME_MAX) {
+                    // Nomes de cabeçalho não diferenciam maiúsculas de minúsculas
+                    req->nome[req->nome_len++] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+                }
+                break;
+
+            case HTTP_PARSE_CAB_VALOR:
+                if (c == '\n') {
+                    http_fim_valor(req);
+                } else if (req->cab_atual >= 0) {
+                    uint8_t *n = &req->cab_len[req->cab_atual];
+                    if (*n == 0 && (c == ' ' || c == '\t')) {
+                        break;  // Espaços antes do valor
+                    }
+                    if (*n < HTTP_VALOR_MAX - 1) {
+                        req->cabecalhos[req->cab_atual][(*n)++] = c;
+                    }
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+    return i;
+}
+
+const char *http_cabecalho(const HTTP_REQUISICAO *req, HTTP_CABECALHO cab) {
+    return req->cabecalhos[cab];
+}
+
+static int http_hex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool http_lista_proximo(const char **cursor, const char **item, size_t *len) {
+    const char *p = *cursor;
+    while (*p == ',' || *p == ' ' || *p == '\t') {
+        p++;
+    }
+    if (*p == '\0') {
+        *cursor = p;
+        return false;
+    }
+    const char *fim = p;
+    while (*fim != ',' && *fim != '\0') {
+        fim++;
+    }
+    *cursor = fim;
+    while (fim > p && (fim[-1] == ' ' || fim[-1] == '\t')) {
+        fim--;
+    }
+    *item = p;
+    *len = (size_t)(fim - p);
+    return true;
+}
+
+bool http_query_proximo(char **cursor, char **chave, char **valor) {
+    char *p = *cursor;
+    while (*p == '&') {
+        p++;
+    }
+    if (*p == '\0') {
+        return false;
+    }
+
+    // A decodificação nunca aumenta o texto, então é feita no próprio buffer (w <= p)
+    char *w = p;
+    *chave = p;
+    *valor = NULL;
+    for (; *p && *p != '&'; p++) {
+        char c = *p;
+        if (c == '=' && !*valor) {
+            *w++ = '\0';
+            *valor = w;
+            continue;
+        }
+        if (c == '+') {
+            c = ' ';
+        } else if (c == '%' && http_hex(p[1]) >= 0 && http_hex(p[2]) >= 0) {
+            c = (char)(http_hex(p[1]) << 4 | http_hex(p[2]));
+            p += 2;
+        }
+        *w++ = c;
+    }
+    if (*p == '&') {
+        p++;
+    }
+    *w = '\0';
+    if (!*valor) {
+        *valor = w;  // Chave sem '=': valor vazio
+    }
+    *cursor = p;
+    return true;
+}
+
+static char *http_json_espacos(char *p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * @brief Lê uma string JSON a partir da aspa inicial, removendo as aspas e os escapes
+ * simples (\" \\ \/) no próprio buffer.
+ * @return Posição logo após a aspa final, ou NULL se a string não termina.
+ */
+static char *http_json_string(char *p, char **texto) {
+    char *w = ++p;
+    *texto = w;
+    for (; *p != '"'; p++) {
+        if (*p == '\0') {
+            return NULL;
+        }
+        if (*p == '\\' && p[1] != '\0') {
+            p++;
+        }
+        *w++ = *p;
+    }
+    *w = '\0';
+    return p + 1;
+}
+
+int http_json_proximo(char **cursor, char **chave, char **valor) {
+    char *p = http_json_espacos(*cursor);
+    if (*p == '{' || *p == ',') {
+        p = http_json_espacos(p + 1);
+    }
+    if (*p == '}') {
+        *cursor = p;
+        return 0;
+    }
+    if (*p != '"' || !(p = http_json_string(p, chave))) {
+        return -1;
+    }
+    p = http_json_espacos(p);
+    if (*p != ':') {
+        return -1;
+    }
+    p = http_json_espacos(p + 1);
+
+    if (*p == '"') {
+        if (!(p = http_json_string(p, valor))) {
+            return -1;
+        }
+    } else if (*p == '{' || *p == '[') {
+        return -1;
+    } else {
+        // Número ou literal. Para terminá-lo com '\0' sem apagar o separador que pode vir
+        // colado ("1.5}"), o texto é recuado uma posição, sobre o ':' ou um espaço.
+        size_t n = strcspn(p, ",} \t\r\n");
+        if (n == 0) {
+            return -1;
+        }
+        memmove(p - 1, p, n);
+        p[n - 1] = '\0';
+        *valor = p - 1;
+        p += n;
+    }
+
+    p = http_json_espacos(p);
+    if (*p != ',' && *p != '}') {
+        return -1;
+    }
+    *cursor = p;
+    return 1;
+}
@@ -0,0 +1,263 @@
+// Ficheiro: i2c_dma.c
+// Transações I2C por DMA no RP2040 (ver i2c_dma.h). Cada transação vira uma lista de
+// comandos de 16 bits para o IC_DATA_CMD: o byte a escrever, ou o bit CMD para ler um
+// byte, com RESTART na troca de escrita para leitura e STOP no último. Um canal de DMA
+// alimenta a FIFO de transmissão com essa lista e outro esvazia a de recepção no buffer
+// de leitura; a CPU só volta a ser usada na interrupção de STOP.
+
+#include "i2c_dma.h"
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+// Prazo de uma transação: margem fixa mais ~4x o tempo dos bytes a 400 kHz (22,5 µs cada)
+#define I2C_DMA_PRAZO_MS(bytes) (10 + (bytes) / 10)
+// Espera máxima pelo ABORT do controlador depois de um prazo esgotado
+#define I2C_DMA_ABORT_US 1000
+
+typedef struct {
+    i2c_inst_t *i2c;
+    uint irq;
+    int canal_tx;                   // Comandos -> IC_DATA_CMD
+    int canal_rx;                   // IC_DATA_CMD -> buffer de leitura
+    dma_channel_config config_tx;
+    dma_channel_config config_rx;
+    SemaphoreHandle_t mutex;        // Uma transação por vez; os demais esperam aqui
+    uint16_t *comandos;             // NULL: barramento não iniciado (bloqueante)
+    size_t capacidade;
+    // Estado da transação em andamento, compartilhado com a interrupção
+    TaskHandle_t volatile tarefa;   // Quem acordar no fim
+    volatile bool lendo;            // canal_rx em uso
+    volatile bool concluida;        // STOP detectado
+    volatile bool erro;             // TX_ABRT: NACK ou perda de arbitragem
+    volatile uint32_t fim_us;
+} I2C_DMA_BARRAMENTO;
+
+static I2C_DMA_BARRAMENTO barramentos[I2C_DMA_BARRAMENTOS];
+static I2C_DMA_STATS stats[I2C_DMA_BARRAMENTOS];
+
+// ===================================================================================
+// CONTADORES
+// ===================================================================================
+// Lidos pela tarefa do servidor (/metrics) enquanto as dos sensores e do display
+// escrevem: tempo_us tem 64 bits, então a cópia e a atualização desligam as interrupções
+// (núcleo único). Uma seção crítica do FreeRTOS não serviria antes do escalonador.
+
+static void stats_somar(uint indice, size_t bytes, bool ok, bool bloqueante, uint32_t tempo_us) {
+    uint32_t irq = save_and_disable_interrupts();
+    I2C_DMA_STATS *s = &stats[indice];
+    s->transacoes++;
+    s->bytes += bytes;
+    if (!ok) s->erros++;
+    if (bloqueante) s->bloqueantes++;
+    s->tempo_us += tempo_us;
+    restore_interrupts(irq);
+}
+
+void i2c_dma_get_stats(I2C_DMA_STATS copia[I2C_DMA_BARRAMENTOS]) {
+    uint32_t irq = save_and_disable_interrupts();
+    for (int i = 0; i < I2C_DMA_BARRAMENTOS; i++) copia[i] = stats[i];
+    restore_interrupts(irq);
+}
+
+// ===================================================================================
+// INTERRUPÇÃO
+// ===================================================================================
+
+static void i2c_dma_irq(I2C_DMA_BARRAMENTO *b) {
+    i2c_hw_t *hw = i2c_get_hw(b->i2c);
+    uint32_t estado = hw->intr_stat;
+    BaseType_t acordar = pdFALSE;
+
+    if (estado & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        // O controlador descartou a FIFO e vai gerar o STOP; os canais param aqui para
+        // que nenhum comando restante entre depois que o abort for limpo
+        b->erro = true;
+        dma_channel_abort(b->canal_tx);
+        if (b->lendo) dma_channel_abort(b->canal_rx);
+        (void)hw->clr_tx_abrt;
+    }
+    if (estado & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+        (void)hw->clr_stop_det;
+        if (b->lendo && !b->erro) {
+            // O último byte já está na FIFO: o canal o retira em poucos ciclos
+            while (dma_channel_is_busy(b->canal_rx)) tight_loop_contents();
+        }
+        hw->intr_mask = 0;
+        b->fim_us = time_us_32();
+        b->concluida = true;
+        if (b->tarefa) {
+            vTaskNotifyGiveFromISR(b->tarefa, &acordar);
+            b->tarefa = NULL;
+        }
+    }
+    portYIELD_FROM_ISR(acordar);
+}
+
+static void i2c0_dma_irq(void) {
+    i2c_dma_irq(&barramentos[0]);
+}
+
+static void i2c1_dma_irq(void) {
+    i2c_dma_irq(&barramentos[1]);
+}
+
+// ===================================================================================
+// TRANSAÇÕES
+// ===================================================================================
+
+bool i2c_dma_iniciar(i2c_inst_t *i2c, size_t max_bytes) {
+    uint indice = i2c_hw_index(i2c);
+    I2C_DMA_BARRAMENTO *b = &barramentos[indice];
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+
+    b->canal_tx = dma_claim_unused_channel(false);
+    b->canal_rx = dma_claim_unused_channel(false);
+    b->mutex = xSemaphoreCreateMutex();
+    uint16_t *comandos = malloc(max_bytes * sizeof(uint16_t));
+    if (b->canal_tx < 0 || b->canal_rx < 0 || b->mutex == NULL || comandos == NULL) {
+        if (b->canal_tx >= 0) dma_channel_unclaim(b->canal_tx);
+        if (b->canal_rx >= 0) dma_channel_unclaim(b->canal_rx);
+        if (b->mutex) vSemaphoreDelete(b->mutex);
+        free(comandos);
+        return false;
+    }
+    b->i2c = i2c;
+    b->capacidade = max_bytes;
+
+    // Comandos em 16 bits: o barramento APB replica a escrita estreita nas duas metades
+    // da palavra, e os bits 31:16 do IC_DATA_CMD são reservados
+    dma_channel_config c = dma_channel_get_default_config(b->canal_tx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(i2c, true));
+    b->config_tx = c;
+
+    c = dma_channel_get_default_config(b->canal_rx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, i2c_get_dreq(i2c, false));
+    b->config_rx = c;
+
+    // O i2c_init já liga os pedidos de DMA (IC_DMA_CR). Com metade da FIFO de reserva, a
+    // latência do DMA (disputado com o SPI do CYW43) não deixa o barramento ocioso.
+    hw->dma_tdlr = 8;
+    hw->dma_rdlr = 0;
+
+    // As fontes só são habilitadas durante uma transação por DMA: as funções bloqueantes
+    // do SDK esperam pelo STOP_DET em raw_intr_stat e não podem tê-lo limpo pela interrupção
+    hw->intr_mask = 0;
+    b->irq = indice == 0 ? I2C0_IRQ : I2C1_IRQ;
+    irq_set_exclusive_handler(b->irq, indice == 0 ? i2c0_dma_irq : i2c1_dma_irq);
+    irq_set_enabled(b->irq, true);
+
+    b->comandos = comandos;
+    return true;
+}
+
+/**
+ * @brief A mesma transação com as funções bloqueantes do SDK (START repetido via nostop).
+ */
+static bool i2c_dma_bloqueante(i2c_inst_t *i2c, uint8_t destino,
+                               const uint8_t *escrita, size_t n_escrita,
+                               uint8_t *leitura, size_t n_leitura) {
+    if (n_escrita && i2c_write_blocking(i2c, destino, escrita, n_escrita, n_leitura > 0) != (int)n_escrita) {
+        return false;
+    }
+    if (n_leitura && i2c_read_blocking(i2c, destino, leitura, n_leitura, false) != (int)n_leitura) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Prazo esgotado sem STOP (dispositivo segurando o SCL, por exemplo): para os
+ * canais e aborta a transferência no controlador.
+ * @return true se a transação terminou no meio do caminho, antes da interrupção desligada.
+ */
+static bool i2c_dma_abortar(I2C_DMA_BARRAMENTO *b) {
+    i2c_hw_t *hw = i2c_get_hw(b->i2c);
+    irq_set_enabled(b->irq, false);
+    b->tarefa = NULL;
+    bool concluida = b->concluida;
+    if (!concluida) {
+        hw->intr_mask = 0;
+        dma_channel_abort(b->canal_tx);
+        if (b->lendo) dma_channel_abort(b->canal_rx);
+        hw_set_bits(&hw->enable, I2C_IC_ENABLE_ABORT_BITS);
+        uint32_t inicio = time_us_32();
+        while ((hw->enable & I2C_IC_ENABLE_ABORT_BITS) && time_us_32() - inicio < I2C_DMA_ABORT_US) {
+            tight_loop_contents();
+        }
+        (void)hw->clr_intr;
+    }
+    irq_set_enabled(b->irq, true);
+    return concluida;
+}
+
+bool i2c_dma_transferir(i2c_inst_t *i2c, uint8_t destino,
+                        const uint8_t *escrita, size_t n_escrita,
+                        uint8_t *leitura, size_t n_leitura) {
+    uint indice = i2c_hw_index(i2c);
+    I2C_DMA_BARRAMENTO *b = &barramentos[indice];
+    size_t n = n_escrita + n_leitura;
+
+    if (b->comandos == NULL || n == 0 || n > b->capacidade ||
+        xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        bool ok = i2c_dma_bloqueante(i2c, destino, escrita, n_escrita, leitura, n_leitura);
+        stats_somar(indice, n, ok, true, 0);
+        return ok;
+    }
+
+    xSemaphoreTake(b->mutex, portMAX_DELAY);
+
+    uint16_t *cmd = b->comandos;
+    for (size_t i = 0; i < n_escrita; i++) {
+        cmd[i] = escrita[i];
+    }
+    for (size_t i = 0; i < n_leitura; i++) {
+        cmd[n_escrita + i] = I2C_IC_DATA_CMD_CMD_BITS;
+    }
+    if (n_escrita && n_leitura) {
+        cmd[n_escrita] |= I2C_IC_DATA_CMD_RESTART_BITS;
+    }
+    cmd[n - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+    hw->enable = 0;
+    hw->tar = destino;
+    hw->enable = 1;
+
+    // Uma notificação atrasada de uma transação abortada não pode encerrar esta
+    (void)ulTaskNotifyTake(pdTRUE, 0);
+    b->tarefa = xTaskGetCurrentTaskHandle();
+    b->lendo = n_leitura > 0;
+    b->concluida = false;
+    b->erro = false;
+    (void)hw->clr_intr;
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+
+    uint32_t inicio = time_us_32();
+    if (n_leitura) {
+        dma_channel_configure(b->canal_rx, &b->config_rx, leitura, &hw->data_cmd, n_leitura, true);
+    }
+    dma_channel_configure(b->canal_tx, &b->config_tx, &hw->data_cmd, cmd, n, true);
+
+    bool concluida = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(I2C_DMA_PRAZO_MS(n))) != 0;
+    if (!concluida) {
+        concluida = i2c_dma_abortar(b);
+    }
+    bool ok = concluida && !b->erro;
+    uint32_t tempo_us = (concluida ? b->fim_us : time_us_32()) - inicio;
+
+    xSemaphoreGive(b->mutex);
+    stats_somar(indice, n, ok, false, tempo_us);
+    return ok;
+}
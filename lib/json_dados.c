@@ -0,0 +1,358 @@
+// Ficheiro: json_dados.c
+// Serializador incremental do JSON de /dados_sensores (e de /historico e /log). Em vez
+// de montar o documento inteiro em memória, emite um item por vez no buffer fornecido
+// pelo servidor, que o entrega direto ao tcp_write. Assim o tamanho da resposta não é
+// limitado por um buffer fixo e não há cópias intermediárias na pilha.
+
+#include "json_dados.h"
+#include <string.h>
+#include "fmt_num.h"
+#include "global_manage.h"
+
+// Seções do documento, na ordem em que são emitidas
+enum {
+    // Documento completo
+    SECAO_ATUAIS,
+    SECAO_OFFSETS,
+    SECAO_LIMITES_TEMP_UMID,
+    SECAO_LIMITES_PRESS_ALT,
+    SECAO_HIST_LABELS,
+    SECAO_HIST_TEMP,
+    SECAO_HIST_UMID,
+    SECAO_HIST_PRESS,
+    SECAO_HIST_ALT,
+    SECAO_FIM,
+    // Documento incremental
+    SECAO_INC_AMOSTRAS,
+    SECAO_INC_FIM,
+    // Histórico agregado
+    SECAO_AGREG_INTERVALOS,
+    SECAO_AGREG_FIM,
+    // Log em flash
+    SECAO_LOG_REGISTROS,
+    SECAO_LOG_FIM
+};
+
+// Seção final de cada documento
+static const uint8_t secao_fim[] = {
+    [JSON_DOC_COMPLETO] = SECAO_FIM,
+    [JSON_DOC_INCREMENTAL] = SECAO_INC_FIM,
+    [JSON_DOC_AGREGADO] = SECAO_AGREG_FIM,
+    [JSON_DOC_LOG] = SECAO_LOG_FIM,
+};
+
+// Destino dos bytes de uma chamada a json_dados_escrever
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+} JSON_OUT;
+
+// Cada item é montado inteiro num buffer local (com fmt_num, sem printf) e só então anexado
+typedef char JSON_ITEM[JSON_DADOS_MIN_CAP];
+
+/**
+ * @brief Acrescenta o item montado em [item, fim). Se não couber inteiro, nada é acrescentado.
+ * @return true se o item foi escrito.
+ */
+static bool json_anexar(JSON_OUT *out, const char *item, const char *fim) {
+    size_t len = fim - item;
+    if (len > out->cap - out->len) {
+        return false;
+    }
+    memcpy(out->buf + out->len, item, len);
+    out->len += len;
+    return true;
+}
+
+static char *json_campo_fixo(char *p, const char *chave, float valor) {
+    return fmt_fixo(fmt_texto(p, chave), valor, 2);
+}
+
+static char *json_campo_int(char *p, const char *chave, int32_t valor) {
+    return fmt_int(fmt_texto(p, chave), valor);
+}
+
+char *json_dados_amostra(char *p, const AMOSTRA *a) {
+    p = fmt_uint(fmt_texto(p, "["), a->seq);
+    p = json_campo_fixo(p, ",", a->temperatura);
+    p = json_campo_fixo(p, ",", a->umidade);
+    p = json_campo_fixo(p, ",", a->pressao);
+    p = json_campo_fixo(p, ",", a->altitude);
+    return fmt_texto(p, "]");
+}
+
+static uint16_t json_total_amostras(JSON_CURSOR *cursor) {
+    return cursor->ultima >= cursor->primeira ? cursor->ultima - cursor->primeira + 1 : 0;
+}
+
+/**
+ * @brief Emite o próximo item de uma seção de histórico do documento completo.
+ * O índice 0 é a chave com o '[', 1..n são os elementos e n + 1 fecha o array.
+ */
+static bool json_item_historico(JSON_OUT *out, JSON_CURSOR *cursor) {
+    static const char *const chaves[] = { "\"hist_labels\":[", "\"hist_temp\":[", "\"hist_umid\":[",
+                                          "\"hist_press\":[", "\"hist_alt\":[" };
+    uint16_t i = cursor->indice;
+    uint16_t n = json_total_amostras(cursor);
+    JSON_ITEM item;
+    char *p;
+
+    if (i == 0) {
+        p = fmt_texto(item, chaves[cursor->secao - SECAO_HIST_LABELS]);
+        return json_anexar(out, item, p);
+    }
+    if (i > n) {
+        p = fmt_texto(item, cursor->secao == SECAO_HIST_ALT ? "]}" : "],");
+        return json_anexar(out, item, p);
+    }
+
+    p = fmt_texto(item, (i > 1) ? "," : "");
+    uint32_t seq = cursor->primeira + i - 1;
+    if (cursor->secao == SECAO_HIST_LABELS) {
+        p = fmt_uint(p, seq);
+        return json_anexar(out, item, p);
+    }
+    AMOSTRA a;
+    if (!get_amostra(seq, &a)) {
+        // A amostra saiu do histórico enquanto o documento era enviado
+        p = fmt_texto(p, "null");
+        return json_anexar(out, item, p);
+    }
+    float valor;
+    switch (cursor->secao) {
+        case SECAO_HIST_TEMP:  valor = a.temperatura; break;
+        case SECAO_HIST_UMID:  valor = a.umidade; break;
+        case SECAO_HIST_PRESS: valor = a.pressao; break;
+        default:               valor = a.altitude; break;
+    }
+    p = fmt_fixo(p, valor, 2);
+    return json_anexar(out, item, p);
+}
+
+/**
+ * @brief Emite o próximo item do documento incremental: cada amostra vira
+ * [seq,temp,umid,press,alt]; o índice n + 1 fecha o documento.
+ */
+static bool json_item_incremental(JSON_OUT *out, JSON_CURSOR *cursor) {
+    uint16_t i = cursor->indice;
+    JSON_ITEM item;
+    char *p;
+
+    if (i == 0) {
+        p = fmt_uint(fmt_texto(item, "{\"seq\":"), cursor->ultima);
+        p = json_campo_int(p, ",\"alertas\":", calcular_alertas_dados(&cursor->dados));
+        p = fmt_texto(p, ",\"amostras\":[");
+        return json_anexar(out, item, p);
+    }
+    if (i > json_total_amostras(cursor)) {
+        p = fmt_texto(item, "]}");
+        return json_anexar(out, item, p);
+    }
+    p = fmt_texto(item, (i > 1) ? "," : "");
+    AMOSTRA a;
+    if (!get_amostra(cursor->primeira + i - 1, &a)) {
+        // Já saiu do histórico: o cliente vê a lacuna e pede o documento completo
+        p = fmt_texto(p, "null");
+        return json_anexar(out, item, p);
+    }
+    p = json_dados_amostra(p, &a);
+    return json_anexar(out, item, p);
+}
+
+/**
+ * @brief Emite o próximo item do histórico agregado: o índice 0 abre o documento, cada
+ * intervalo com leituras vira [inicio,amostras,min,med,max x 4] e n + 1 fecha.
+ */
+static bool json_item_agregado(JSON_OUT *out, JSON_CURSOR *cursor) {
+    uint16_t i = cursor->indice;
+    JSON_ITEM item;
+    char *p;
+
+    if (i == 0) {
+        p = json_campo_int(item, "{\"nivel\":", cursor->nivel);
+        p = fmt_uint(fmt_texto(p, ",\"periodo\":"), agreg_periodo_s(cursor->nivel));
+        p = fmt_uint(fmt_texto(p, ",\"agora\":"), cursor->agora_s);
+        p = fmt_texto(p, ",\"intervalos\":[");
+        return json_anexar(out, item, p);
+    }
+    if (i > json_total_amostras(cursor)) {
+        p = fmt_texto(item, "]}");
+        return json_anexar(out, item, p);
+    }
+    AGREGADO a;
+    if (!get_agregado(cursor->nivel, cursor->primeira + i - 1, &a)) {
+        return true;  // Intervalo sem leituras
+    }
+    p = fmt_texto(item, cursor->separador ? ",[" : "[");
+    p = fmt_uint(p, a.inicio_s);
+    p = fmt_uint(fmt_texto(p, ","), a.amostras);
+    for (int g = 0; g < N_GRANDEZAS; g++) {
+        p = json_campo_fixo(p, ",", a.min[g]);
+        p = json_campo_fixo(p, ",", a.media[g]);
+        p = json_campo_fixo(p, ",", a.max[g]);
+    }
+    p = fmt_texto(p, "]");
+    if (!json_anexar(out, item, p)) {
+        return false;
+    }
+    cursor->separador = true;
+    return true;
+}
+
+/**
+ * @brief Emite o próximo item do log em flash: o índice 0 abre o documento, 1 emite os
+ * registros (um por chamada, enquanto houver) e, sem mais registros, fecha e passa a 2.
+ */
+static bool json_item_log(JSON_OUT *out, JSON_CURSOR *cursor) {
+    JSON_ITEM item;
+    char *p;
+
+    if (cursor->indice == 0) {
+        p = fmt_uint(fmt_texto(item, "{\"agora\":"), cursor->agora_s);
+        p = fmt_texto(p, ",\"registros\":[");
+        if (!json_anexar(out, item, p)) {
+            return false;
+        }
+        cursor->indice = 1;
+        return true;
+    }
+    FLASH_LOG_REGISTRO r;
+    if (!flash_log_ler(&cursor->log, &r)) {
+        p = fmt_texto(item, "]}");
+        if (!json_anexar(out, item, p)) {
+            return false;
+        }
+        cursor->indice = 2;
+        return true;
+    }
+    // Mesmo formato das amostras, com o tempo no lugar do número de sequência
+    AMOSTRA a;
+    hist_decodificar(&r.valores, r.tempo_s, &a);
+    p = json_dados_amostra(fmt_texto(item, cursor->separador ? "," : ""), &a);
+    if (!json_anexar(out, item, p)) {
+        return false;
+    }
+    flash_log_avancar(&cursor->log);
+    cursor->separador = true;
+    return true;
+}
+
+void json_dados_iniciar(JSON_CURSOR *cursor, uint32_t desde, bool tem_desde) {
+    cursor->indice = 0;
+    cursor->concluido = false;
+    get_sensor_data(&cursor->dados);
+    cursor->ultima = cursor->dados.seq;
+
+    // Incremental só se a amostra seguinte a `desde` ainda está no histórico
+    uint32_t inicio = hist_primeira_seq(cursor->ultima);
+    if (tem_desde && desde <= cursor->ultima && desde + 1 >= inicio) {
+        cursor->documento = JSON_DOC_INCREMENTAL;
+        cursor->secao = SECAO_INC_AMOSTRAS;
+        cursor->primeira = desde + 1;
+    } else {
+        cursor->documento = JSON_DOC_COMPLETO;
+        cursor->secao = SECAO_ATUAIS;
+        cursor->primeira = inicio;
+    }
+}
+
+void json_dados_iniciar_agregado(JSON_CURSOR *cursor, uint32_t janela_s) {
+    cursor->indice = 0;
+    cursor->concluido = false;
+    cursor->documento = JSON_DOC_AGREGADO;
+    cursor->separador = false;
+    cursor->secao = SECAO_AGREG_INTERVALOS;
+    cursor->nivel = agreg_escolher_nivel(janela_s);
+    cursor->agora_s = get_tempo_s();
+    agreg_faixa(cursor->nivel, janela_s, &cursor->primeira, &cursor->ultima);
+}
+
+void json_dados_iniciar_log(JSON_CURSOR *cursor, uint32_t de, uint32_t ate) {
+    cursor->documento = JSON_DOC_LOG;
+    cursor->secao = SECAO_LOG_REGISTROS;
+    cursor->indice = 0;
+    cursor->concluido = false;
+    cursor->separador = false;
+    cursor->agora_s = flash_log_agora(get_tempo_s());
+    flash_log_buscar(&cursor->log, de, ate);
+}
+
+size_t json_dados_escrever(JSON_CURSOR *cursor, char *buf, size_t cap) {
+    const SENSOR_DATA *data = &cursor->dados;
+    JSON_OUT out = { buf, cap, 0 };
+    uint8_t fim = secao_fim[cursor->documento];
+
+    while (cursor->secao < fim) {
+        bool ok;
+        JSON_ITEM item;
+        char *p;
+        switch (cursor->secao) {
+            case SECAO_ATUAIS:
+                p = fmt_uint(fmt_texto(item, "{\"seq\":"), cursor->ultima);
+                p = json_campo_fixo(p, ",\"temp\":", data->temperatura_bmp);
+                p = json_campo_fixo(p, ",\"umid\":", data->umidade_aht);
+                p = json_campo_fixo(p, ",\"press\":", data->pressao_hpa);
+                p = json_campo_fixo(p, ",\"alt\":", data->altitude);
+                p = json_campo_int(p, ",\"hist_len\":", HIST_LEN);
+                p = json_campo_int(p, ",\"alertas\":", calcular_alertas_dados(data));
+                p = fmt_texto(p, ",");
+                ok = json_anexar(&out, item, p);
+                break;
+            case SECAO_OFFSETS:
+                p = json_campo_fixo(item, "\"offset_temp\":", cursor->dados.config.offset_temp);
+                p = json_campo_fixo(p, ",\"offset_press\":", cursor->dados.config.offset_press);
+                p = json_campo_fixo(p, ",\"offset_umid\":", cursor->dados.config.offset_umid);
+                p = json_campo_fixo(p, ",\"offset_alt\":", cursor->dados.config.offset_alt);
+                p = json_campo_fixo(p, ",\"pressao_nivel_mar\":", cursor->dados.config.pressao_nivel_mar);
+                p = json_campo_int(p, ",\"perfil_bmp280\":", cursor->dados.config.perfil_bmp280);
+                p = fmt_texto(p, ",");
+                ok = json_anexar(&out, item, p);
+                break;
+            case SECAO_LIMITES_TEMP_UMID:
+                p = json_campo_int(item, "\"limite_min_temp\":", cursor->dados.config.limite_min_temp);
+                p = json_campo_int(p, ",\"limite_max_temp\":", cursor->dados.config.limite_max_temp);
+                p = json_campo_int(p, ",\"limite_min_umid\":", cursor->dados.config.limite_min_umid);
+                p = json_campo_int(p, ",\"limite_max_umid\":", cursor->dados.config.limite_max_umid);
+                p = fmt_texto(p, ",");
+                ok = json_anexar(&out, item, p);
+                break;
+            case SECAO_LIMITES_PRESS_ALT:
+                p = json_campo_int(item, "\"limite_min_press\":", cursor->dados.config.limite_min_press);
+                p = json_campo_int(p, ",\"limite_max_press\":", cursor->dados.config.limite_max_press);
+                p = json_campo_int(p, ",\"limite_min_alt\":", cursor->dados.config.limite_min_alt);
+                p = json_campo_int(p, ",\"limite_max_alt\":", cursor->dados.config.limite_max_alt);
+                p = fmt_texto(p, ",");
+                ok = json_anexar(&out, item, p);
+                break;
+            case SECAO_LOG_REGISTROS:
+                // Tamanho desconhecido de antemão: segue até o log não ter mais registros
+                ok = json_item_log(&out, cursor);
+                if (ok && cursor->indice < 2) {
+                    continue;
+                }
+                break;
+            default:
+                // Seções de array: avançam elemento a elemento dentro da mesma seção
+                if (cursor->documento == JSON_DOC_AGREGADO) {
+                    ok = json_item_agregado(&out, cursor);
+                } else if (cursor->documento == JSON_DOC_INCREMENTAL) {
+                    ok = json_item_incremental(&out, cursor);
+                } else {
+                    ok = json_item_historico(&out, cursor);
+                }
+                if (ok && ++cursor->indice <= json_total_amostras(cursor) + 1) {
+                    continue;
+                }
+                break;
+        }
+        if (!ok) {
+            break; // Sem espaço: retoma deste item na próxima chamada
+        }
+        cursor->secao++;
+        cursor->indice = 0;
+    }
+
+    cursor->concluido = (cursor->secao >= fim);
+    return out.len;
+}
@@ -0,0 +1,218 @@
+// Ficheiro: metricas.c
+// Exposição das métricas da estação para o Prometheus (GET /metrics). O texto é montado
+// linha a linha com fmt_num, como o JSON de /dados_sensores; o servidor guarda o resultado
+// em cache e só chama metricas_renderizar quando há uma amostra ou configuração nova.
+
+#include "metricas.h"
+#include <string.h>
+#include "fmt_num.h"
+#include "global_manage.h"
+#include "i2c_dma.h"
+
+#define METRICAS_LINHA_MAX 160
+
+_Static_assert(METRICAS_MAX >= METRICAS_PIOR_CASO + METRICAS_PIOR_CASO / 10,
+               "aumente METRICAS_MAX: menos de 10% de folga sobre o pior caso");
+
+// Destino das linhas renderizadas
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+    bool estourou;      // Alguma linha não coube
+} METRICAS_OUT;
+
+/**
+ * @brief Acrescenta a linha montada em [linha, fim). Se não couber inteira, é descartada
+ * e o estouro fica marcado.
+ */
+static void metricas_anexar(METRICAS_OUT *out, const char *linha, const char *fim) {
+    size_t len = fim - linha;
+    if (len <= out->cap - out->len) {
+        memcpy(out->buf + out->len, linha, len);
+        out->len += len;
+    } else {
+        out->estourou = true;
+    }
+}
+
+/**
+ * @brief Escreve os comentários HELP e TYPE que abrem uma família de métricas.
+ */
+static void metricas_familia(METRICAS_OUT *out, const char *nome, const char *tipo, const char *ajuda) {
+    char linha[METRICAS_LINHA_MAX];
+    char *p = fmt_texto(fmt_texto(fmt_texto(linha, "# HELP "), nome), " ");
+    p = fmt_texto(fmt_texto(p, ajuda), "\n");
+    metricas_anexar(out, linha, p);
+    p = fmt_texto(fmt_texto(fmt_texto(linha, "# TYPE "), nome), " ");
+    p = fmt_texto(fmt_texto(p, tipo), "\n");
+    metricas_anexar(out, linha, p);
+}
+
+/**
+ * @brief Início de uma amostra: "nome{rotulos} " (sem chaves se rotulos for NULL).
+ */
+static char *metricas_nome(char *p, const char *nome, const char *rotulos) {
+    p = fmt_texto(p, nome);
+    if (rotulos) {
+        p = fmt_texto(fmt_texto(fmt_texto(p, "{"), rotulos), "}");
+    }
+    return fmt_texto(p, " ");
+}
+
+static void metricas_fixo(METRICAS_OUT *out, const char *nome, const char *rotulos, float valor) {
+    char linha[METRICAS_LINHA_MAX];
+    char *p = fmt_fixo(metricas_nome(linha, nome, rotulos), valor, 2);
+    metricas_anexar(out, linha, fmt_texto(p, "\n"));
+}
+
+static void metricas_int(METRICAS_OUT *out, const char *nome, const char *rotulos, int32_t valor) {
+    char linha[METRICAS_LINHA_MAX];
+    char *p = fmt_int(metricas_nome(linha, nome, rotulos), valor);
+    metricas_anexar(out, linha, fmt_texto(p, "\n"));
+}
+
+static void metricas_uint(METRICAS_OUT *out, const char *nome, const char *rotulos, uint32_t valor) {
+    char linha[METRICAS_LINHA_MAX];
+    char *p = fmt_uint(metricas_nome(linha, nome, rotulos), valor);
+    metricas_anexar(out, linha, fmt_texto(p, "\n"));
+}
+
+/**
+ * @brief Amostra de um tempo em segundos, com milissegundos: "nome{rotulos} S.mmm".
+ */
+static void metricas_segundos(METRICAS_OUT *out, const char *nome, const char *rotulos, uint64_t us) {
+    char linha[METRICAS_LINHA_MAX];
+    uint32_t ms = (uint32_t)(us / 1000u % 1000u);
+    char *p = fmt_uint(metricas_nome(linha, nome, rotulos), (uint32_t)(us / 1000000u));
+    p = fmt_texto(p, ".");
+    *p++ = (char)('0' + ms / 100u);
+    *p++ = (char)('0' + ms / 10u % 10u);
+    *p++ = (char)('0' + ms % 10u);
+    metricas_anexar(out, linha, fmt_texto(p, "\n"));
+}
+
+// Rótulos das quatro grandezas, na ordem usada nas tabelas abaixo
+static const char *const METRICAS_GRANDEZAS[4] = {
+    "grandeza=\"temp\"", "grandeza=\"umid\"", "grandeza=\"press\"", "grandeza=\"alt\"",
+};
+
+bool metricas_renderizar(char *buf, size_t cap, const HTTP_SERVER_STATS *http, size_t *len) {
+    METRICAS_OUT out = { buf, cap, 0, false };
+    SENSOR_DATA dados;
+    get_sensor_data(&dados);
+    const SENSOR_DATA *d = &dados;
+    const CONFIG_ESTACAO c = dados.config;
+    uint8_t alertas = calcular_alertas_dados(d);
+
+    // --- Leituras atuais ---
+    metricas_familia(&out, "estacao_temperatura_celsius", "gauge", "Temperatura do BMP280, com offset.");
+    metricas_fixo(&out, "estacao_temperatura_celsius", NULL, d->temperatura_bmp);
+    metricas_familia(&out, "estacao_umidade_percent", "gauge", "Umidade relativa do AHT20, com offset.");
+    metricas_fixo(&out, "estacao_umidade_percent", NULL, d->umidade_aht);
+    metricas_familia(&out, "estacao_pressao_hpa", "gauge", "Pressao atmosferica do BMP280, com offset.");
+    metricas_fixo(&out, "estacao_pressao_hpa", NULL, d->pressao_hpa);
+    metricas_familia(&out, "estacao_altitude_metros", "gauge", "Altitude estimada pela pressao, com offset.");
+    metricas_fixo(&out, "estacao_altitude_metros", NULL, d->altitude);
+
+    // --- Configuração ---
+    const float offsets[4] = { c.offset_temp, c.offset_umid, c.offset_press, c.offset_alt };
+    const int minimos[4] = { c.limite_min_temp, c.limite_min_umid, c.limite_min_press, c.limite_min_alt };
+    const int maximos[4] = { c.limite_max_temp, c.limite_max_umid, c.limite_max_press, c.limite_max_alt };
+    metricas_familia(&out, "estacao_offset", "gauge", "Offset de calibracao somado a leitura, na unidade da grandeza.");
+    for (int i = 0; i < 4; i++) metricas_fixo(&out, "estacao_offset", METRICAS_GRANDEZAS[i], offsets[i]);
+    metricas_familia(&out, "estacao_pressao_nivel_mar_hpa", "gauge", "Pressao ao nivel do mar (QNH) usada como referencia da altitude.");
+    metricas_fixo(&out, "estacao_pressao_nivel_mar_hpa", NULL, c.pressao_nivel_mar);
+    metricas_familia(&out, "estacao_bmp280_perfil", "gauge", "Perfil de medicao do BMP280 (0 ultra baixo consumo, 1 alta resolucao, 2 alta taxa).");
+    metricas_int(&out, "estacao_bmp280_perfil", "estado=\"configurado\"", c.perfil_bmp280);
+    metricas_int(&out, "estacao_bmp280_perfil", "estado=\"ativo\"", get_perfil_bmp280());
+    metricas_familia(&out, "estacao_limite_minimo", "gauge", "Limite inferior de alerta.");
+    for (int i = 0; i < 4; i++) metricas_int(&out, "estacao_limite_minimo", METRICAS_GRANDEZAS[i], minimos[i]);
+    metricas_familia(&out, "estacao_limite_maximo", "gauge", "Limite superior de alerta.");
+    for (int i = 0; i < 4; i++) metricas_int(&out, "estacao_limite_maximo", METRICAS_GRANDEZAS[i], maximos[i]);
+    metricas_familia(&out, "estacao_config_versao", "gauge", "Versao da configuracao, incrementada a cada alteracao.");
+    metricas_uint(&out, "estacao_config_versao", NULL, get_config_versao());
+
+    // --- Alertas: um bit ALERTA_* por série ---
+    static const struct { const char *rotulos; uint8_t bit; } ALERTAS[8] = {
+        { "grandeza=\"temp\",limite=\"max\"",  ALERTA_TEMP_MAX },
+        { "grandeza=\"temp\",limite=\"min\"",  ALERTA_TEMP_MIN },
+        { "grandeza=\"umid\",limite=\"max\"",  ALERTA_UMID_MAX },
+        { "grandeza=\"umid\",limite=\"min\"",  ALERTA_UMID_MIN },
+        { "grandeza=\"press\",limite=\"max\"", ALERTA_PRESS_MAX },
+        { "grandeza=\"press\",limite=\"min\"", ALERTA_PRESS_MIN },
+        { "grandeza=\"alt\",limite=\"max\"",   ALERTA_ALT_MAX },
+        { "grandeza=\"alt\",limite=\"min\"",   ALERTA_ALT_MIN },
+    };
+    metricas_familia(&out, "estacao_alerta", "gauge", "1 se a leitura ultrapassa o limite.");
+    for (int i = 0; i < 8; i++) {
+        metricas_uint(&out, "estacao_alerta", ALERTAS[i].rotulos, (alertas & ALERTAS[i].bit) ? 1 : 0);
+    }
+
+    // --- Contadores da aquisição ---
+    metricas_familia(&out, "estacao_amostras_total", "counter", "Amostras lidas desde o boot.");
+    metricas_uint(&out, "estacao_amostras_total", NULL, d->seq);
+    metricas_familia(&out, "estacao_erros_i2c_total", "counter", "Leituras de sensor que falharam no barramento I2C.");
+    metricas_uint(&out, "estacao_erros_i2c_total", NULL, d->erros_i2c);
+    static const char *const SENSORES[N_SENSORES] = { "sensor=\"bmp280\"", "sensor=\"aht20\"" };
+    metricas_familia(&out, "estacao_sensor_falhas_total", "counter", "Leituras que falharam ou vieram invalidas, por sensor.");
+    for (int i = 0; i < N_SENSORES; i++) metricas_uint(&out, "estacao_sensor_falhas_total", SENSORES[i], d->falhas[i]);
+    metricas_familia(&out, "estacao_sensor_desatualizadas_total", "counter",
+                     "Amostras publicadas com o valor anterior do sensor, sem leitura nova.");
+    for (int i = 0; i < N_SENSORES; i++) metricas_uint(&out, "estacao_sensor_desatualizadas_total", SENSORES[i], d->desatualizadas[i]);
+
+    // --- Barramentos I2C (i2c_dma.c) ---
+    static const char *const BARRAMENTOS[I2C_DMA_BARRAMENTOS] = {
+        "barramento=\"sensores\"", "barramento=\"display\"",
+    };
+    I2C_DMA_STATS i2c[I2C_DMA_BARRAMENTOS];
+    i2c_dma_get_stats(i2c);
+    metricas_familia(&out, "estacao_i2c_transacoes_total", "counter", "Transacoes I2C, por barramento.");
+    for (int i = 0; i < I2C_DMA_BARRAMENTOS; i++) metricas_uint(&out, "estacao_i2c_transacoes_total", BARRAMENTOS[i], i2c[i].transacoes);
+    metricas_familia(&out, "estacao_i2c_bytes_total", "counter", "Bytes escritos e lidos no barramento.");
+    for (int i = 0; i < I2C_DMA_BARRAMENTOS; i++) metricas_uint(&out, "estacao_i2c_bytes_total", BARRAMENTOS[i], i2c[i].bytes);
+    metricas_familia(&out, "estacao_i2c_erros_total", "counter", "Transacoes com NACK ou prazo esgotado.");
+    for (int i = 0; i < I2C_DMA_BARRAMENTOS; i++) metricas_uint(&out, "estacao_i2c_erros_total", BARRAMENTOS[i], i2c[i].erros);
+    metricas_familia(&out, "estacao_i2c_bloqueantes_total", "counter", "Transacoes feitas com espera ativa (antes do escalonador).");
+    for (int i = 0; i < I2C_DMA_BARRAMENTOS; i++) metricas_uint(&out, "estacao_i2c_bloqueantes_total", BARRAMENTOS[i], i2c[i].bloqueantes);
+    metricas_familia(&out, "estacao_i2c_dma_segundos_total", "counter",
+                     "Tempo de barramento por DMA: espera ativa poupada a CPU.");
+    for (int i = 0; i < I2C_DMA_BARRAMENTOS; i++) metricas_segundos(&out, "estacao_i2c_dma_segundos_total", BARRAMENTOS[i], i2c[i].tempo_us);
+
+    // --- Heap do FreeRTOS ---
+    METRICAS_HEAP heap;
+    metricas_heap(&heap);
+    metricas_familia(&out, "estacao_heap_bytes", "gauge", "Tamanho do heap do FreeRTOS (configTOTAL_HEAP_SIZE).");
+    metricas_uint(&out, "estacao_heap_bytes", NULL, heap.tamanho);
+    metricas_familia(&out, "estacao_heap_livre_bytes", "gauge", "Bytes livres no heap do FreeRTOS.");
+    metricas_uint(&out, "estacao_heap_livre_bytes", NULL, heap.livre);
+    metricas_familia(&out, "estacao_heap_livre_minimo_bytes", "gauge",
+                     "Menor quantidade de bytes livres no heap do FreeRTOS desde o boot.");
+    metricas_uint(&out, "estacao_heap_livre_minimo_bytes", NULL, heap.livre_minimo);
+
+    // --- Servidor HTTP ---
+    metricas_familia(&out, "estacao_http_requisicoes_total", "counter", "Requisicoes atendidas, por rota.");
+    for (int i = 0; i < http->n_rotas; i++) {
+        char rotulos[METRICAS_LINHA_MAX / 2];
+        char *p = fmt_texto(fmt_texto(rotulos, "metodo=\""), http->rotas[i].metodo);
+        fmt_texto(fmt_texto(fmt_texto(p, "\",rota=\""), http->rotas[i].caminho), "\"");
+        metricas_uint(&out, "estacao_http_requisicoes_total", rotulos, http->rotas[i].requisicoes);
+    }
+    metricas_familia(&out, "estacao_http_requisicoes_invalidas_total", "counter",
+                     "Requisicoes sem rota (404, 405) ou malformadas.");
+    metricas_uint(&out, "estacao_http_requisicoes_invalidas_total", NULL, http->requests_other);
+    metricas_familia(&out, "estacao_http_bytes_enviados_total", "counter",
+                     "Bytes entregues a pilha TCP (respostas, eventos SSE e quadros WebSocket).");
+    metricas_uint(&out, "estacao_http_bytes_enviados_total", NULL, http->bytes_sent);
+    metricas_familia(&out, "estacao_http_conexoes_rejeitadas_total", "counter",
+                     "Conexoes recusadas com 503 por falta de slot.");
+    metricas_uint(&out, "estacao_http_conexoes_rejeitadas_total", NULL, http->conns_rejected);
+    metricas_familia(&out, "estacao_http_conexoes_ativas", "gauge", "Conexoes HTTP ocupando slots do pool.");
+    metricas_uint(&out, "estacao_http_conexoes_ativas", NULL, http->conns_active);
+    metricas_familia(&out, "estacao_http_assinantes", "gauge", "Clientes recebendo eventos ao vivo.");
+    metricas_uint(&out, "estacao_http_assinantes", "tipo=\"sse\"", http->sse_subscribers);
+    metricas_uint(&out, "estacao_http_assinantes", "tipo=\"websocket\"", http->ws_clients);
+
+    *len = out.len;
+    return !out.estourou;
+}
@@ -3,261 +3,1596 @@
 #include "pico/cyw43_arch.h"
 #include "lwip/tcp.h"
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <limits.h>
 #include "global_manage.h"
+#include "json_dados.h"
+#include "fmt_num.h"
+#include "telemetria_bin.h"
+#include "websocket.h"
+#include "http_parser.h"
+#include "metricas.h"
+#include "server.h"
+
+#define HTTP_XSTR(x) #x
+#define HTTP_STR(x) HTTP_XSTR(x)
 
 // =================================================================================
-// HTML / CSS / JavaScript - FINAL COM TODOS OS CAMPOS E GRÁFICOS
+// PÁGINA PRINCIPAL
 // =================================================================================
-const char HTML_BODY[] =
-    "<!DOCTYPE html><html><head><title>Estação Meteorológica</title><meta charset='UTF-8'>"
-    "<meta name='viewport' content='width=device-width, initial-scale=1.0'>"
-    "<style>"
-    "body{font-family:sans-serif;background:#f0f2f5;display:flex;justify-content:center;padding:10px;margin:0}"
-    ".container{width:100%;max-width:800px;background:white;padding:20px;border-radius:10px;box-shadow:0 4px 12px rgba(0,0,0,0.1)}"
-    "h1,h2{text-align:center;color:#333}hr{border:1px solid #eee;margin:20px 0}"
-    ".grid{display:grid;grid-template-columns:repeat(auto-fit,minmax(150px,1fr));gap:20px;text-align:center}"
-    ".card{background:#f8f9fa;padding:15px;border-radius:8px;border:1px solid #ddd}"
-    ".card p{margin:0;font-size:1.5rem;font-weight:bold;color:#007bff}.card span{font-size:0.9rem;color:#6c757d}"
-    ".charts-grid{display:grid;grid-template-columns:repeat(auto-fit,minmax(300px,1fr));gap:20px;margin-top:20px}"
-    ".chart-container{width:100%}"
-    ".form-grid{display:grid;grid-template-columns:repeat(auto-fit,minmax(300px,1fr));gap:20px;margin-top:20px}"
-    ".form-group{display:flex;flex-direction:column}label{margin-bottom:5px;font-weight:bold;color:#555;text-align:left}"
-    "input{padding:8px;border:1px solid #ccc;border-radius:5px;font-size:1rem;width:calc(100% - 18px)}"
-    "button{padding:10px;border:none;background:#28a745;color:white;border-radius:5px;cursor:pointer;margin-top:10px}"
-    ".limit-inputs{display:flex;gap:10px} .limit-inputs input{width:calc(50% - 28px)}"
-    "</style>"
-    "<script src='https://cdn.jsdelivr.net/npm/chart.js'></script>"
-    "<script>"
-    "let tempChart,umidChart,pressChart,altChart;"
-    "function createChart(elId,label,color){const ctx=document.getElementById(elId).getContext('2d');"
-    "return new Chart(ctx,{type:'line',data:{labels:[],datasets:[{label:label,data:[],borderColor:color,backgroundColor:color+'80',tension:0.1}]},"
-    "options:{scales:{y:{beginAtZero:false}},animation:false,plugins:{legend:{display:true}}}})}"
-    "function initCharts(){tempChart=createChart('tempChart','Temperatura (°C)','rgb(255,99,132)');"
-    "umidChart=createChart('umidChart','Umidade (%)','rgb(54,162,235)');"
-    "pressChart=createChart('pressChart','Pressão (hPa)','rgb(75,192,192)');"
-    "altChart=createChart('altChart','Altitude (m)','rgb(153,102,255)');}"
-    "function setConfig(param){const v=document.getElementById('input_'+param).value;fetch('/config?'+param+'='+v).then(()=>document.getElementById('input_'+param).blur())}"
-    "function setLimits(param){const min=document.getElementById('input_limite_min_'+param).value;"
-    "const max=document.getElementById('input_limite_max_'+param).value;"
-    "fetch('/config?limite_min_'+param+'='+min+'&limite_max_'+param+'='+max).then(()=>{document.getElementById('input_limite_min_'+param).blur();document.getElementById('input_limite_max_'+param).blur()})}"
-    "function atualizarDados(){fetch('/dados_sensores').then(r=>r.json()).then(d=>{"
-    "document.getElementById('temp').innerText=d.temp.toFixed(2);document.getElementById('umid').innerText=d.umid.toFixed(2);"
-    "document.getElementById('press').innerText=d.press.toFixed(2);document.getElementById('alt').innerText=d.alt.toFixed(2);"
-    "if(!document.activeElement.id.includes('input')){document.getElementById('input_offset_temp').value=d.offset_temp;"
-    "document.getElementById('input_offset_press').value=d.offset_press;"
-    "document.getElementById('input_offset_umid').value=d.offset_umid;"
-    "document.getElementById('input_offset_alt').value=d.offset_alt;"
-    "document.getElementById('input_limite_min_temp').value=d.limite_min_temp;document.getElementById('input_limite_max_temp').value=d.limite_max_temp;"
-    "document.getElementById('input_limite_min_umid').value=d.limite_min_umid;document.getElementById('input_limite_max_umid').value=d.limite_max_umid;"
-    "document.getElementById('input_limite_min_press').value=d.limite_min_press;document.getElementById('input_limite_max_press').value=d.limite_max_press;"
-    "document.getElementById('input_limite_min_alt').value=d.limite_min_alt;document.getElementById('input_limite_max_alt').value=d.limite_max_alt;}"
-    "tempChart.data.datasets[0].data=d.hist_temp;umidChart.data.datasets[0].data=d.hist_umid;"
-    "pressChart.data.datasets[0].data=d.hist_press;altChart.data.datasets[0].data=d.hist_alt;"
-    "const labels=d.hist_labels;tempChart.data.labels=labels;umidChart.data.labels=labels;pressChart.data.labels=labels;altChart.data.labels=labels;"
-    "tempChart.update();umidChart.update();pressChart.update();altChart.update();"
-    "}).catch(e=>console.error('Erro:',e))}"
-    "window.onload=()=>{initCharts();atualizarDados();setInterval(atualizarDados,2000)};"
-    "</script></head><body>"
-    "<div class=container><h1>Estação Meteorológica</h1><div class=grid>"
-    "<div class=card><p id=temp>--</p><span>Temperatura (°C)</span></div><div class=card><p id=umid>--</p><span>Umidade (%)</span></div>"
-    "<div class=card><p id=press>--</p><span>Pressão (hPa)</span></div><div class=card><p id=alt>--</p><span>Altitude (m)</span></div></div>"
-    "<div class=charts-grid><div class=chart-container><canvas id=tempChart></canvas></div><div class=chart-container><canvas id=umidChart></canvas></div>"
-    "<div class=chart-container><canvas id=pressChart></canvas></div><div class=chart-container><canvas id=altChart></canvas></div></div><hr>"
-    "<h2>Configurações de Calibração</h2><div class=form-grid>"
-    "<div class=form-group><label>Offset Temperatura:</label><input type=number step=0.1 id=input_offset_temp><button onclick=\"setConfig('offset_temp')\">Definir</button></div>"
-    "<div class=form-group><label>Offset Umidade:</label><input type=number step=0.1 id=input_offset_umid><button onclick=\"setConfig('offset_umid')\">Definir</button></div>"
-    "<div class=form-group><label>Offset Pressão:</label><input type=number step=0.1 id=input_offset_press><button onclick=\"setConfig('offset_press')\">Definir</button></div>"
-    "<div class=form-group><label>Offset Altitude:</label><input type=number step=0.1 id=input_offset_alt><button onclick=\"setConfig('offset_alt')\">Definir</button></div></div>"
-    "<h2>Configurações de Alertas</h2><div class=form-grid>"
-    "<div class=form-group><label>Limites Temperatura (°C):</label><div class=limit-inputs><input type=number placeholder=Min id=input_limite_min_temp> <input type=number placeholder=Max id=input_limite_max_temp></div><button onclick=\"setLimits('temp')\">Definir</button></div>"
-    "<div class=form-group><label>Limites Umidade (%):</label><div class=limit-inputs><input type=number placeholder=Min id=input_limite_min_umid> <input type=number placeholder=Max id=input_limite_max_umid></div><button onclick=\"setLimits('umid')\">Definir</button></div>"
-    "<div class=form-group><label>Limites Pressão (hPa):</label><div class=limit-inputs><input type=number placeholder=Min id=input_limite_min_press> <input type=number placeholder=Max id=input_limite_max_press></div><button onclick=\"setLimits('press')\">Definir</button></div>"
-    "<div class=form-group><label>Limites Altitude (m):</label><div class=limit-inputs><input type=number placeholder=Min id=input_limite_min_alt> <input type=number placeholder=Max id=input_limite_max_alt></div><button onclick=\"setLimits('alt')\">Definir</button></div>"
-    "</div></div></body></html>";
+// O HTML/CSS/JavaScript da interface fica em web/index.html. Durante o build o CMake
+// comprime o arquivo com gzip e gera "index_html.h" com o array INDEX_HTML (em flash),
+// seu tamanho INDEX_HTML_LEN e o ETag INDEX_HTML_ETAG derivado do conteúdo. O gráfico
+// de linha usado pela página (web/grafico.js) é embutido do mesmo jeito em "grafico_js.h".
+#include "index_html.h"
+#include "grafico_js.h"
 
+// A página é revalidada a cada carga; o script é imutável, pois a URL pedida pela página
+// já leva a versão do arquivo (ver cmake/web_assets.cmake)
+#define HTTP_CACHE_PAGINA       "no-cache"
+#define HTTP_CACHE_IMUTAVEL     "public, max-age=31536000, immutable"
 
 // =================================================================================
 // LÓGICA DO SERVIDOR
 // =================================================================================
 
+// Conexões persistentes (HTTP/1.1 keep-alive)
+#define HTTP_TX_BUF_SIZE            1024  // Cabeçalhos da resposta e área de montagem dos chunks
+#define HTTP_MAX_REQUESTS_PER_CONN  100   // Após N respostas a conexão é encerrada
+#define HTTP_IDLE_TIMEOUT_S         10    // Conexão ociosa por mais que isso é fechada
+#define HTTP_POLL_INTERVAL          2     // Intervalo do tcp_poll em unidades de 500 ms (1 s)
+#define HTTP_RX_PENDENTE_MAX        2048  // Bytes em pipeline retidos enquanto a resposta anterior é enviada
+
+// Pool estático de conexões: a memória do servidor é fixa, independente do número de clientes.
+// Deve ser menor que MEMP_NUM_TCP_PCB para sobrar um PCB para responder 503.
+#define HTTP_MAX_CONNECTIONS        4
+#define HTTP_RETRY_AFTER_S          2     // Valor do Retry-After quando o pool está cheio
+
+// Janela de /historico quando o pedido não traz ?janela=<s>
+#define HISTORICO_JANELA_PADRAO_S   3600
+
 typedef enum { SENDING_HEADERS, SENDING_BODY } SENDING_PHASE;
-typedef struct HTTP_STATE_T {
-    char response_buffer[2048];
+typedef struct HTTP_STATE_T HTTP_STATE;
+typedef struct HTTP_CACHE_T HTTP_CACHE;
+
+// Gerador de corpo: emite o próximo trecho em buf (até cap bytes), retorna quantos bytes
+// escreveu e marca body_done quando o corpo termina. É chamado de novo a cada ACK.
+typedef size_t (*HTTP_BODY_WRITER)(HTTP_STATE *state, char *buf, size_t cap);
+
+struct HTTP_STATE_T {
+    struct tcp_pcb *pcb;
+
+    // Resposta atual
     const char *response_ptr;  
     size_t response_len;       
     SENDING_PHASE phase;       
-} HTTP_STATE;
+    // Corpo enviado após os cabeçalhos sem cópia (dados constantes em flash)
+    const uint8_t *body_ptr;
+    size_t body_len;
+    // Corpo gerado sob demanda, direto no buffer de envio (ex.: JSON de /dados_sensores)
+    HTTP_BODY_WRITER body_writer;
+    bool body_done;
+    bool chunked;           // Corpo gerado vai com Transfer-Encoding: chunked
+    bool sse;               // Resposta a /stream: a conexão vira assinante após os cabeçalhos
+    bool websocket;         // Handshake de /ws aceito: a conexão vira assinante após o 101
+    union {                 // Estado do gerador de corpo em uso
+        JSON_CURSOR json;
+        TELEMETRIA_CURSOR bin;
+        size_t cache_pos;
+    };
+    HTTP_CACHE *cache;      // Corpo copiado de um cache de respostas (que não muda até terminar)
+
+    bool keep_alive;        // Mantém a conexão aberta depois da resposta atual
+    bool http11;            // Cliente fala HTTP/1.1 (aceita chunked)
+    uint16_t requests;      // Requisições atendidas nesta conexão
+    uint8_t idle_polls;     // Chamadas de http_poll sem nenhuma atividade
+    bool fin_recebido;      // O cliente encerrou o envio: fecha depois das respostas pendentes
+    // pbufs recebidos e ainda não consumidos pelo parser. Só os bytes consumidos são
+    // confirmados com tcp_recved, então requisições em pipeline esperam na própria cadeia
+    // da lwIP (e reduzem a janela do cliente) sem cópia para um buffer da conexão.
+    struct pbuf *rx_pbuf;
+
+    // Estruturas grandes ficam no fim: só os campos acima são zerados ao reutilizar o slot.
+    HTTP_REQUISICAO req;    // Requisição em leitura
+    char response_buffer[HTTP_TX_BUF_SIZE];
+};
+
+static HTTP_STATE http_pool[HTTP_MAX_CONNECTIONS];
+static HTTP_STATE *http_free_slots[HTTP_MAX_CONNECTIONS];  // Pilha de slots livres
+static uint8_t http_free_count;
+static HTTP_SERVER_STATS http_stats;
+
+// Resposta enviada quando não há slot livre. Constante em flash, enviada sem cópia.
+static const char HTTP_RESPONSE_503[] =
+    "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\nRetry-After: "
+    HTTP_STR(HTTP_RETRY_AFTER_S) "\r\nContent-Length: 0\r\n\r\n";
+
+static void http_pool_init(void) {
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        http_free_slots[i] = &http_pool[i];
+    }
+    http_free_count = HTTP_MAX_CONNECTIONS;
+}
+
+/**
+ * @brief Retira um slot livre do pool em O(1).
+ * @return O slot com o estado zerado, ou NULL se todas as conexões estão em uso.
+ */
+static HTTP_STATE *http_pool_acquire(void) {
+    if (http_free_count == 0) {
+        http_stats.conns_rejected++;
+        return NULL;
+    }
+    HTTP_STATE *state = http_free_slots[--http_free_count];
+    memset(state, 0, offsetof(HTTP_STATE, req));
+    http_parser_iniciar(&state->req);
+
+    uint16_t active = HTTP_MAX_CONNECTIONS - http_free_count;
+    if (active > http_stats.conns_high_water) {
+        http_stats.conns_high_water = active;
+    }
+    return state;
+}
+
+static void http_cache_liberar(HTTP_STATE *state);
+
+static void http_pool_release(HTTP_STATE *state) {
+    http_cache_liberar(state);
+    http_free_slots[http_free_count++] = state;
+}
 
-static void http_close_and_free(struct tcp_pcb *tpcb, HTTP_STATE *state) {
+/**
+ * @brief Desassocia o estado do PCB (remove os callbacks) e libera o estado.
+ * @return O PCB, para que o chamador decida entre fechar ou abortar a conexão.
+ */
+static struct tcp_pcb *http_detach(HTTP_STATE *state) {
+    struct tcp_pcb *tpcb = state->pcb;
     tcp_arg(tpcb, NULL);
     tcp_sent(tpcb, NULL);
     tcp_recv(tpcb, NULL);
     tcp_err(tpcb, NULL);
-    if (state) {
-        free(state);
+    tcp_poll(tpcb, NULL, 0);
+    if (state->rx_pbuf) {
+        tcp_recved(tpcb, state->rx_pbuf->tot_len);
+        pbuf_free(state->rx_pbuf);
+        state->rx_pbuf = NULL;
+    }
+    http_pool_release(state);
+    return tpcb;
+}
+
+/**
+ * @brief Encerra a conexão e libera o estado.
+ * @return ERR_OK se a conexão foi fechada normalmente, ERR_ABRT se precisou ser abortada
+ *         (nesse caso o callback que chamou deve retornar ERR_ABRT à lwIP).
+ */
+static err_t http_close(HTTP_STATE *state) {
+    struct tcp_pcb *tpcb = http_detach(state);
+    if (tcp_close(tpcb) != ERR_OK) {
+        tcp_abort(tpcb);
+        return ERR_ABRT;
     }
-    tcp_close(tpcb);
+    return ERR_OK;
+}
+
+/**
+ * @brief Aborta a conexão (envia RST) e libera o estado. Usado em erros irrecuperáveis.
+ * @return ERR_ABRT, que deve ser repassado à lwIP pelo callback que chamou.
+ */
+static err_t http_abort(HTTP_STATE *state) {
+    tcp_abort(http_detach(state));
+    return ERR_ABRT;
 }
 
 static void http_err(void *arg, err_t err) {
-    if (arg) {
-        free(arg);
+    // A lwIP já liberou o PCB; resta apenas liberar os pbufs retidos e devolver o slot ao pool
+    HTTP_STATE *state = (HTTP_STATE *)arg;
+    if (state) {
+        if (state->rx_pbuf) {
+            pbuf_free(state->rx_pbuf);
+            state->rx_pbuf = NULL;
+        }
+        http_pool_release(state);
     }
 }
 
-static err_t http_send_data(struct tcp_pcb *tpcb, HTTP_STATE *state) {
-    u16_t available_len = tcp_sndbuf(tpcb);
-    if (available_len > TCP_MSS) {
-        available_len = TCP_MSS;
+static bool http_response_pending(HTTP_STATE *state) {
+    return state->response_len > 0 ||
+           (state->phase == SENDING_HEADERS && state->body_ptr) ||
+           (state->body_writer && !state->body_done);
+}
+
+// Espaço reservado em volta de cada chunk: "XXXX\r\n" antes, "\r\n" e o chunk final "0\r\n\r\n" depois
+#define HTTP_CHUNK_HEAD   6
+#define HTTP_CHUNK_TAIL   (2 + 5)
+
+/**
+ * @brief Gera o próximo trecho do corpo em response_buffer, já com o enquadramento chunked.
+ * O tamanho do trecho é limitado pelo espaço livre no buffer de envio TCP, para que
+ * tudo o que for gerado possa ser entregue ao tcp_write imediatamente.
+ * @return false se não há espaço suficiente agora (retoma em http_sent).
+ */
+static bool http_generate_chunk(HTTP_STATE *state) {
+    size_t framing = state->chunked ? HTTP_CHUNK_HEAD + HTTP_CHUNK_TAIL : 0;
+    size_t cap = tcp_sndbuf(state->pcb);
+    if (cap > sizeof(state->response_buffer)) {
+        cap = sizeof(state->response_buffer);
     }
-    u16_t send_len = state->response_len < available_len ? state->response_len : available_len;
-    if (send_len == 0) return ERR_OK;
+    if (cap < JSON_DADOS_MIN_CAP + framing) {
+        return false;
+    }
+    cap -= framing;
 
-    err_t err = tcp_write(tpcb, state->response_ptr, send_len, TCP_WRITE_FLAG_COPY);
-    if (err != ERR_OK) {
-        http_close_and_free(tpcb, state);
-        return err;
+    char *data = state->response_buffer + (state->chunked ? HTTP_CHUNK_HEAD : 0);
+    size_t len = state->body_writer(state, data, cap);
+
+    if (!state->chunked) {
+        state->response_ptr = data;
+        state->response_len = len;
+        return len > 0;
     }
-    state->response_ptr += send_len;
-    state->response_len -= send_len;
-    return ERR_OK;
+
+    size_t total = 0;
+    if (len > 0) {
+        // Tamanho em hexadecimal com largura fixa para caber no espaço reservado
+        char head[HTTP_CHUNK_HEAD + 1];
+        snprintf(head, sizeof(head), "%04X\r\n", (unsigned)len);
+        memcpy(state->response_buffer, head, HTTP_CHUNK_HEAD);
+        memcpy(data + len, "\r\n", 2);
+        total = HTTP_CHUNK_HEAD + len + 2;
+    } else if (!state->body_done) {
+        return false;
+    }
+    if (state->body_done) {
+        // Chunk de tamanho zero encerra o corpo
+        memcpy(state->response_buffer + total, "0\r\n\r\n", 5);
+        total += 5;
+    }
+    state->response_ptr = state->response_buffer;
+    state->response_len = total;
+    return true;
 }
 
-static err_t http_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
-    HTTP_STATE *state = (HTTP_STATE *)arg;
-    if (state->response_len > 0) {
-        http_send_data(tpcb, state);
+static err_t http_send_data(HTTP_STATE *state) {
+    struct tcp_pcb *tpcb = state->pcb;
+    while (true) {
+        if (state->response_len == 0) {
+            if (state->phase == SENDING_HEADERS && state->body_ptr) {
+                // Cabeçalhos esgotados: passa a enviar o corpo em flash
+                state->phase = SENDING_BODY;
+                state->response_ptr = (const char *)state->body_ptr;
+                state->response_len = state->body_len;
+            } else if (state->body_writer && !state->body_done) {
+                state->phase = SENDING_BODY;
+                if (!http_generate_chunk(state)) {
+                    return ERR_OK;
+                }
+            } else {
+                return ERR_OK;
+            }
+        }
+
+        // O corpo em flash é referenciado pela lwIP sem cópia; o buffer em RAM é copiado
+        bool from_flash = (state->phase == SENDING_BODY && state->body_ptr);
+        u16_t available_len = tcp_sndbuf(tpcb);
+        if (!from_flash && available_len > TCP_MSS) {
+            available_len = TCP_MSS;
+        }
+        u16_t send_len = state->response_len < available_len ? state->response_len : available_len;
+        if (send_len == 0) return ERR_OK;
+
+        err_t err = tcp_write(tpcb, state->response_ptr, send_len, from_flash ? 0 : TCP_WRITE_FLAG_COPY);
+        if (err == ERR_MEM) {
+            // Fila de envio cheia: continua em http_sent quando houver ACK
+            return ERR_OK;
+        }
+        if (err != ERR_OK) {
+            return http_abort(state);
+        }
+        state->response_ptr += send_len;
+        state->response_len -= send_len;
+        http_stats.bytes_sent += send_len;
+    }
+}
+
+/**
+ * @brief Escreve a linha de status e os cabeçalhos de conexão em response_buffer.
+ * @return Número de bytes escritos; os handlers acrescentam o restante da resposta a partir daí.
+ */
+static int http_write_status(HTTP_STATE *state, const char *status) {
+    if (state->keep_alive) {
+        return snprintf(state->response_buffer, sizeof(state->response_buffer),
+            "HTTP/1.1 %s\r\nConnection: keep-alive\r\nKeep-Alive: timeout=%d, max=%d\r\n",
+            status, HTTP_IDLE_TIMEOUT_S, HTTP_MAX_REQUESTS_PER_CONN - state->requests);
+    }
+    return snprintf(state->response_buffer, sizeof(state->response_buffer),
+        "HTTP/1.1 %s\r\nConnection: close\r\n", status);
+}
+
+/**
+ * @brief Prepara o estado para uma nova resposta (sem corpo, sem conversão em assinante).
+ */
+static void http_resposta_iniciar(HTTP_STATE *state) {
+    state->body_ptr = NULL;
+    state->body_len = 0;
+    state->body_writer = NULL;
+    state->body_done = false;
+    state->sse = false;
+    state->websocket = false;
+    state->phase = SENDING_HEADERS;
+}
+
+/**
+ * @brief Escreve uma resposta completa com corpo text/plain curto.
+ * @return Número de bytes escritos em response_buffer.
+ */
+static int http_write_texto(HTTP_STATE *state, const char *status, const char *msg) {
+    int n = http_write_status(state, status);
+    n += snprintf(state->response_buffer + n, sizeof(state->response_buffer) - n,
+        "Content-Type: text/plain\r\nContent-Length: %d\r\n\r\n%s", (int)strlen(msg), msg);
+    return n;
+}
+
+/**
+ * @brief Procura um parâmetro na query da requisição atual.
+ * A query é decodificada no próprio buffer, então só pode ser percorrida uma vez por requisição.
+ * @return O valor decodificado, ou NULL se o parâmetro não estiver presente.
+ */
+static const char *http_query_buscar(HTTP_REQUISICAO *req, const char *nome) {
+    char *cursor = req->query, *chave, *valor;
+    while (http_query_proximo(&cursor, &chave, &valor)) {
+        if (strcmp(chave, nome) == 0) {
+            return valor;
+        }
+    }
+    return NULL;
+}
+
+// Parâmetros aceitos em /config e nos comandos do WebSocket, com os nomes dos campos
+// de CONFIG_ESTACAO (os mesmos usados no JSON de /dados_sensores)
+typedef struct {
+    const char *nome;
+    bool inteiro;       // false = float
+    size_t campo;       // offsetof em CONFIG_ESTACAO
+} HTTP_CONFIG_PARAMETRO;
+
+#define HTTP_CONFIG_FLOAT(c)  { #c, false, offsetof(CONFIG_ESTACAO, c) }
+#define HTTP_CONFIG_INT(c)    { #c, true,  offsetof(CONFIG_ESTACAO, c) }
+
+static const HTTP_CONFIG_PARAMETRO HTTP_CONFIG_PARAMETROS[] = {
+    HTTP_CONFIG_FLOAT(offset_temp),
+    HTTP_CONFIG_FLOAT(offset_press),
+    HTTP_CONFIG_FLOAT(offset_umid),
+    HTTP_CONFIG_FLOAT(offset_alt),
+    HTTP_CONFIG_FLOAT(pressao_nivel_mar),
+    HTTP_CONFIG_INT(perfil_bmp280),
+    HTTP_CONFIG_INT(limite_min_temp),
+    HTTP_CONFIG_INT(limite_max_temp),
+    HTTP_CONFIG_INT(limite_min_umid),
+    HTTP_CONFIG_INT(limite_max_umid),
+    HTTP_CONFIG_INT(limite_min_press),
+    HTTP_CONFIG_INT(limite_max_press),
+    HTTP_CONFIG_INT(limite_min_alt),
+    HTTP_CONFIG_INT(limite_max_alt),
+};
+#define HTTP_CONFIG_N  (sizeof(HTTP_CONFIG_PARAMETROS) / sizeof(HTTP_CONFIG_PARAMETROS[0]))
+
+/**
+ * @brief Converte o valor de um parâmetro e o grava no campo correspondente de cfg.
+ * @return false se o valor não é um número válido para o campo.
+ */
+static bool http_config_atribuir(CONFIG_ESTACAO *cfg, const HTTP_CONFIG_PARAMETRO *par, const char *valor) {
+    char *fim;
+    void *campo = (char *)cfg + par->campo;
+    if (par->inteiro) {
+        long v = strtol(valor, &fim, 10);
+        if (fim == valor || *fim != '\0' || v < INT_MIN || v > INT_MAX) {
+            return false;
+        }
+        *(int *)campo = (int)v;
     } else {
-        if (state->phase == SENDING_HEADERS) {
-            state->phase = SENDING_BODY;
-            state->response_ptr = HTML_BODY;
-            state->response_len = strlen(HTML_BODY);
-            http_send_data(tpcb, state);
-        } else {
-            http_close_and_free(tpcb, state);
+        float v = strtof(valor, &fim);
+        if (fim == valor || *fim != '\0') {
+            return false;  // Faixa e NaN ficam para validar_config
+        }
+        *(float *)campo = v;
+    }
+    return true;
+}
+
+/**
+ * @brief Aplica um conjunto de parâmetros de configuração, como query/form
+ * ("limite_min_temp=10&limite_max_temp=30&offset_umid=-2") ou objeto JSON plano
+ * ({"limite_min_temp":10,"limite_max_temp":30}). Os parâmetros são gravados sobre uma cópia
+ * da configuração atual, o conjunto inteiro é validado e só então aplicado, num único
+ * passo: ou tudo muda, ou nada muda. Usada por /config e pelos comandos do WebSocket.
+ * @param texto Parâmetros, decodificados no próprio buffer.
+ * @param versao Recebe a nova versão da configuração.
+ * @return NULL se aplicou; senão o motivo da recusa (o nome do parâmetro rejeitado).
+ */
+static const char *http_aplicar_config(char *texto, uint32_t *versao) {
+    CONFIG_ESTACAO cfg;
+    get_config(&cfg);
+    bool json = texto[strspn(texto, " \t\r\n")] == '{';
+
+    char *cursor = texto, *chave, *valor;
+    int aplicados = 0;
+    while (true) {
+        int r = json ? http_json_proximo(&cursor, &chave, &valor) : http_query_proximo(&cursor, &chave, &valor);
+        if (r == 0) {
+            break;
         }
+        if (r < 0) {
+            return "json invalido";
+        }
+        const HTTP_CONFIG_PARAMETRO *par = NULL;
+        for (size_t i = 0; i < HTTP_CONFIG_N && !par; i++) {
+            if (strcmp(HTTP_CONFIG_PARAMETROS[i].nome, chave) == 0) par = &HTTP_CONFIG_PARAMETROS[i];
+        }
+        if (!par) {
+            return "parametro desconhecido";
+        }
+        if (!http_config_atribuir(&cfg, par, valor)) {
+            return par->nome;
+        }
+        aplicados++;
+    }
+    if (aplicados == 0) {
+        return "nenhum parametro";
+    }
+
+    const char *invalido = validar_config(&cfg);
+    if (invalido) {
+        return invalido;
+    }
+    *versao = aplicar_config(&cfg);
+    return NULL;
+}
+
+/**
+ * @brief Escreve o resultado de http_aplicar_config em JSON:
+ * {"ok":true,"versao":N} ou {"ok":false,"erro":"<motivo>"}.
+ * @return Ponteiro para o '\0' final.
+ */
+static char *http_config_resultado(char *p, const char *erro, uint32_t versao) {
+    if (erro) {
+        return fmt_texto(fmt_texto(fmt_texto(p, "{\"ok\":false,\"erro\":\""), erro), "\"}");
+    }
+    return fmt_texto(fmt_uint(fmt_texto(p, "{\"ok\":true,\"versao\":"), versao), "}");
+}
+
+// =================================================================================
+// ASSINANTES: SERVER-SENT EVENTS (/stream) E WEBSOCKET (/ws)
+// =================================================================================
+// Clientes de /stream e /ws deixam o pool HTTP depois do handshake e passam a ocupar uma
+// vaga leve na tabela de assinantes. Cada nova amostra ou mudança de alerta é renderizada
+// uma única vez, como evento SSE e como quadro WebSocket, e copiada para todos.
+// Pelo WebSocket o cliente também envia comandos de configuração, sem abrir novas conexões.
+
+#define ASSINANTES_MAX      8
+#define SSE_HEARTBEAT_S     15    // Sem eventos por esse tempo: SSE recebe um comentário, WebSocket um ping
+#define EVENTO_JSON_MAX     (48 + JSON_DADOS_AMOSTRA_MAX)
+#define WS_RX_BUF_SIZE      128   // Maior quadro aceito do cliente (comandos de configuração)
+#define WS_RESPOSTA_MAX     (WS_CABECALHO_MAX + 125)  // Maior quadro de resposta (pong)
+#define HTTP_CONFIG_RESULTADO_MAX  64                 // Maior saída de http_config_resultado
+
+typedef struct {
+    struct tcp_pcb *pcb;      // NULL = vaga livre
+    bool websocket;           // false = cliente de /stream
+    uint32_t geracao;         // Último evento entregue a este cliente
+    uint8_t polls_ociosos;
+    uint8_t rx_len;           // WebSocket: bytes recebidos e ainda não processados
+    uint8_t rx_buf[WS_RX_BUF_SIZE];
+} ASSINANTE;
+
+static ASSINANTE assinantes[ASSINANTES_MAX];
+static char sse_evento[EVENTO_JSON_MAX + 32];               // "id: N\ndata: <json>\n\n"
+static uint8_t ws_evento[WS_CABECALHO_MAX + EVENTO_JSON_MAX];  // Quadro de texto com <json>
+static u16_t sse_evento_len, ws_evento_len;
+static uint32_t evento_geracao;   // Incrementada a cada evento renderizado
+static uint8_t evento_alertas;    // Máscara de alertas do último evento
+static bool http_server_ativo;    // start_http_server() já foi chamada
+
+static void assinantes_publicar(void);
+
+/**
+ * @brief Renderiza o evento com a amostra mais recente e a máscara de alertas.
+ * O JSON tem o mesmo formato da resposta incremental de /dados_sensores.
+ */
+static void evento_renderizar(void) {
+    uint32_t seq = get_ultima_seq();
+    evento_alertas = calcular_alertas();
+    char json[EVENTO_JSON_MAX];
+    char *p = fmt_uint(fmt_texto(json, "{\"seq\":"), seq);
+    p = fmt_uint(fmt_texto(p, ",\"alertas\":"), evento_alertas);
+    p = fmt_texto(p, ",\"amostras\":[");
+    AMOSTRA a;
+    if (get_amostra(seq, &a)) {
+        p = json_dados_amostra(p, &a);
+    }
+    p = fmt_texto(p, "]}");
+    size_t json_len = p - json;
+
+    p = fmt_uint(fmt_texto(sse_evento, "id: "), seq);
+    p = fmt_texto(fmt_texto(fmt_texto(p, "\ndata: "), json), "\n\n");
+    sse_evento_len = p - sse_evento;
+    size_t cab = ws_quadro_cabecalho(ws_evento, WS_OP_TEXTO, (uint16_t)json_len);
+    memcpy(ws_evento + cab, json, json_len);
+    ws_evento_len = cab + json_len;
+    evento_geracao++;
+}
+
+static void assinante_remover(ASSINANTE *a) {
+    tcp_arg(a->pcb, NULL);
+    tcp_sent(a->pcb, NULL);
+    tcp_recv(a->pcb, NULL);
+    tcp_err(a->pcb, NULL);
+    tcp_poll(a->pcb, NULL, 0);
+    a->pcb = NULL;
+}
+
+static err_t assinante_abortar(ASSINANTE *a) {
+    struct tcp_pcb *pcb = a->pcb;
+    assinante_remover(a);
+    tcp_abort(pcb);
+    return ERR_ABRT;
+}
+
+static err_t assinante_fechar(ASSINANTE *a) {
+    struct tcp_pcb *pcb = a->pcb;
+    assinante_remover(a);
+    if (tcp_close(pcb) != ERR_OK) {
+        tcp_abort(pcb);
+        return ERR_ABRT;
     }
     return ERR_OK;
 }
 
-static void build_hist_string(char* dest, size_t dest_size, float* source) {
-    int offset = 0;
-    offset += snprintf(dest + offset, dest_size - offset, "[");
-    for(int i=0; i<20; ++i) {
-        offset += snprintf(dest + offset, dest_size - offset, "%.2f%s", source[i], (i<19) ? "," : "");
+/**
+ * @brief Entrega o evento atual ao cliente, se ele ainda não o recebeu.
+ * Sem espaço no buffer de envio o evento fica para o próximo sent/poll; um cliente lento
+ * pula eventos intermediários e recebe direto o mais recente.
+ */
+static err_t assinante_enviar_evento(ASSINANTE *a) {
+    const void *evento = a->websocket ? (const void *)ws_evento : (const void *)sse_evento;
+    u16_t len = a->websocket ? ws_evento_len : sse_evento_len;
+    if (a->geracao == evento_geracao || len == 0) {
+        return ERR_OK;
     }
-    snprintf(dest + offset, dest_size - offset, "]");
+    if (tcp_sndbuf(a->pcb) < len) {
+        return ERR_OK;
+    }
+    err_t err = tcp_write(a->pcb, evento, len, TCP_WRITE_FLAG_COPY);
+    if (err == ERR_MEM) {
+        return ERR_OK;
+    }
+    if (err != ERR_OK) {
+        return assinante_abortar(a);
+    }
+    a->geracao = evento_geracao;
+    a->polls_ociosos = 0;
+    http_stats.bytes_sent += len;
+    tcp_output(a->pcb);
+    return ERR_OK;
 }
 
-static err_t http_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+/**
+ * @brief Envia um quadro curto (até 125 bytes de payload) num único tcp_write, para que
+ * nunca fique um quadro pela metade no fluxo.
+ */
+static void ws_enviar_quadro(ASSINANTE *a, uint8_t opcode, const void *payload, size_t len) {
+    uint8_t quadro[WS_RESPOSTA_MAX];
+    size_t cab = ws_quadro_cabecalho(quadro, opcode, (uint16_t)len);
+    memcpy(quadro + cab, payload, len);
+    // Espaço verificado em ws_processar; se mesmo assim faltar memória a resposta é descartada
+    if (tcp_write(a->pcb, quadro, cab + len, TCP_WRITE_FLAG_COPY) == ERR_OK) {
+        http_stats.bytes_sent += cab + len;
+    }
+}
+
+/**
+ * @brief Responde ao fechamento (ou o inicia, em caso de erro de protocolo) com um quadro
+ * de fechamento e encerra a conexão TCP.
+ */
+static err_t ws_fechar(ASSINANTE *a, uint16_t codigo) {
+    uint8_t status[2] = { (uint8_t)(codigo >> 8), (uint8_t)codigo };
+    ws_enviar_quadro(a, WS_OP_FECHAR, status, sizeof(status));
+    tcp_output(a->pcb);
+    return assinante_fechar(a);
+}
+
+/**
+ * @brief Processa os quadros completos em rx_buf: comandos de configuração (texto),
+ * ping e fechamento. Cada quadro só é lido quando há espaço para a sua resposta; caso
+ * contrário fica em rx_buf e o processamento continua no próximo sent/poll.
+ */
+static err_t ws_processar(ASSINANTE *a) {
+    struct tcp_pcb *tpcb = a->pcb;
+    bool alertas_mudaram = false;
+
+    while (a->rx_len > 0) {
+        if (tcp_sndbuf(tpcb) < WS_RESPOSTA_MAX || tcp_sndqueuelen(tpcb) + 2 > TCP_SND_QUEUELEN) {
+            break;
+        }
+        WS_QUADRO q;
+        int total = ws_quadro_ler(a->rx_buf, a->rx_len, sizeof(a->rx_buf), &q);
+        if (total == 0) {
+            break;
+        }
+        if (total < 0) {
+            return ws_fechar(a, total == WS_QUADRO_GRANDE ? WS_FECHA_GRANDE_DEMAIS : WS_FECHA_PROTOCOLO);
+        }
+
+        if (q.opcode == WS_OP_TEXTO && q.fin) {
+            char comando[WS_RX_BUF_SIZE];
+            memcpy(comando, q.payload, q.payload_len);
+            comando[q.payload_len] = '\0';
+            uint32_t versao = 0;
+            const char *erro = http_aplicar_config(comando, &versao);
+            char resposta[HTTP_CONFIG_RESULTADO_MAX];
+            char *fim = http_config_resultado(resposta, erro, versao);
+            ws_enviar_quadro(a, WS_OP_TEXTO, resposta, fim - resposta);
+            if (!erro) {
+                alertas_mudaram |= calcular_alertas() != evento_alertas;
+            }
+        } else if (q.opcode == WS_OP_PING) {
+            ws_enviar_quadro(a, WS_OP_PONG, q.payload, q.payload_len);
+        } else if (q.opcode == WS_OP_FECHAR) {
+            // Devolve o código recebido, 1000 se o cliente não informou nenhum ou 1002 se
+            // o código não pode ir num quadro
+            return ws_fechar(a, ws_codigo_fechamento(&q));
+        } else if (q.opcode != WS_OP_PONG) {
+            // Mensagens binárias ou fragmentadas não fazem parte do protocolo de comandos
+            return ws_fechar(a, WS_FECHA_NAO_SUPORTADO);
+        }
+
+        a->rx_len -= total;
+        memmove(a->rx_buf, a->rx_buf + total, a->rx_len);
+        a->polls_ociosos = 0;
+    }
+    tcp_output(tpcb);
+
+    if (alertas_mudaram) {
+        // Limites novos podem ligar ou desligar alertas: avisa todos os assinantes
+        assinantes_publicar();
+        if (a->pcb != tpcb) {
+            return ERR_ABRT;  // Este cliente foi abortado durante o envio
+        }
+    }
+    return ERR_OK;
+}
+
+static err_t assinante_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    ASSINANTE *a = (ASSINANTE *)arg;
     if (!p) {
-        http_close_and_free(tpcb, (HTTP_STATE *)arg);
+        // O cliente fechou a conexão
+        return assinante_fechar(a);
+    }
+    if (!a->websocket) {
+        // Nada é esperado de um cliente de /stream depois da requisição: descarta
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
         return ERR_OK;
     }
+
+    if (p->tot_len > sizeof(a->rx_buf) - a->rx_len) {
+        if (a->rx_len > 0 && tcp_sndbuf(tpcb) < WS_RESPOSTA_MAX) {
+            // Quadros anteriores aguardam espaço para as respostas: a lwIP reentrega este pbuf depois
+            return ERR_MEM;
+        }
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+        return ws_fechar(a, WS_FECHA_GRANDE_DEMAIS);
+    }
+    pbuf_copy_partial(p, a->rx_buf + a->rx_len, p->tot_len, 0);
+    a->rx_len += p->tot_len;
     tcp_recved(tpcb, p->tot_len);
-    
-    char req_buffer[256];
-    pbuf_copy_partial(p, req_buffer, sizeof(req_buffer) - 1, 0);
-    req_buffer[sizeof(req_buffer) - 1] = '\0';
     pbuf_free(p);
+    return ws_processar(a);
+}
 
-    if (arg) { 
-        return ERR_OK;
+static err_t assinante_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    ASSINANTE *a = (ASSINANTE *)arg;
+    if (a->websocket && a->rx_len > 0 && ws_processar(a) == ERR_ABRT) {
+        return ERR_ABRT;
+    }
+    if (!a->pcb) {
+        return ERR_OK;  // Conexão fechada por ws_processar
+    }
+    return assinante_enviar_evento(a);
+}
+
+static err_t assinante_poll(void *arg, struct tcp_pcb *tpcb) {
+    ASSINANTE *a = (ASSINANTE *)arg;
+    if (!a) {
+        tcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+    if (a->websocket && a->rx_len > 0) {
+        return assinante_sent(arg, tpcb, 0);
+    }
+    if (a->geracao != evento_geracao) {
+        return assinante_enviar_evento(a);
+    }
+    if (++a->polls_ociosos * HTTP_POLL_INTERVAL / 2 >= SSE_HEARTBEAT_S) {
+        static const char heartbeat_sse[] = ":\n\n";
+        static const uint8_t heartbeat_ws[] = { 0x80 | WS_OP_PING, 0x00 };
+        err_t err = a->websocket ? tcp_write(tpcb, heartbeat_ws, sizeof(heartbeat_ws), 0)
+                                 : tcp_write(tpcb, heartbeat_sse, sizeof(heartbeat_sse) - 1, 0);
+        if (err == ERR_OK) {
+            http_stats.bytes_sent += a->websocket ? sizeof(heartbeat_ws) : sizeof(heartbeat_sse) - 1;
+            tcp_output(tpcb);
+        }
+        a->polls_ociosos = 0;
+    }
+    return ERR_OK;
+}
+
+static void assinante_err(void *arg, err_t err) {
+    // PCB já liberado pela lwIP: só libera a vaga
+    if (arg) {
+        ((ASSINANTE *)arg)->pcb = NULL;
+    }
+}
+
+static bool assinante_tem_vaga(void) {
+    for (int i = 0; i < ASSINANTES_MAX; i++) {
+        if (!assinantes[i].pcb) return true;
+    }
+    return false;
+}
+
+static uint16_t assinantes_contar(bool websocket) {
+    uint16_t total = 0;
+    for (int i = 0; i < ASSINANTES_MAX; i++) {
+        if (assinantes[i].pcb && assinantes[i].websocket == websocket) total++;
+    }
+    return total;
+}
+
+/**
+ * @brief Transfere uma conexão (com a resposta do handshake já enfileirada) para a
+ * tabela de assinantes e envia o evento atual.
+ */
+static err_t assinante_adicionar(struct tcp_pcb *tpcb, bool websocket) {
+    for (int i = 0; i < ASSINANTES_MAX; i++) {
+        ASSINANTE *a = &assinantes[i];
+        if (a->pcb) continue;
+
+        a->pcb = tpcb;
+        a->websocket = websocket;
+        a->geracao = evento_geracao - 1;  // Força o envio do evento atual
+        a->polls_ociosos = 0;
+        a->rx_len = 0;
+        tcp_arg(tpcb, a);
+        tcp_recv(tpcb, assinante_recv);
+        tcp_sent(tpcb, assinante_sent);
+        tcp_err(tpcb, assinante_err);
+        tcp_poll(tpcb, assinante_poll, HTTP_POLL_INTERVAL);
+        if (evento_geracao == 0) {
+            evento_renderizar();
+        }
+        return assinante_enviar_evento(a);
+    }
+    // Vaga verificada em http_handle_request; não deve acontecer
+    tcp_abort(tpcb);
+    return ERR_ABRT;
+}
+
+/**
+ * @brief Renderiza o evento atual e o envia a todos os assinantes.
+ * Deve ser chamada no contexto da lwIP.
+ */
+static void assinantes_publicar(void) {
+    evento_renderizar();
+    for (int i = 0; i < ASSINANTES_MAX; i++) {
+        if (assinantes[i].pcb) {
+            assinante_enviar_evento(&assinantes[i]);
+        }
+    }
+}
+
+/**
+ * @brief Gerador do corpo de /dados_sensores: repassa ao serializador incremental.
+ */
+static size_t http_write_json_dados(HTTP_STATE *state, char *buf, size_t cap) {
+    size_t len = json_dados_escrever(&state->json, buf, cap);
+    state->body_done = state->json.concluido;
+    return len;
+}
+
+/**
+ * @brief Gerador do corpo de /dados.bin.
+ */
+static size_t http_write_telemetria_bin(HTTP_STATE *state, char *buf, size_t cap) {
+    size_t len = telemetria_bin_escrever(&state->bin, (uint8_t *)buf, cap);
+    state->body_done = state->bin.concluido;
+    return len;
+}
+
+// =================================================================================
+// CACHE DE RESPOSTAS
+// =================================================================================
+// Os dados mudam só a cada amostra (2 s) ou alteração de configuração, então cada corpo
+// é renderizado uma vez por geração (seq da amostra + versão da configuração) e todas as
+// requisições seguintes copiam o mesmo buffer. Dez painéis consultando a estação custam
+// uma renderização, não dez. A renderização é feita pela primeira requisição da geração.
+//
+// O corpo é copiado do cache para o buffer de envio (TCP_WRITE_FLAG_COPY), nunca
+// referenciado direto, e o cache não é renderizado de novo enquanto alguma resposta
+// ainda o copia: essa resposta termina com a versão anterior, inteira.
+
+struct HTTP_CACHE_T {
+    char *buf;
+    size_t cap;
+    size_t len;
+    // Geração renderizada, mais um parâmetro da requisição (ex.: "since")
+    uint32_t seq, versao, chave;
+    bool renderizado;       // A chave acima vale (mesmo que o corpo não tenha cabido)
+    bool valido;            // O corpo coube inteiro em buf
+    uint8_t leitores;       // Respostas copiando buf agora
+    // Renderiza o corpo para a chave em buf. Retorna false se não couber.
+    bool (*renderizar)(HTTP_CACHE *cache);
+};
+
+static bool http_render_json(HTTP_CACHE *cache, bool incremental) {
+    JSON_CURSOR cursor;
+    json_dados_iniciar(&cursor, cache->chave, incremental);
+    cache->len = json_dados_escrever(&cursor, cache->buf, cache->cap);
+    return cursor.concluido;
+}
+
+static bool http_render_json_completo(HTTP_CACHE *cache) {
+    return http_render_json(cache, false);
+}
+
+static bool http_render_json_incremental(HTTP_CACHE *cache) {
+    return http_render_json(cache, true);
+}
+
+static bool http_render_metricas(HTTP_CACHE *cache) {
+    HTTP_SERVER_STATS stats;
+    http_server_get_stats(&stats);
+    return metricas_renderizar(cache->buf, cache->cap, &stats, &cache->len);
+}
+
+// Documento completo de /dados_sensores: ~34 bytes por amostra do histórico. Só cabe
+// no cache logo após o boot; com o histórico cheio (~60 KB com HIST_LEN = 1800) é gerado
+// em partes a cada pedido (o cache passa a servir só as respostas incrementais)
+#define HTTP_CACHE_JSON_MAX             2048
+// Resposta a ?since=<seq>: normalmente uma ou duas amostras
+#define HTTP_CACHE_JSON_INC_MAX         512
+
+static char cache_json_buf[HTTP_CACHE_JSON_MAX];
+static char cache_json_inc_buf[HTTP_CACHE_JSON_INC_MAX];
+static char cache_metricas_buf[METRICAS_MAX];
+
+static HTTP_CACHE cache_json = {
+    cache_json_buf, sizeof(cache_json_buf), .renderizar = http_render_json_completo };
+static HTTP_CACHE cache_json_incremental = {
+    cache_json_inc_buf, sizeof(cache_json_inc_buf), .renderizar = http_render_json_incremental };
+static HTTP_CACHE cache_metricas = {
+    cache_metricas_buf, sizeof(cache_metricas_buf), .renderizar = http_render_metricas };
+
+static void http_cache_liberar(HTTP_STATE *state) {
+    if (state->cache) {
+        state->cache->leitores--;
+        state->cache = NULL;
+    }
+}
+
+/**
+ * @brief Gerador de corpo para respostas servidas de um cache: copia o próximo trecho.
+ */
+static size_t http_write_cache(HTTP_STATE *state, char *buf, size_t cap) {
+    HTTP_CACHE *cache = state->cache;
+    size_t len = cache->len - state->cache_pos;
+    if (len > cap) {
+        len = cap;
     }
-    
-    HTTP_STATE *state = malloc(sizeof(HTTP_STATE));
-    tcp_arg(tpcb, state);
-
-    if (strncmp(req_buffer, "GET / ", 6) == 0) {
-        state->phase = SENDING_HEADERS;
-        state->response_len = snprintf(state->response_buffer, sizeof(state->response_buffer),
-            "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Type: text/html\r\nContent-Length: %d\r\n\r\n", strlen(HTML_BODY));
-        state->response_ptr = state->response_buffer;
-
-    } else if (strncmp(req_buffer, "GET /dados_sensores", 19) == 0) {
-        state->phase = SENDING_BODY;
-        SENSOR_DATA* data = get_sensor_data();
-        char json_body[2048]; 
-        char hist_temp_str[300], hist_umid_str[300], hist_press_str[300], hist_alt_str[300];
-        
-        build_hist_string(hist_temp_str, sizeof(hist_temp_str), data->hist_temp);
-        build_hist_string(hist_umid_str, sizeof(hist_umid_str), data->hist_umid);
-        build_hist_string(hist_press_str, sizeof(hist_press_str), data->hist_press);
-        build_hist_string(hist_alt_str, sizeof(hist_alt_str), data->hist_alt);
-        
-        snprintf(json_body, sizeof(json_body),
-            "{\"temp\":%.2f,\"umid\":%.2f,\"press\":%.2f,\"alt\":%.2f,"
-            "\"offset_temp\":%.2f,\"offset_press\":%.2f,\"offset_umid\":%.2f,\"offset_alt\":%.2f,"
-            "\"limite_min_temp\":%d,\"limite_max_temp\":%d,"
-            "\"limite_min_umid\":%d,\"limite_max_umid\":%d,"
-            "\"limite_min_press\":%d,\"limite_max_press\":%d,"
-            "\"limite_min_alt\":%d,\"limite_max_alt\":%d,"
-            "\"hist_labels\":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20],"
-            "\"hist_temp\":%s,\"hist_umid\":%s,\"hist_press\":%s,\"hist_alt\":%s}",
-            data->temperatura_bmp, data->umidade_aht, data->pressao_hpa, data->altitude,
-            data->offset_temp, data->offset_press, data->offset_umid, data->offset_alt,
-            data->limite_min_temp, data->limite_max_temp, data->limite_min_umid, data->limite_max_umid,
-            data->limite_min_press, data->limite_max_press, data->limite_min_alt, data->limite_max_alt,
-            hist_temp_str, hist_umid_str, hist_press_str, hist_alt_str);
-        
-        state->response_len = snprintf(state->response_buffer, sizeof(state->response_buffer),
-            "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s",
-            strlen(json_body), json_body);
-        state->response_ptr = state->response_buffer;
-
-    } else if (strncmp(req_buffer, "GET /config?", 12) == 0) {
-        state->phase = SENDING_BODY;
-        char* value_ptr;
-        
-        if ((value_ptr = strstr(req_buffer, "offset_temp="))) { set_temp_offset(atof(value_ptr + 12)); }
-        else if ((value_ptr = strstr(req_buffer, "offset_umid="))) { set_umid_offset(atof(value_ptr + 12)); }
-        else if ((value_ptr = strstr(req_buffer, "offset_press="))) { set_press_offset(atof(value_ptr + 13)); }
-        else if ((value_ptr = strstr(req_buffer, "offset_alt="))) { set_alt_offset(atof(value_ptr + 11)); }
-        else { 
-            char* min_str, *max_str;
-            if ((min_str = strstr(req_buffer, "limite_min_temp=")) && (max_str = strstr(req_buffer, "limite_max_temp="))) {
-                set_limites_temp(atoi(min_str + 16), atoi(max_str + 16));
-            } else if ((min_str = strstr(req_buffer, "limite_min_umid=")) && (max_str = strstr(req_buffer, "limite_max_umid="))) {
-                set_limites_umid(atoi(min_str + 16), atoi(max_str + 16));
-            } else if ((min_str = strstr(req_buffer, "limite_min_press=")) && (max_str = strstr(req_buffer, "limite_max_press="))) {
-                set_limites_press(atoi(min_str + 17), atoi(max_str + 17));
-            } else if ((min_str = strstr(req_buffer, "limite_min_alt=")) && (max_str = strstr(req_buffer, "limite_max_alt="))) {
-                set_limites_alt(atoi(min_str + 15), atoi(max_str + 15));
+    memcpy(buf, cache->buf + state->cache_pos, len);
+    state->cache_pos += len;
+    if (state->cache_pos == cache->len) {
+        state->body_done = true;
+        http_cache_liberar(state);
+    }
+    return len;
+}
+
+/**
+ * @brief Prepara a resposta para sair do cache, renderizando-o antes se a geração mudou.
+ * Com cache ocupado por outra resposta, uma geração anterior da mesma chave é servida
+ * como está (no máximo uma amostra atrás).
+ * @return false se o corpo não está disponível no cache (não coube, ou o cache está
+ *         ocupado com outra chave): o chamador deve gerar o corpo por conta própria.
+ */
+static bool http_cache_usar(HTTP_STATE *state, HTTP_CACHE *cache, uint32_t chave) {
+    uint32_t seq = get_ultima_seq(), versao = get_config_versao();
+    bool atual = cache->renderizado && cache->seq == seq && cache->versao == versao && cache->chave == chave;
+    if (!atual) {
+        if (cache->leitores == 0) {
+            cache->seq = seq;
+            cache->versao = versao;
+            cache->chave = chave;
+            cache->renderizado = true;
+            cache->valido = cache->renderizar(cache) && cache->len > 0;
+        } else if (cache->chave != chave) {
+            return false;
+        }
+    }
+    if (!cache->valido) {
+        return false;
+    }
+    state->body_writer = http_write_cache;
+    state->cache = cache;
+    state->cache_pos = 0;
+    cache->leitores++;
+    // Tamanho conhecido: vai com Content-Length, sem chunked
+    state->chunked = false;
+    return true;
+}
+
+// =================================================================================
+// ROTAS
+// =================================================================================
+// Cada handler monta a resposta em response_buffer (e, se houver, prepara o corpo) e
+// retorna o número de bytes escritos. A conexão e o keep-alive já estão definidos.
+
+/**
+ * @brief Se alguma ETag da lista de If-None-Match é a do arquivo. A comparação é fraca
+ * (RFC 9110, seção 13.1.2): "W/" é ignorado, e "*" corresponde a qualquer versão.
+ */
+static bool http_etag_corresponde(const char *lista, const char *etag) {
+    size_t etag_len = strlen(etag), len;
+    const char *item;
+    while (http_lista_proximo(&lista, &item, &len)) {
+        if (len == 1 && *item == '*') {
+            return true;
+        }
+        if (len > 2 && item[0] == 'W' && item[1] == '/') {
+            item += 2;
+            len -= 2;
+        }
+        if (len == etag_len && memcmp(item, etag, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Se o parâmetro q de um elemento de Accept-Encoding ("gzip;q=0.5") vale zero,
+ * o que recusa a codificação.
+ */
+static bool http_q_zero(const char *parametros, const char *fim) {
+    for (const char *p = parametros; p + 2 <= fim; p++) {
+        if ((p[0] == 'q' || p[0] == 'Q') && p[1] == '=') {
+            p += 2;
+            if (p == fim || *p != '0') {
+                return false;
             }
+            for (p++; p < fim && (*p == '.' || *p == '0'); p++) {}
+            return p == fim || *p == ' ' || *p == '\t' || *p == ';';
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Se o cliente aceita o corpo em gzip. Sem Accept-Encoding, qualquer codificação
+ * é aceita (RFC 9110, seção 12.5.3); com ele, vale "gzip", "x-gzip" ou, na falta
+ * destes, "*", desde que não tenham q=0.
+ */
+static bool http_aceita_gzip(const HTTP_REQUISICAO *req) {
+    if (!req->presente[HTTP_CAB_ACCEPT_ENCODING]) {
+        return true;
+    }
+    const char *lista = http_cabecalho(req, HTTP_CAB_ACCEPT_ENCODING), *item;
+    size_t len;
+    int curinga = -1;   // -1: "*" ausente; senão se ele aceita
+    while (http_lista_proximo(&lista, &item, &len)) {
+        const char *fim = item + len;
+        const char *parametros = memchr(item, ';', len);
+        size_t nome = (parametros ? (size_t)(parametros - item) : len);
+        while (nome > 0 && (item[nome - 1] == ' ' || item[nome - 1] == '\t')) {
+            nome--;
+        }
+        bool aceita = !parametros || !http_q_zero(parametros, fim);
+        if ((nome == 4 && strncasecmp(item, "gzip", 4) == 0) ||
+            (nome == 6 && strncasecmp(item, "x-gzip", 6) == 0)) {
+            return aceita;
+        }
+        if (nome == 1 && *item == '*') {
+            curinga = aceita;
         }
+    }
+    return curinga == 1;
+}
 
-        const char* msg = "OK";
-        state->response_len = snprintf(state->response_buffer, sizeof(state->response_buffer),
-            "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Type: text/plain\r\nContent-Length: %d\r\n\r\n%s", strlen(msg), msg);
-        state->response_ptr = state->response_buffer;
-        
+/**
+ * @brief Responde com um arquivo estático gzip em flash, com revalidação por ETag.
+ * O corpo é enviado direto da flash (body_ptr), sem cópia para RAM. Não há cópia sem
+ * compressão: clientes que recusam gzip recebem 406.
+ */
+static int http_servir_arquivo(HTTP_STATE *state, const char *tipo, const uint8_t *dados,
+                               int len, const char *etag, const char *cache) {
+    char *buf = state->response_buffer;
+    size_t size = sizeof(state->response_buffer);
+    int n;
+    if (!http_aceita_gzip(&state->req)) {
+        n = http_write_status(state, "406 Not Acceptable");
+        n += snprintf(buf + n, size - n, "Vary: Accept-Encoding\r\nContent-Length: 0\r\n\r\n");
+    } else if (http_etag_corresponde(http_cabecalho(&state->req, HTTP_CAB_IF_NONE_MATCH), etag)) {
+        // O navegador já tem esta versão do arquivo em cache
+        n = http_write_status(state, "304 Not Modified");
+        n += snprintf(buf + n, size - n, "Vary: Accept-Encoding\r\nETag: %s\r\nCache-Control: %s\r\n\r\n",
+                      etag, cache);
     } else {
-        state->phase = SENDING_BODY;
+        n = http_write_status(state, "200 OK");
+        n += snprintf(buf + n, size - n,
+            "Content-Type: %s\r\n"
+            "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\nETag: %s\r\nCache-Control: %s\r\n"
+            "Content-Length: %d\r\n\r\n", tipo, etag, cache, len);
+        state->body_ptr = dados;
+        state->body_len = len;
+    }
+    return n;
+}
+
+/**
+ * @brief GET /: página principal.
+ */
+static int rota_pagina(HTTP_STATE *state) {
+    return http_servir_arquivo(state, "text/html; charset=utf-8", INDEX_HTML, INDEX_HTML_LEN,
+                               INDEX_HTML_ETAG, HTTP_CACHE_PAGINA);
+}
+
+/**
+ * @brief GET /grafico.js: gráfico de linha em canvas usado pela página.
+ */
+static int rota_grafico(HTTP_STATE *state) {
+    return http_servir_arquivo(state, "text/javascript; charset=utf-8", GRAFICO_JS, GRAFICO_JS_LEN,
+                               GRAFICO_JS_ETAG, HTTP_CACHE_IMUTAVEL);
+}
+
+/**
+ * @brief GET /dados_sensores. "?since=<seq>" pede só as amostras posteriores a seq.
+ * O documento sai do cache da amostra atual; se ele não couber no cache, é gerado em
+ * partes direto no buffer de envio (ver http_generate_chunk).
+ */
+static int rota_dados_sensores(HTTP_STATE *state) {
+    const char *since = http_query_buscar(&state->req, "since");
+    uint32_t desde = since ? strtoul(since, NULL, 10) : 0;
+    HTTP_CACHE *cache = since ? &cache_json_incremental : &cache_json;
+    char *buf = state->response_buffer;
+    size_t size = sizeof(state->response_buffer);
+
+    if (http_cache_usar(state, cache, desde)) {
+        int n = http_write_status(state, "200 OK");
+        n += snprintf(buf + n, size - n,
+            "Content-Type: application/json\r\nCache-Control: no-store\r\nContent-Length: %u\r\n\r\n",
+            (unsigned)cache->len);
+        return n;
+    }
+
+    // Sem HTTP/1.1 não há chunked: o fim do corpo é o fechamento da conexão
+    if (!state->http11) {
+        state->keep_alive = false;
+    }
+    json_dados_iniciar(&state->json, desde, since != NULL);
+    state->body_writer = http_write_json_dados;
+    int n = http_write_status(state, "200 OK");
+    n += snprintf(buf + n, size - n, "Content-Type: application/json\r\nCache-Control: no-store\r\n%s\r\n",
+        state->chunked ? "Transfer-Encoding: chunked\r\n" : "");
+    return n;
+}
+
+/**
+ * @brief GET /historico?janela=<s>: mínimo, média e máximo por intervalo nos últimos
+ * `janela` segundos (padrão HISTORICO_JANELA_PADRAO_S), do nível agregado mais fino que
+ * cobre a janela. Formato em json_dados_iniciar_agregado; gerado em partes, como o
+ * documento completo de /dados_sensores.
+ */
+static int rota_historico(HTTP_STATE *state) {
+    const char *janela = http_query_buscar(&state->req, "janela");
+    uint32_t janela_s = janela ? strtoul(janela, NULL, 10) : HISTORICO_JANELA_PADRAO_S;
+    char *buf = state->response_buffer;
+    size_t size = sizeof(state->response_buffer);
+
+    if (!state->http11) {
+        state->keep_alive = false;
+    }
+    json_dados_iniciar_agregado(&state->json, janela_s);
+    state->body_writer = http_write_json_dados;
+    int n = http_write_status(state, "200 OK");
+    n += snprintf(buf + n, size - n, "Content-Type: application/json\r\nCache-Control: no-store\r\n%s\r\n",
+        state->chunked ? "Transfer-Encoding: chunked\r\n" : "");
+    return n;
+}
+
+/**
+ * @brief GET /log?de=<t>&ate=<t>: leituras gravadas no log em flash com tempo em [de, ate]
+ * (relógio do log, ver flash_log.h); sem parâmetros, o log inteiro. Gerado em partes
+ * direto da flash, como o documento completo de /dados_sensores.
+ */
+static int rota_log(HTTP_STATE *state) {
+    char *cursor = state->req.query, *chave, *valor;
+    uint32_t de = 0, ate = UINT32_MAX;
+    char *buf = state->response_buffer;
+    size_t size = sizeof(state->response_buffer);
+
+    // Dois parâmetros: a query é percorrida uma vez só (http_query_buscar a consumiria)
+    while (http_query_proximo(&cursor, &chave, &valor)) {
+        if (strcmp(chave, "de") == 0) {
+            de = strtoul(valor, NULL, 10);
+        } else if (strcmp(chave, "ate") == 0) {
+            ate = strtoul(valor, NULL, 10);
+        }
+    }
+    if (!state->http11) {
+        state->keep_alive = false;
+    }
+    json_dados_iniciar_log(&state->json, de, ate);
+    state->body_writer = http_write_json_dados;
+    int n = http_write_status(state, "200 OK");
+    n += snprintf(buf + n, size - n, "Content-Type: application/json\r\nCache-Control: no-store\r\n%s\r\n",
+        state->chunked ? "Transfer-Encoding: chunked\r\n" : "");
+    return n;
+}
+
+/**
+ * @brief GET /dados.bin: registro binário em ponto fixo (telemetria_bin.h); "?since=<seq>"
+ * acrescenta o histórico posterior a seq. O tamanho é conhecido de antemão: vai sem chunked.
+ */
+static int rota_dados_bin(HTTP_STATE *state) {
+    const char *since = http_query_buscar(&state->req, "since");
+    telemetria_bin_iniciar(&state->bin, since != NULL, since ? strtoul(since, NULL, 10) : 0);
+    state->body_writer = http_write_telemetria_bin;
+    state->chunked = false;
+    int n = http_write_status(state, "200 OK");
+    n += snprintf(state->response_buffer + n, sizeof(state->response_buffer) - n,
+        "Content-Type: application/octet-stream\r\nCache-Control: no-store\r\nContent-Length: %u\r\n\r\n",
+        (unsigned)telemetria_bin_tamanho(&state->bin));
+    return n;
+}
+
+/**
+ * @brief Handshake de /stream e /ws. A resposta é enfileirada aqui; a conexão passa a
+ * assinante em http_process, depois que ela foi entregue à lwIP.
+ */
+static int http_assinar(HTTP_STATE *state, bool websocket) {
+    char *buf = state->response_buffer;
+    size_t size = sizeof(state->response_buffer);
+    const HTTP_REQUISICAO *req = &state->req;
+    int n;
+
+    if (websocket && (strncasecmp(http_cabecalho(req, HTTP_CAB_UPGRADE), "websocket", 9) != 0 ||
+                      !req->presente[HTTP_CAB_WS_KEY])) {
+        n = http_write_texto(state, "400 Bad Request", "Requisicao de WebSocket invalida");
+    } else if (websocket && strcmp(http_cabecalho(req, HTTP_CAB_WS_VERSION), "13") != 0) {
+        n = http_write_status(state, "426 Upgrade Required");
+        n += snprintf(buf + n, size - n, "Sec-WebSocket-Version: 13\r\nContent-Length: 0\r\n\r\n");
+    } else if (!assinante_tem_vaga()) {
+        n = http_write_status(state, "503 Service Unavailable");
+        n += snprintf(buf + n, size - n,
+            "Retry-After: %d\r\nContent-Length: 0\r\n\r\n", HTTP_RETRY_AFTER_S);
+    } else if (websocket) {
+        const char *chave = http_cabecalho(req, HTTP_CAB_WS_KEY);
+        char aceite[WS_ACEITE_LEN + 1];
+        ws_calcular_aceite(chave, strlen(chave), aceite);
+        state->keep_alive = false;
+        state->websocket = true;
+        n = snprintf(buf, size,
+            "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            "Sec-WebSocket-Accept: %s\r\n\r\n", aceite);
+    } else {
+        // O corpo não tem tamanho definido: termina quando a conexão fecha
+        state->keep_alive = false;
+        state->sse = true;
+        n = http_write_status(state, "200 OK");
+        n += snprintf(buf + n, size - n,
+            "Content-Type: text/event-stream\r\nCache-Control: no-store\r\n\r\nretry: 3000\n\n");
+    }
+    return n;
+}
+
+static int rota_stream(HTTP_STATE *state) {
+    return http_assinar(state, false);
+}
+
+static int rota_ws(HTTP_STATE *state) {
+    return http_assinar(state, true);
+}
+
+/**
+ * @brief Aplica a configuração recebida e, se os alertas mudaram, avisa os assinantes.
+ * @return NULL se aplicou; senão o motivo da recusa.
+ */
+static const char *http_config(char *texto, uint32_t *versao) {
+    const char *erro = http_aplicar_config(texto, versao);
+    // Limites novos podem ligar ou desligar alertas: avisa os assinantes
+    if (!erro && calcular_alertas() != evento_alertas) {
+        assinantes_publicar();
+    }
+    return erro;
+}
+
+/**
+ * @brief GET /config?...: parâmetros na query (ver http_aplicar_config). Mantida para
+ * clientes antigos; responde em texto.
+ */
+static int rota_config(HTTP_STATE *state) {
+    uint32_t versao;
+    const char *erro = http_config(state->req.query, &versao);
+    return erro ? http_write_texto(state, "400 Bad Request", erro) : http_write_texto(state, "200 OK", "OK");
+}
+
+/**
+ * @brief POST /config: corpo em form (application/x-www-form-urlencoded) ou JSON, com
+ * qualquer subconjunto de offsets e limites, aplicado de uma vez. Responde com a nova
+ * versão da configuração, ou com o parâmetro rejeitado.
+ */
+static int rota_config_post(HTTP_STATE *state) {
+    uint32_t versao = 0;
+    const char *erro = http_config(state->req.corpo, &versao);
+    char json[HTTP_CONFIG_RESULTADO_MAX];
+    char *fim = http_config_resultado(json, erro, versao);
+
+    int n = http_write_status(state, erro ? "400 Bad Request" : "200 OK");
+    n += snprintf(state->response_buffer + n, sizeof(state->response_buffer) - n,
+        "Content-Type: application/json\r\nCache-Control: no-store\r\nContent-Length: %d\r\n\r\n%s",
+        (int)(fim - json), json);
+    return n;
+}
+
+/**
+ * @brief GET /metrics: formato de texto do Prometheus (ver metricas.h), servido do cache.
+ * O renderizador não gera em partes: sem o corpo no cache (ocupado, ou a exposição não
+ * coube em METRICAS_MAX), a resposta é 503 e o coletor tenta de novo no próximo intervalo.
+ * Uma exposição incompleta nunca sai como 200.
+ */
+static int rota_metricas(HTTP_STATE *state) {
+    int n;
+    if (!http_cache_usar(state, &cache_metricas, 0)) {
+        n = http_write_status(state, "503 Service Unavailable");
+        n += snprintf(state->response_buffer + n, sizeof(state->response_buffer) - n,
+            "Retry-After: %d\r\nCache-Control: no-store\r\nContent-Length: 0\r\n\r\n", HTTP_RETRY_AFTER_S);
+        return n;
+    }
+    n = http_write_status(state, "200 OK");
+    n += snprintf(state->response_buffer + n, sizeof(state->response_buffer) - n,
+        "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\nCache-Control: no-store\r\n"
+        "Content-Length: %u\r\n\r\n", (unsigned)cache_metricas.len);
+    return n;
+}
+
+typedef struct {
+    const char *metodo;
+    const char *caminho;
+    int (*handler)(HTTP_STATE *state);
+} HTTP_ROTA;
+
+// Rotas com o mesmo caminho (métodos diferentes) devem ficar em sequência na tabela
+static const HTTP_ROTA HTTP_ROTAS[] = {
+    { "GET", "/",               rota_pagina },
+    { "GET", "/grafico.js",     rota_grafico },
+    { "GET", "/dados_sensores", rota_dados_sensores },
+    { "GET", "/dados.bin",      rota_dados_bin },
+    { "GET", "/historico",      rota_historico },
+    { "GET", "/log",            rota_log },
+    { "GET", "/stream",         rota_stream },
+    { "GET", "/ws",             rota_ws },
+    { "GET", "/config",         rota_config },
+    { "POST", "/config",        rota_config_post },
+    { "GET", "/metrics",        rota_metricas },
+};
+#define HTTP_N_ROTAS        (sizeof(HTTP_ROTAS) / sizeof(HTTP_ROTAS[0]))
+#define HTTP_ROTAS_INDICE   16  // Potência de 2 maior que o número de caminhos
+_Static_assert(HTTP_N_ROTAS <= HTTP_SERVER_ROTAS_MAX, "aumente HTTP_SERVER_ROTAS_MAX");
+
+static uint32_t http_rotas_requisicoes[HTTP_N_ROTAS];   // Exportado em http_server_get_stats
+
+// Índice por hash do caminho (endereçamento aberto com sondagem linear). Cada posição
+// guarda a primeira rota de um caminho, ou -1. O hash da requisição é calculado pelo
+// parser enquanto os bytes do caminho chegam, então a busca custa uma comparação de strings.
+static uint32_t http_rotas_hash[HTTP_N_ROTAS];
+static int8_t http_rotas_indice[HTTP_ROTAS_INDICE];
+
+static void http_rotas_init(void) {
+    memset(http_rotas_indice, -1, sizeof(http_rotas_indice));
+    for (int r = 0; r < (int)HTTP_N_ROTAS; r++) {
+        http_rotas_hash[r] = http_hash(HTTP_ROTAS[r].caminho);
+        if (r > 0 && strcmp(HTTP_ROTAS[r].caminho, HTTP_ROTAS[r - 1].caminho) == 0) {
+            continue;  // Mesmo caminho da rota anterior: já indexado
+        }
+        uint32_t i = http_rotas_hash[r];
+        while (http_rotas_indice[i & (HTTP_ROTAS_INDICE - 1)] >= 0) {
+            i++;
+        }
+        http_rotas_indice[i & (HTTP_ROTAS_INDICE - 1)] = (int8_t)r;
+    }
+}
+
+/**
+ * @brief Procura o caminho da requisição no índice.
+ * @return A primeira rota com esse caminho, ou -1.
+ */
+static int http_rota_buscar(const HTTP_REQUISICAO *req) {
+    for (uint32_t i = req->hash_caminho; ; i++) {
+        int r = http_rotas_indice[i & (HTTP_ROTAS_INDICE - 1)];
+        if (r < 0) {
+            return -1;
+        }
+        if (http_rotas_hash[r] == req->hash_caminho && strcmp(HTTP_ROTAS[r].caminho, req->caminho) == 0) {
+            return r;
+        }
+    }
+}
+
+/**
+ * @brief Monta a resposta para a requisição completa em state->req.
+ */
+static void http_handle_request(HTTP_STATE *state) {
+    const HTTP_REQUISICAO *req = &state->req;
+
+    // HTTP/1.1 mantém a conexão por padrão; HTTP/1.0 só com "Connection: keep-alive"
+    state->http11 = req->http11;
+    bool keep_alive = state->http11;
+    const char *connection = http_cabecalho(req, HTTP_CAB_CONNECTION);
+    if (strncasecmp(connection, "close", 5) == 0) keep_alive = false;
+    else if (strncasecmp(connection, "keep-alive", 10) == 0) keep_alive = true;
+    if (state->requests + 1 >= HTTP_MAX_REQUESTS_PER_CONN) {
+        keep_alive = false;
+    }
+    state->keep_alive = keep_alive;
+    http_resposta_iniciar(state);
+    // Corpos gerados vão em chunks; sem HTTP/1.1 o fim do corpo é o fechamento da conexão
+    state->chunked = state->http11;
+
+    int n = 0;
+    int r = http_rota_buscar(req);
+    if (r < 0) {
+        http_stats.requests_other++;
         const char* msg = "<h1>404 Not Found</h1>";
-        state->response_len = snprintf(state->response_buffer, sizeof(state->response_buffer),
-            "HTTP/1.1 404 Not Found\r\nConnection: close\r\nContent-Type: text/html\r\nContent-Length: %d\r\n\r\n%s", strlen(msg), msg);
-        state->response_ptr = state->response_buffer;
+        n = http_write_status(state, "404 Not Found");
+        n += snprintf(state->response_buffer + n, sizeof(state->response_buffer) - n,
+            "Content-Type: text/html\r\nContent-Length: %d\r\n\r\n%s", (int)strlen(msg), msg);
+    } else {
+        int primeira = r;
+        for (; r < (int)HTTP_N_ROTAS && strcmp(HTTP_ROTAS[r].caminho, HTTP_ROTAS[primeira].caminho) == 0; r++) {
+            if (strcmp(HTTP_ROTAS[r].metodo, req->metodo) == 0) {
+                break;
+            }
+        }
+        if (r < (int)HTTP_N_ROTAS && strcmp(HTTP_ROTAS[r].caminho, HTTP_ROTAS[primeira].caminho) == 0) {
+            n = HTTP_ROTAS[r].handler(state);
+            http_rotas_requisicoes[r]++;
+        } else {
+            // Caminho conhecido, método não: 405 com os métodos aceitos
+            char *buf = state->response_buffer;
+            size_t size = sizeof(state->response_buffer);
+            n = http_write_status(state, "405 Method Not Allowed");
+            n += snprintf(buf + n, size - n, "Allow: ");
+            for (r = primeira; r < (int)HTTP_N_ROTAS && strcmp(HTTP_ROTAS[r].caminho, HTTP_ROTAS[primeira].caminho) == 0; r++) {
+                n += snprintf(buf + n, size - n, "%s%s", r > primeira ? ", " : "", HTTP_ROTAS[r].metodo);
+            }
+            n += snprintf(buf + n, size - n, "\r\nContent-Length: 0\r\n\r\n");
+            http_stats.requests_other++;
+        }
     }
-    
-    tcp_sent(tpcb, http_sent);
-    http_send_data(tpcb, state);
-    tcp_output(tpcb);
 
+    state->response_ptr = state->response_buffer;
+    state->response_len = n;
+    state->requests++;
+}
+
+/**
+ * @brief Responde a uma requisição malformada com o status indicado pelo parser e encerra
+ * a conexão depois da resposta, já que não dá para saber onde começa a próxima requisição.
+ */
+static void http_handle_erro(HTTP_STATE *state, uint16_t status) {
+    const char *texto = status == 411 ? "411 Length Required"
+                      : status == 413 ? "413 Payload Too Large"
+                      : status == 414 ? "414 URI Too Long"
+                      : status == 505 ? "505 HTTP Version Not Supported"
+                      : "400 Bad Request";
+    state->keep_alive = false;
+    http_resposta_iniciar(state);
+    http_stats.requests_other++;
+    state->response_ptr = state->response_buffer;
+    state->response_len = http_write_texto(state, texto, texto + 4);
+    state->requests++;
+}
+
+/**
+ * @brief Passa ao parser os bytes retidos em rx_pbuf, até completar uma requisição ou
+ * esgotar os dados. Os bytes consumidos são liberados e confirmados à lwIP; o restante
+ * (requisições seguintes, em pipeline) fica na cadeia.
+ */
+static void http_consumir(HTTP_STATE *state) {
+    u16_t usados = 0;
+    for (struct pbuf *q = state->rx_pbuf; q && state->req.estado < HTTP_PARSE_COMPLETA; q = q->next) {
+        usados += http_parser_alimentar(&state->req, (const char *)q->payload, q->len);
+    }
+    if (usados == 0) {
+        return;
+    }
+    state->rx_pbuf = pbuf_free_header(state->rx_pbuf, usados);
+    if (state->rx_pbuf && state->rx_pbuf->tot_len == 0) {
+        pbuf_free(state->rx_pbuf);  // Sobraram só pbufs vazios
+        state->rx_pbuf = NULL;
+    }
+    tcp_recved(state->pcb, usados);
+}
+
+/**
+ * @brief Máquina de estados da conexão: termina de enfileirar a resposta atual e, quando
+ * ela foi inteiramente entregue à lwIP, atende a próxima requisição já recebida (pipelining).
+ * Fecha a conexão após a última resposta quando não há keep-alive, ou quando o cliente já
+ * encerrou o envio e não resta requisição completa para atender.
+ */
+static err_t http_process(HTTP_STATE *state) {
+    bool wrote = false;
+    while (true) {
+        if (http_response_pending(state)) {
+            if (http_send_data(state) == ERR_ABRT) {
+                return ERR_ABRT;
+            }
+            wrote = true;
+            if (http_response_pending(state)) {
+                break; // Aguarda espaço no buffer de envio (http_sent)
+            }
+            if (state->sse || state->websocket) {
+                // Handshake de /stream ou /ws enfileirado: libera o slot e passa a conexão a assinante
+                bool websocket = state->websocket;
+                return assinante_adicionar(http_detach(state), websocket);
+            }
+            if (!state->keep_alive) {
+                tcp_output(state->pcb);
+                return http_close(state);
+            }
+        }
+
+        http_consumir(state);
+        if (state->req.estado == HTTP_PARSE_COMPLETA) {
+            http_handle_request(state);
+        } else if (state->req.estado == HTTP_PARSE_ERRO) {
+            http_handle_erro(state, state->req.erro);
+        } else if (state->fin_recebido) {
+            // Meia conexão fechada: todas as respostas já estão na fila e o resto da
+            // requisição não virá mais
+            tcp_output(state->pcb);
+            return http_close(state);
+        } else {
+            break; // Requisição ainda incompleta
+        }
+        http_parser_iniciar(&state->req);
+    }
+
+    if (wrote) {
+        tcp_output(state->pcb);
+    }
+    return ERR_OK;
+}
+
+static err_t http_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    HTTP_STATE *state = (HTTP_STATE *)arg;
+    state->idle_polls = 0;
+    return http_process(state);
+}
+
+static err_t http_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    HTTP_STATE *state = (HTTP_STATE *)arg;
+    if (!p) {
+        // O cliente fechou o seu lado (FIN). Requisições já recebidas, em pipeline, ainda são
+        // respondidas; http_process fecha a conexão depois delas.
+        state->fin_recebido = true;
+        return http_process(state);
+    }
+
+    if (state->rx_pbuf) {
+        if (state->rx_pbuf->tot_len + p->tot_len > HTTP_RX_PENDENTE_MAX) {
+            // Requisições em pipeline aguardando a resposta atual: a lwIP reentrega este pbuf depois
+            return ERR_MEM;
+        }
+        pbuf_cat(state->rx_pbuf, p);
+    } else {
+        state->rx_pbuf = p;
+    }
+
+    state->idle_polls = 0;
+    return http_process(state);
+}
+
+/**
+ * @brief Chamado pela lwIP a cada HTTP_POLL_INTERVAL. Retoma envios travados por falta de
+ * memória e fecha conexões ociosas há mais de HTTP_IDLE_TIMEOUT_S segundos.
+ */
+static err_t http_poll(void *arg, struct tcp_pcb *tpcb) {
+    HTTP_STATE *state = (HTTP_STATE *)arg;
+    if (!state) {
+        tcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+    if (++state->idle_polls * HTTP_POLL_INTERVAL / 2 >= HTTP_IDLE_TIMEOUT_S) {
+        return http_close(state);
+    }
+    return http_process(state);
+}
+
+/**
+ * @brief Descarta dados de conexões que foram recusadas com 503.
+ */
+static err_t http_recv_discard(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    if (p) {
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+    }
     return ERR_OK;
 }
 
 static err_t http_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
-    tcp_arg(newpcb, NULL);
+    if (err != ERR_OK || !newpcb) {
+        return ERR_VAL;
+    }
+    HTTP_STATE *state = http_pool_acquire();
+    if (!state) {
+        // Pool cheio: responde 503 imediatamente, sem ler a requisição, e fecha
+        tcp_arg(newpcb, NULL);
+        tcp_recv(newpcb, http_recv_discard);
+        if (tcp_write(newpcb, HTTP_RESPONSE_503, sizeof(HTTP_RESPONSE_503) - 1, 0) != ERR_OK ||
+            tcp_close(newpcb) != ERR_OK) {
+            tcp_abort(newpcb);
+            return ERR_ABRT;
+        }
+        http_stats.bytes_sent += sizeof(HTTP_RESPONSE_503) - 1;
+        return ERR_OK;
+    }
+    state->pcb = newpcb;
+    tcp_arg(newpcb, state);
     tcp_recv(newpcb, http_recv);
+    tcp_sent(newpcb, http_sent);
     tcp_err(newpcb, http_err);
+    tcp_poll(newpcb, http_poll, HTTP_POLL_INTERVAL);
+    // Respostas pequenas e em pipeline não devem esperar pelo algoritmo de Nagle
+    tcp_nagle_disable(newpcb);
     return ERR_OK;
 }
 
+void http_server_get_stats(HTTP_SERVER_STATS *stats) {
+    *stats = http_stats;
+    stats->conns_active = HTTP_MAX_CONNECTIONS - http_free_count;
+    stats->sse_subscribers = assinantes_contar(false);
+    stats->ws_clients = assinantes_contar(true);
+    stats->n_rotas = HTTP_N_ROTAS;
+    for (int r = 0; r < (int)HTTP_N_ROTAS; r++) {
+        stats->rotas[r].metodo = HTTP_ROTAS[r].metodo;
+        stats->rotas[r].caminho = HTTP_ROTAS[r].caminho;
+        stats->rotas[r].requisicoes = http_rotas_requisicoes[r];
+    }
+}
+
+void http_server_publicar(void) {
+    if (!http_server_ativo) {
+        return;
+    }
+    cyw43_arch_lwip_begin();
+    assinantes_publicar();
+    cyw43_arch_lwip_end();
+}
+
 void start_http_server(void) {
+    http_pool_init();
+    http_rotas_init();
+    // Chamada de uma tarefa: a API raw da lwIP só pode ser usada com o lock do núcleo
+    cyw43_arch_lwip_begin();
+    http_server_ativo = true;
     struct tcp_pcb *pcb = tcp_new();
     tcp_bind(pcb, IP_ADDR_ANY, 80);
     pcb = tcp_listen(pcb);
     tcp_accept(pcb, http_accept);
+    cyw43_arch_lwip_end();
     printf("Servidor final e completo rodando na porta 80.\n");
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "ssd1306.h"
 #include "font.h"
+#include "fmt_num.h"
+#include "i2c_dma.h"
 
 // ssd1306_t ssd;
 
@@ -45,29 +47,19 @@ void ssd1306_config(ssd1306_t *ssd) {
 
 void ssd1306_command(ssd1306_t *ssd, uint8_t command) {
   ssd->port_buffer[1] = command;
-  i2c_write_blocking(
-    ssd->i2c_port,
-    ssd->address,
-    ssd->port_buffer,
-    2,
-    false
-  );
+  i2c_dma_transferir(ssd->i2c_port, ssd->address, ssd->port_buffer, 2, NULL, 0);
 }
 
 void ssd1306_send_data(ssd1306_t *ssd) {
-  ssd1306_command(ssd, SET_COL_ADDR);
-  ssd1306_command(ssd, 0);
-  ssd1306_command(ssd, ssd->width - 1);
-  ssd1306_command(ssd, SET_PAGE_ADDR);
-  ssd1306_command(ssd, 0);
-  ssd1306_command(ssd, ssd->pages - 1);
-  i2c_write_blocking(
-    ssd->i2c_port,
-    ssd->address,
-    ssd->ram_buffer,
-    ssd->bufsize,
-    false
-  );
+  // Janela de endereçamento numa só transação: com o byte de controle 0x00 (Co = 0) todos
+  // os bytes seguintes são comandos
+  uint8_t janela[7] = {
+    0x00,
+    SET_COL_ADDR, 0, ssd->width - 1,
+    SET_PAGE_ADDR, 0, ssd->pages - 1
+  };
+  i2c_dma_transferir(ssd->i2c_port, ssd->address, janela, sizeof(janela), NULL, 0);
+  i2c_dma_transferir(ssd->i2c_port, ssd->address, ssd->ram_buffer, ssd->bufsize, NULL, 0);
 }
 
 void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value) {
@@ -202,7 +194,8 @@ void ssd1306_draw_string(ssd1306_t *ssd, const char *str, uint8_t x, uint8_t y)
  * @param data Ponteiro para a estrutura com os dados dos sensores.
  */
 void desenha_display_alerta_sup(ssd1306_t *display, SENSOR_DATA *data) {
-    char buffer[22]; // Buffer para formatar as strings
+    char buffer[2 * FMT_NUM_MAX + 8]; // Buffer para formatar as strings (fmt_num não limita o tamanho)
+    char *p;
 
     ssd1306_fill(display, 0); // Limpa a tela
     
@@ -213,23 +206,27 @@ void desenha_display_alerta_sup(ssd1306_t *display, SENSOR_DATA *data) {
     uint8_t linha_atual = 15; // Posição Y inicial para as mensagens
 
     // Verifica cada grandeza e exibe a mensagem de alerta se o limite for ultrapassado
-    if (data->temperatura_bmp > data->limite_max_temp) {
-        snprintf(buffer, sizeof(buffer), "T: %.1fC > %dC", data->temperatura_bmp, data->limite_max_temp);
+    if (data->temperatura_bmp > data->config.limite_max_temp) {
+        p = fmt_fixo(fmt_texto(buffer, "T: "), data->temperatura_bmp, 1);
+        fmt_texto(fmt_int(fmt_texto(p, "C > "), data->config.limite_max_temp), "C");
         ssd1306_draw_string(display, buffer, 0, linha_atual);
         linha_atual += 12; // Move para a próxima linha
     }
-    if (data->umidade_aht > data->limite_max_umid) {
-        snprintf(buffer, sizeof(buffer), "U: %.1f%% > %d%%", data->umidade_aht, data->limite_max_umid);
+    if (data->umidade_aht > data->config.limite_max_umid) {
+        p = fmt_fixo(fmt_texto(buffer, "U: "), data->umidade_aht, 1);
+        fmt_texto(fmt_int(fmt_texto(p, "% > "), data->config.limite_max_umid), "%");
         ssd1306_draw_string(display, buffer, 0, linha_atual);
         linha_atual += 12;
     }
-    if (data->pressao_hpa > data->limite_max_press) {
-        snprintf(buffer, sizeof(buffer), "P: %.0fhPa > %d", data->pressao_hpa, data->limite_max_press);
+    if (data->pressao_hpa > data->config.limite_max_press) {
+        p = fmt_fixo(fmt_texto(buffer, "P: "), data->pressao_hpa, 0);
+        fmt_int(fmt_texto(p, "hPa > "), data->config.limite_max_press);
         ssd1306_draw_string(display, buffer, 0, linha_atual);
         linha_atual += 12;
     }
-    if (data->altitude > data->limite_max_alt) {
-        snprintf(buffer, sizeof(buffer), "A: %.0fm > %dm", data->altitude, data->limite_max_alt);
+    if (data->altitude > data->config.limite_max_alt) {
+        p = fmt_fixo(fmt_texto(buffer, "A: "), data->altitude, 0);
+        fmt_texto(fmt_int(fmt_texto(p, "m > "), data->config.limite_max_alt), "m");
         ssd1306_draw_string(display, buffer, 0, linha_atual);
     }
     
@@ -244,7 +241,8 @@ void desenha_display_alerta_sup(ssd1306_t *display, SENSOR_DATA *data) {
  * @param data Ponteiro para a estrutura com os dados dos sensores.
  */
 void desenha_display_alerta_inf(ssd1306_t *display, SENSOR_DATA *data) {
-    char buffer[22];
+    char buffer[2 * FMT_NUM_MAX + 8];
+    char *p;
 
     ssd1306_fill(display, 0);
     
@@ -255,23 +253,27 @@ void desenha_display_alerta_inf(ssd1306_t *display, SENSOR_DATA *data) {
     uint8_t linha_atual = 15;
 
     // Verifica cada grandeza e exibe a mensagem de alerta se abaixo do limite
-    if (data->temperatura_bmp < data->limite_min_temp) {
-        snprintf(buffer, sizeof(buffer), "T: %.1fC < %dC", data->temperatura_bmp, data->limite_min_temp);
+    if (data->temperatura_bmp < data->config.limite_min_temp) {
+        p = fmt_fixo(fmt_texto(buffer, "T: "), data->temperatura_bmp, 1);
+        fmt_texto(fmt_int(fmt_texto(p, "C < "), data->config.limite_min_temp), "C");
         ssd1306_draw_string(display, buffer, 0, linha_atual);
         linha_atual += 12;
     }
-    if (data->umidade_aht < data->limite_min_umid) {
-        snprintf(buffer, sizeof(buffer), "U: %.1f%% < %d%%", data->umidade_aht, data->limite_min_umid);
+    if (data->umidade_aht < data->config.limite_min_umid) {
+        p = fmt_fixo(fmt_texto(buffer, "U: "), data->umidade_aht, 1);
+        fmt_texto(fmt_int(fmt_texto(p, "% < "), data->config.limite_min_umid), "%");
         ssd1306_draw_string(display, buffer, 0, linha_atual);
         linha_atual += 12;
     }
-    if (data->pressao_hpa < data->limite_min_press) {
-        snprintf(buffer, sizeof(buffer), "P: %.0fhPa < %d", data->pressao_hpa, data->limite_min_press);
+    if (data->pressao_hpa < data->config.limite_min_press) {
+        p = fmt_fixo(fmt_texto(buffer, "P: "), data->pressao_hpa, 0);
+        fmt_int(fmt_texto(p, "hPa < "), data->config.limite_min_press);
         ssd1306_draw_string(display, buffer, 0, linha_atual);
         linha_atual += 12;
     }
-    if (data->altitude < data->limite_min_alt) {
-        snprintf(buffer, sizeof(buffer), "A: %.0fm < %dm", data->altitude, data->limite_min_alt);
+    if (data->altitude < data->config.limite_min_alt) {
+        p = fmt_fixo(fmt_texto(buffer, "A: "), data->altitude, 0);
+        fmt_texto(fmt_int(fmt_texto(p, "m < "), data->config.limite_min_alt), "m");
         ssd1306_draw_string(display, buffer, 0, linha_atual);
     }
     
@@ -285,7 +287,7 @@ void desenha_display_alerta_inf(ssd1306_t *display, SENSOR_DATA *data) {
  * @param data Ponteiro para a estrutura com os dados dos sensores.
  */
 void desenha_display_normal(ssd1306_t *display, SENSOR_DATA *data) {
-    char buffer[30];
+    char buffer[FMT_NUM_MAX + 8];
     
     ssd1306_fill(display, 0);
     
@@ -295,23 +297,23 @@ void desenha_display_normal(ssd1306_t *display, SENSOR_DATA *data) {
     // Coluna da Esquerda
     // Temperatura
     ssd1306_draw_string(display, "T:", 0, 15);
-    snprintf(buffer, sizeof(buffer), "%.1f C", data->temperatura_bmp);
+    fmt_texto(fmt_fixo(buffer, data->temperatura_bmp, 1), " C");
     ssd1306_draw_string(display, buffer, 0, 25);
     
     // Pressão
     ssd1306_draw_string(display, "P:", 0, 40);
-    snprintf(buffer, sizeof(buffer), "%.0f hPa", data->pressao_hpa);
+    fmt_texto(fmt_fixo(buffer, data->pressao_hpa, 0), " hPa");
     ssd1306_draw_string(display, buffer, 0, 50);
 
     // Coluna da Direita
     // Umidade
     ssd1306_draw_string(display, "U:", 70, 15);
-    snprintf(buffer, sizeof(buffer), "%.1f %%", data->umidade_aht);
+    fmt_texto(fmt_fixo(buffer, data->umidade_aht, 1), " %");
     ssd1306_draw_string(display, buffer, 70, 25);
     
     // Altitude
     ssd1306_draw_string(display, "A:", 70, 40);
-    snprintf(buffer, sizeof(buffer), "%.0f m", data->altitude);
+    fmt_texto(fmt_fixo(buffer, data->altitude, 0), " m");
     ssd1306_draw_string(display, buffer, 70, 50);
     
     ssd1306_send_data(display);
@@ -320,6 +322,7 @@ void desenha_display_normal(ssd1306_t *display, SENSOR_DATA *data) {
 void display_init(ssd1306_t *ssd) 
 {
     i2c_init(I2C_PORT, 400 * 1000);
+    i2c_dma_iniciar(I2C_PORT, WIDTH * HEIGHT / 8 + 1);            // Quadro inteiro numa transação por DMA
  
     gpio_set_function(I2C_SDA, GPIO_FUNC_I2C);                    // Set the GPIO pin function to I2C
     gpio_set_function(I2C_SCL, GPIO_FUNC_I2C);                    // Set the GPIO pin function to I2C
@@ -0,0 +1,88 @@
+// Ficheiro: telemetria_bin.c
+// Serializador de /dados.bin. As leituras são convertidas para ponto fixo com uma
+// multiplicação e um arredondamento cada, sem passar pela formatação de floats do
+// snprintf; o formato está descrito em telemetria_bin.h.
+
+#include "telemetria_bin.h"
+#include "global_manage.h"
+
+/**
+ * @brief Converte para ponto fixo com arredondamento, saturando em [min, max].
+ */
+static int32_t tlm_fixo(float valor, float escala, int32_t min, int32_t max) {
+    float v = valor * escala;
+    v += (v < 0) ? -0.5f : 0.5f;
+    if (v <= (float)min) return min;
+    if (v >= (float)max) return max;
+    return (int32_t)v;
+}
+
+static void tlm_leitura(TELEMETRIA_LEITURA *l, uint32_t seq, float temperatura, float umidade,
+                        float pressao_hpa, float altitude) {
+    l->seq = seq;
+    l->temperatura = (int16_t)tlm_fixo(temperatura, 100.0f, INT16_MIN, INT16_MAX);
+    l->umidade = (uint16_t)tlm_fixo(umidade, 100.0f, 0, UINT16_MAX);
+    l->pressao = (uint32_t)tlm_fixo(pressao_hpa, 100.0f, 0, INT32_MAX);
+    l->altitude = tlm_fixo(altitude, 100.0f, INT32_MIN, INT32_MAX);
+}
+
+static uint16_t tlm_total_amostras(const TELEMETRIA_CURSOR *cursor) {
+    return cursor->ultima >= cursor->primeira ? cursor->ultima - cursor->primeira + 1 : 0;
+}
+
+void telemetria_bin_iniciar(TELEMETRIA_CURSOR *cursor, bool historico, uint32_t desde) {
+    SENSOR_DATA data;
+    get_sensor_data(&data);
+    cursor->ultima = data.seq;
+    cursor->cabecalho_enviado = false;
+    cursor->concluido = false;
+
+    uint32_t inicio = hist_primeira_seq(cursor->ultima);
+    if (!historico) {
+        cursor->primeira = cursor->ultima + 1;
+    } else if (desde <= cursor->ultima && desde + 1 >= inicio) {
+        cursor->primeira = desde + 1;
+    } else {
+        cursor->primeira = inicio;
+    }
+    cursor->proxima = cursor->primeira;
+
+    TELEMETRIA_CABECALHO *c = &cursor->cabecalho;
+    c->versao = TELEMETRIA_VERSAO;
+    c->alertas = calcular_alertas_dados(&data);
+    c->n_amostras = tlm_total_amostras(cursor);
+    c->timestamp_ms = data.timestamp_ms;
+    tlm_leitura(&c->atual, data.seq, data.temperatura_bmp, data.umidade_aht, data.pressao_hpa, data.altitude);
+}
+
+size_t telemetria_bin_tamanho(const TELEMETRIA_CURSOR *cursor) {
+    return TELEMETRIA_CABECALHO_LEN + (size_t)tlm_total_amostras(cursor) * TELEMETRIA_AMOSTRA_LEN;
+}
+
+size_t telemetria_bin_escrever(TELEMETRIA_CURSOR *cursor, uint8_t *buf, size_t cap) {
+    size_t len = 0;
+
+    if (!cursor->cabecalho_enviado) {
+        if (cap < TELEMETRIA_CABECALHO_LEN) {
+            return 0;
+        }
+        telemetria_codificar_cabecalho(buf, &cursor->cabecalho);
+        len = TELEMETRIA_CABECALHO_LEN;
+        cursor->cabecalho_enviado = true;
+    }
+
+    while (cursor->proxima <= cursor->ultima && cap - len >= TELEMETRIA_AMOSTRA_LEN) {
+        TELEMETRIA_LEITURA l = { 0 };
+        AMOSTRA a;
+        // Amostra que saiu do histórico durante o envio vai zerada (seq 0)
+        if (get_amostra(cursor->proxima, &a)) {
+            tlm_leitura(&l, a.seq, a.temperatura, a.umidade, a.pressao, a.altitude);
+        }
+        telemetria_codificar_amostra(buf + len, &l);
+        len += TELEMETRIA_AMOSTRA_LEN;
+        cursor->proxima++;
+    }
+
+    cursor->concluido = cursor->proxima > cursor->ultima;
+    return len;
+}
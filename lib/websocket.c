@@ -0,0 +1,220 @@
+// Ficheiro: websocket.c
+// Partes do protocolo WebSocket (RFC 6455) que não dependem da lwIP: o cálculo de
+// Sec-WebSocket-Accept do handshake (SHA-1 + base64, implementados aqui para não
+// puxar uma biblioteca de criptografia inteira) e a leitura/escrita de quadros.
+
+#include "websocket.h"
+
+// GUID fixo concatenado à chave do cliente (RFC 6455, seção 1.3)
+static const char WS_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// =================================================================================
+// SHA-1 (FIPS 180-4)
+// =================================================================================
+
+typedef struct {
+    uint32_t h[5];
+    uint8_t bloco[64];
+    size_t bloco_len;
+    uint64_t total;      // Bytes processados
+} SHA1_CTX;
+
+static uint32_t rol32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static void sha1_processar_bloco(SHA1_CTX *ctx) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)ctx->bloco[4 * i] << 24 | (uint32_t)ctx->bloco[4 * i + 1] << 16 |
+               (uint32_t)ctx->bloco[4 * i + 2] << 8 | ctx->bloco[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = ctx->h[0], b = ctx->h[1], c = ctx->h[2], d = ctx->h[3], e = ctx->h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20)      { f = (b & c) | (~b & d);           k = 0x5A827999; }
+        else if (i < 40) { f = b ^ c ^ d;                    k = 0x6ED9EBA1; }
+        else if (i < 60) { f = (b & c) | (b & d) | (c & d);  k = 0x8F1BBCDC; }
+        else             { f = b ^ c ^ d;                    k = 0xCA62C1D6; }
+        uint32_t t = rol32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol32(b, 30);
+        b = a;
+        a = t;
+    }
+    ctx->h[0] += a;
+    ctx->h[1] += b;
+    ctx->h[2] += c;
+    ctx->h[3] += d;
+    ctx->h[4] += e;
+}
+
+static void sha1_iniciar(SHA1_CTX *ctx) {
+    ctx->h[0] = 0x67452301;
+    ctx->h[1] = 0xEFCDAB89;
+    ctx->h[2] = 0x98BADCFE;
+    ctx->h[3] = 0x10325476;
+    ctx->h[4] = 0xC3D2E1F0;
+    ctx->bloco_len = 0;
+    ctx->total = 0;
+}
+
+static void sha1_atualizar(SHA1_CTX *ctx, const uint8_t *dados, size_t len) {
+    ctx->total += len;
+    while (len--) {
+        ctx->bloco[ctx->bloco_len++] = *dados++;
+        if (ctx->bloco_len == 64) {
+            sha1_processar_bloco(ctx);
+            ctx->bloco_len = 0;
+        }
+    }
+}
+
+static void sha1_finalizar(SHA1_CTX *ctx, uint8_t digest[20]) {
+    uint64_t bits = ctx->total * 8;
+    // Padding: bit 1, zeros até sobrarem 8 bytes no bloco, tamanho em bits (big-endian)
+    uint8_t pad = 0x80;
+    sha1_atualizar(ctx, &pad, 1);
+    pad = 0;
+    while (ctx->bloco_len != 56) {
+        sha1_atualizar(ctx, &pad, 1);
+    }
+    uint8_t tamanho[8];
+    for (int i = 0; i < 8; i++) {
+        tamanho[i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    sha1_atualizar(ctx, tamanho, 8);
+
+    for (int i = 0; i < 5; i++) {
+        digest[4 * i]     = (uint8_t)(ctx->h[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(ctx->h[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(ctx->h[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)ctx->h[i];
+    }
+}
+
+// =================================================================================
+// BASE64 (RFC 4648)
+// =================================================================================
+
+/**
+ * @brief Codifica len bytes em base64 com padding. out recebe 4 * ceil(len / 3) + 1 bytes.
+ */
+static void base64_codificar(const uint8_t *in, size_t len, char *out) {
+    static const char alfabeto[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t i = 0;
+    for (; i + 2 < len; i += 3) {
+        uint32_t v = (uint32_t)in[i] << 16 | (uint32_t)in[i + 1] << 8 | in[i + 2];
+        *out++ = alfabeto[(v >> 18) & 0x3F];
+        *out++ = alfabeto[(v >> 12) & 0x3F];
+        *out++ = alfabeto[(v >> 6) & 0x3F];
+        *out++ = alfabeto[v & 0x3F];
+    }
+    if (i < len) {
+        uint32_t v = (uint32_t)in[i] << 16 | (i + 1 < len ? (uint32_t)in[i + 1] << 8 : 0);
+        *out++ = alfabeto[(v >> 18) & 0x3F];
+        *out++ = alfabeto[(v >> 12) & 0x3F];
+        *out++ = (i + 1 < len) ? alfabeto[(v >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+    *out = '\0';
+}
+
+// =================================================================================
+// HANDSHAKE E QUADROS
+// =================================================================================
+
+void ws_calcular_aceite(const char *chave, size_t chave_len, char *aceite) {
+    SHA1_CTX ctx;
+    uint8_t digest[20];
+    sha1_iniciar(&ctx);
+    sha1_atualizar(&ctx, (const uint8_t *)chave, chave_len);
+    sha1_atualizar(&ctx, (const uint8_t *)WS_GUID, sizeof(WS_GUID) - 1);
+    sha1_finalizar(&ctx, digest);
+    base64_codificar(digest, sizeof(digest), aceite);
+}
+
+int ws_quadro_ler(uint8_t *buf, size_t len, size_t cap, WS_QUADRO *quadro) {
+    if (len < 2) {
+        return 0;
+    }
+    quadro->fin = (buf[0] & 0x80) != 0;
+    quadro->opcode = buf[0] & 0x0F;
+    bool mascara = (buf[1] & 0x80) != 0;
+    uint64_t payload_len = buf[1] & 0x7F;
+    size_t cabecalho = 2;
+
+    // Todo quadro enviado pelo cliente deve vir mascarado (seção 5.1), e sem os bits RSV,
+    // que só uma extensão negociada no handshake poderia usar (seção 5.2)
+    if (!mascara || (buf[0] & 0x70) != 0) {
+        return WS_QUADRO_INVALIDO;
+    }
+    if (payload_len == 126) {
+        if (len < 4) return 0;
+        payload_len = (uint16_t)(buf[2] << 8 | buf[3]);
+        cabecalho = 4;
+    } else if (payload_len == 127) {
+        if (len < 10) return 0;
+        // O bit mais significativo do tamanho de 64 bits deve ser 0 (seção 5.2)
+        if (buf[2] & 0x80) {
+            return WS_QUADRO_INVALIDO;
+        }
+        payload_len = 0;
+        for (int i = 2; i < 10; i++) {
+            payload_len = payload_len << 8 | buf[i];
+        }
+        cabecalho = 10;
+    }
+    // Quadros de controle: no máximo 125 bytes e nunca fragmentados (seção 5.5)
+    if ((quadro->opcode & 0x8) && (payload_len > 125 || !quadro->fin)) {
+        return WS_QUADRO_INVALIDO;
+    }
+    // Comparado sem somar ao tamanho, que vem do cliente e poderia dar a volta
+    if (cap < cabecalho + 4 || payload_len > cap - cabecalho - 4) {
+        return WS_QUADRO_GRANDE;
+    }
+    size_t total = cabecalho + 4 + (size_t)payload_len;
+    if (len < total) {
+        return 0;
+    }
+
+    const uint8_t *chave = buf + cabecalho;
+    uint8_t *payload = buf + cabecalho + 4;
+    for (size_t i = 0; i < payload_len; i++) {
+        payload[i] ^= chave[i & 3];
+    }
+    quadro->payload = payload;
+    quadro->payload_len = (size_t)payload_len;
+    return (int)total;
+}
+
+uint16_t ws_codigo_fechamento(const WS_QUADRO *quadro) {
+    if (quadro->payload_len == 0) {
+        return WS_FECHA_NORMAL;
+    }
+    if (quadro->payload_len == 1) {
+        return WS_FECHA_PROTOCOLO;
+    }
+    uint16_t codigo = (uint16_t)(quadro->payload[0] << 8 | quadro->payload[1]);
+    bool valido = (codigo >= 1000 && codigo <= 1003) || (codigo >= 1007 && codigo <= 1014) ||
+                  (codigo >= 3000 && codigo <= 4999);
+    return valido ? codigo : WS_FECHA_PROTOCOLO;
+}
+
+size_t ws_quadro_cabecalho(uint8_t *out, uint8_t opcode, uint16_t payload_len) {
+    out[0] = 0x80 | opcode;
+    if (payload_len < 126) {
+        out[1] = (uint8_t)payload_len;
+        return 2;
+    }
+    out[1] = 126;
+    out[2] = (uint8_t)(payload_len >> 8);
+    out[3] = (uint8_t)payload_len;
+    return 4;
+}
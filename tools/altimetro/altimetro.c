@@ -0,0 +1,152 @@
+// Ficheiro: altimetro.c
+// Testes e medição da altitude em ponto fixo (altitude_cm, lib/altitude.c).
+//
+//   altimetro [-n <repetições do benchmark>] [-t]
+//
+// 1. tabela: nos pontos exatos da tabela (p0 = 65536 Pa, p = p0 * (0,25 + i/256)) a
+//    função precisa devolver 44330 * (1 - r^0,1903) arredondado para o cm, calculado aqui
+//    em double; com -t a tabela é só impressa, no formato de lib/altitude.c;
+// 2. erro: contra a fórmula em double, com p de 300 a 1100 hPa e a referência (QNH) por
+//    toda a faixa aceita pela configuração. Falha acima de ALTIMETRO_ERRO_MAX_M, o
+//    limite documentado em altitude.h;
+// 3. benchmark: altitude_cm contra o pow em double usado antes e contra o powf. No host
+//    o pow tem FPU; no M0+ (sem FPU) a diferença é bem maior do que a medida aqui.
+//
+// Sai com código 1 se algum teste falhar.
+
+#define _POSIX_C_SOURCE 200809L    // clock_gettime, getopt
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "altitude.h"
+
+// Parâmetros da tabela de lib/altitude.c
+#define TABELA_PONTOS       273
+#define TABELA_RAZAO_MIN    0.25
+#define TABELA_PASSO        (1.0 / 256)
+
+#define ALTIMETRO_ERRO_MAX_M    0.14
+
+static double altitude_ref(double pressao_pa, double referencia_pa) {
+    return 44330.0 * (1.0 - pow(pressao_pa / referencia_pa, 0.1903));
+}
+
+static int32_t tabela_ponto(int i) {
+    return (int32_t)lround(altitude_ref(TABELA_RAZAO_MIN + i * TABELA_PASSO, 1.0) * 100.0);
+}
+
+static void imprimir_tabela(void) {
+    for (int i = 0; i < TABELA_PONTOS; i++) {
+        printf("%s%ld,%s", i % 8 ? " " : "    ", (long)tabela_ponto(i), i % 8 == 7 ? "\n" : "");
+    }
+    printf("\n");
+}
+
+static bool etapa_tabela(void) {
+    int divergentes = 0;
+    for (int i = 0; i < TABELA_PONTOS; i++) {
+        uint32_t pressao_q8 = (uint32_t)((65536.0 * (TABELA_RAZAO_MIN + i * TABELA_PASSO)) * 256.0);
+        if (altitude_cm(pressao_q8, 65536) != tabela_ponto(i)) divergentes++;
+    }
+    printf("tabela: %d pontos, %d divergências\n", TABELA_PONTOS, divergentes);
+    return divergentes == 0;
+}
+
+static bool etapa_erro(void) {
+    double erro_max = 0, erro_max_baixa = 0, soma = 0;
+    double pior_p = 0, pior_p0 = 0;
+    uint64_t total = 0;
+    for (uint32_t p0 = ALTITUDE_REFERENCIA_MIN_PA; p0 <= ALTITUDE_REFERENCIA_MAX_PA; p0 += 250) {
+        // Passo de 13/256 Pa: cruza os pontos da tabela em frações variadas
+        for (uint32_t pressao_q8 = 30000u * 256; pressao_q8 <= 110000u * 256; pressao_q8 += 13 * 256 + 13) {
+            double p = pressao_q8 / 256.0;
+            double erro = fabs(altitude_cm(pressao_q8, p0) / 100.0 - altitude_ref(p, p0));
+            soma += erro;
+            total++;
+            if (erro > erro_max) {
+                erro_max = erro;
+                pior_p = p;
+                pior_p0 = p0;
+            }
+            if (p >= 80000 && erro > erro_max_baixa) erro_max_baixa = erro;
+        }
+    }
+    printf("erro contra pow (%llu pontos, QNH %d a %d hPa): máx %.3f m (p = %.1f hPa, QNH %.0f hPa), "
+           "média %.4f m; entre 800 e 1100 hPa máx %.3f m\n",
+           (unsigned long long)total, ALTITUDE_REFERENCIA_MIN_PA / 100, ALTITUDE_REFERENCIA_MAX_PA / 100,
+           erro_max, pior_p / 100, pior_p0 / 100, soma / total, erro_max_baixa);
+    return erro_max <= ALTIMETRO_ERRO_MAX_M;
+}
+
+// --- Benchmark ---
+
+#define BENCH_PRESSOES 4096
+
+static volatile uint32_t sorvedouro;    // Impede que o compilador descarte as chamadas
+static uint32_t pressoes_q8[BENCH_PRESSOES];
+
+static uint64_t agora_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+}
+
+enum { BENCH_POW, BENCH_POWF, BENCH_TABELA, N_BENCH };
+static const char *const BENCH_NOMES[N_BENCH] = {
+    "pow, double (fórmula anterior)",
+    "powf, float",
+    "altitude_cm, tabela em ponto fixo",
+};
+
+// Uma chamada fica abaixo da resolução do relógio: mede o laço inteiro
+static void etapa_benchmark(uint32_t repeticoes) {
+    for (int i = 0; i < BENCH_PRESSOES; i++) {
+        pressoes_q8[i] = 30000u * 256 + (uint32_t)(((uint64_t)i * 80000u * 256) / BENCH_PRESSOES);
+    }
+    for (int variante = 0; variante < N_BENCH; variante++) {
+        uint64_t inicio = agora_ns();
+        for (uint32_t r = 0; r < repeticoes; r++) {
+            uint32_t pressao_q8 = pressoes_q8[r % BENCH_PRESSOES];
+            float press_pa = pressao_q8 / 256.0f;
+            switch (variante) {
+                case BENCH_POW:
+                    sorvedouro += (uint32_t)(int32_t)(44330.0 * (1.0 - pow(press_pa / 101325.0, 0.1903)));
+                    break;
+                case BENCH_POWF:
+                    sorvedouro += (uint32_t)(int32_t)(44330.0f * (1.0f - powf(press_pa / 101325.0f, 0.1903f)));
+                    break;
+                default:
+                    sorvedouro += (uint32_t)altitude_cm(pressao_q8, ALTITUDE_REFERENCIA_PADRAO_PA);
+                    break;
+            }
+        }
+        double ns = (double)(agora_ns() - inicio) / repeticoes;
+        printf("  %-40s %8.1f ns/chamada\n", BENCH_NOMES[variante], ns);
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t repeticoes = 10000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t")) != -1) {
+        switch (opt) {
+            case 'n': repeticoes = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 't': imprimir_tabela(); return 0;
+            default:
+                fprintf(stderr, "uso: %s [-n repetições] [-t]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (repeticoes == 0) repeticoes = 1;
+
+    bool ok = etapa_tabela();
+    ok = etapa_erro() && ok;
+    printf("benchmark (%lu chamadas):\n", (unsigned long)repeticoes);
+    etapa_benchmark(repeticoes);
+    printf(ok ? "OK\n" : "FALHOU\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,539 @@
+// Ficheiro: carga.c
+// Teste de carga do servidor HTTP no host, sem a placa. O server.c do firmware roda sobre
+// a lwIP compilada para o host (NO_SYS=1) e conversa por 127.0.0.1 (interface de
+// loopback) com N clientes implementados na própria lwIP. Cada cliente mantém uma conexão
+// keep-alive e repete requisições a /, /dados_sensores e /config; ao fim são impressos
+// requisições/s, percentis de latência por rota, o uso máximo do heap e dos pools da
+// lwIP e as conexões que falharam.
+//
+// Uso: carga [-c clientes] [-d segundos] [-i intervalo_ms]
+//      -i é a pausa de cada cliente entre uma resposta e a próxima requisição
+//      (0 = carga máxima; 2000 = o ritmo de um painel aberto).
+
+#define _GNU_SOURCE     // strcasestr
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lwip/init.h"
+#include "lwip/memp.h"
+#include "lwip/netif.h"
+#include "lwip/stats.h"
+#include "lwip/tcp.h"
+#include "lwip/timeouts.h"
+
+#include "global_manage.h"
+#include "server.h"
+
+#define CARGA_CLIENTES_PADRAO   8
+#define CARGA_DURACAO_PADRAO_S  10
+#define CARGA_TIMEOUT_MS        5000    // Resposta que não chega nesse tempo conta como falha
+#define CARGA_AMOSTRAGEM_MS     2000    // Mesmo período da tarefa de sensores
+#define CARGA_ESPERA_FALHA_MS   100     // Pausa mínima antes de reconectar após 503 ou erro
+#define CARGA_CABECALHO_MAX     1024
+#define CARGA_PORTA             80
+
+// =================================================================================
+// ROTAS EXERCITADAS
+// =================================================================================
+
+typedef struct {
+    const char *nome;
+    char requisicao[256];
+    uint16_t len;
+    uint8_t peso;           // Em quantas de cada CARGA_CICLO requisições a rota aparece
+    // Resultados
+    uint32_t *latencias_us;
+    uint32_t n, cap;
+    uint32_t erros_http;
+} CARGA_ROTA;
+
+static CARGA_ROTA carga_rotas[] = {
+    { .nome = "GET /dados_sensores", .peso = 7 },
+    { .nome = "GET /",               .peso = 2 },
+    { .nome = "POST /config",        .peso = 1 },
+};
+#define CARGA_N_ROTAS   (sizeof(carga_rotas) / sizeof(carga_rotas[0]))
+#define CARGA_CICLO     10
+
+static uint8_t carga_sequencia[CARGA_CICLO];
+
+static void carga_preparar_rotas(void) {
+    static const char corpo[] = "{\"offset_temp\":0}";
+    CARGA_ROTA *r = carga_rotas;
+    r[0].len = (uint16_t)snprintf(r[0].requisicao, sizeof(r[0].requisicao),
+        "GET /dados_sensores HTTP/1.1\r\nHost: estacao\r\n\r\n");
+    r[1].len = (uint16_t)snprintf(r[1].requisicao, sizeof(r[1].requisicao),
+        "GET / HTTP/1.1\r\nHost: estacao\r\nAccept-Encoding: gzip\r\n\r\n");
+    r[2].len = (uint16_t)snprintf(r[2].requisicao, sizeof(r[2].requisicao),
+        "POST /config HTTP/1.1\r\nHost: estacao\r\nContent-Type: application/json\r\n"
+        "Content-Length: %zu\r\n\r\n%s", sizeof(corpo) - 1, corpo);
+
+    // Intercala as rotas no ciclo, para que cada cliente passe por todas
+    uint8_t usados[CARGA_N_ROTAS] = { 0 };
+    for (int i = 0; i < CARGA_CICLO; i++) {
+        int melhor = 0;
+        for (int k = 1; k < (int)CARGA_N_ROTAS; k++) {
+            // Rota mais atrasada em relação à sua fração do ciclo
+            if ((usados[k] + 1) * carga_rotas[melhor].peso < (usados[melhor] + 1) * carga_rotas[k].peso) {
+                melhor = k;
+            }
+        }
+        usados[melhor]++;
+        carga_sequencia[i] = (uint8_t)melhor;
+    }
+}
+
+static void carga_registrar(CARGA_ROTA *r, uint32_t us) {
+    if (r->n == r->cap) {
+        r->cap = r->cap ? r->cap * 2 : 1024;
+        r->latencias_us = realloc(r->latencias_us, r->cap * sizeof(uint32_t));
+    }
+    r->latencias_us[r->n++] = us;
+}
+
+// =================================================================================
+// CLIENTES
+// =================================================================================
+
+typedef enum {
+    CLIENTE_DESCONECTADO,
+    CLIENTE_CONECTANDO,
+    CLIENTE_OCIOSO,         // Conectado, esperando o intervalo para a próxima requisição
+    CLIENTE_AGUARDANDO,     // Requisição enviada, lendo a resposta
+} CLIENTE_ESTADO;
+
+typedef enum {
+    RESP_CABECALHO,
+    RESP_CORPO,             // Content-Length (ou até o fim da conexão, se faltam < 0)
+    RESP_CHUNK_TAMANHO,
+    RESP_CHUNK_DADOS,
+    RESP_CHUNK_FIM,         // CRLF depois dos dados do chunk
+    RESP_TRAILER,
+} RESPOSTA_ESTADO;
+
+typedef struct {
+    int id;
+    struct tcp_pcb *pcb;
+    CLIENTE_ESTADO estado;
+    uint64_t proxima_us;    // Quando conectar ou enviar de novo
+    uint32_t enviadas;
+    CARGA_ROTA *rota;
+    uint64_t inicio_us;
+
+    // Resposta em leitura
+    RESPOSTA_ESTADO resp;
+    char cab[CARGA_CABECALHO_MAX];
+    uint16_t cab_len;
+    int status;
+    bool fechar;
+    long faltam;
+    uint16_t linha_len;
+} CLIENTE;
+
+// Falhas, do ponto de vista dos clientes
+static struct {
+    uint32_t conexoes;
+    uint32_t sem_memoria;       // tcp_new/tcp_connect/tcp_write recusados pela lwIP local
+    uint32_t recusadas;         // Conexão desfeita antes de estabelecer (RST)
+    uint32_t abortadas;         // Erro ou RST no meio de uma resposta
+    uint32_t encerradas;        // Servidor fechou sem responder
+    uint32_t tempo_esgotado;
+    uint32_t respostas_503;
+} carga_falhas;
+
+static CLIENTE carga_clientes[CARGA_CLIENTES_MAX];
+static int carga_n_clientes = CARGA_CLIENTES_PADRAO;
+static uint32_t carga_intervalo_ms;
+static uint64_t carga_bytes_recebidos;
+
+static uint64_t agora_us(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000u + (uint64_t)t.tv_nsec / 1000u;
+}
+
+static uint64_t espera_us(bool falha) {
+    uint32_t ms = carga_intervalo_ms;
+    if (falha && ms < CARGA_ESPERA_FALHA_MS) {
+        ms = CARGA_ESPERA_FALHA_MS;
+    }
+    return (uint64_t)ms * 1000u;
+}
+
+/**
+ * @brief Fecha (ou aborta) a conexão do cliente; uma nova será aberta depois de `espera` us.
+ * @return ERR_ABRT se foi preciso abortar o PCB (o callback da lwIP deve devolver isso).
+ */
+static err_t cliente_desligar(CLIENTE *c, uint64_t espera, bool abortar) {
+    err_t ret = ERR_OK;
+    if (c->pcb) {
+        tcp_arg(c->pcb, NULL);
+        tcp_recv(c->pcb, NULL);
+        tcp_err(c->pcb, NULL);
+        if (abortar || tcp_close(c->pcb) != ERR_OK) {
+            tcp_abort(c->pcb);
+            ret = ERR_ABRT;
+        }
+        c->pcb = NULL;
+    }
+    c->estado = CLIENTE_DESCONECTADO;
+    c->proxima_us = agora_us() + espera;
+    return ret;
+}
+
+static err_t cliente_enviar(CLIENTE *c) {
+    c->rota = &carga_rotas[carga_sequencia[(c->id + c->enviadas) % CARGA_CICLO]];
+    c->enviadas++;
+    c->resp = RESP_CABECALHO;
+    c->cab_len = 0;
+    c->inicio_us = agora_us();
+    if (tcp_write(c->pcb, c->rota->requisicao, c->rota->len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+        carga_falhas.sem_memoria++;
+        return cliente_desligar(c, espera_us(true), false);
+    }
+    tcp_output(c->pcb);
+    c->estado = CLIENTE_AGUARDANDO;
+    return ERR_OK;
+}
+
+/**
+ * @brief Fim do cabeçalho da resposta: extrai status, tamanho do corpo e keep-alive.
+ */
+static void cliente_cabecalho(CLIENTE *c) {
+    c->cab[c->cab_len] = '\0';
+    c->status = atoi(c->cab + 9);  // "HTTP/1.1 200 OK"
+    c->fechar = strcasestr(c->cab, "\r\nConnection: close") != NULL;
+    const char *cl = strcasestr(c->cab, "\r\nContent-Length:");
+    if (strcasestr(c->cab, "\r\nTransfer-Encoding: chunked")) {
+        c->resp = RESP_CHUNK_TAMANHO;
+        c->faltam = 0;
+    } else if (cl) {
+        c->resp = RESP_CORPO;
+        c->faltam = strtol(cl + 17, NULL, 10);
+    } else if (c->status == 304 || c->status == 204) {
+        c->resp = RESP_CORPO;
+        c->faltam = 0;
+    } else {
+        c->resp = RESP_CORPO;
+        c->faltam = -1;     // Corpo até o servidor fechar
+        c->fechar = true;
+    }
+}
+
+/**
+ * @brief Consome bytes da resposta.
+ * @return Quantos bytes foram usados; a resposta está completa quando c->resp ==
+ *         RESP_CORPO e c->faltam == 0.
+ */
+static size_t cliente_consumir(CLIENTE *c, const char *d, size_t n) {
+    size_t i = 0;
+    while (i < n) {
+        if (c->resp == RESP_CORPO || c->resp == RESP_CHUNK_DADOS) {
+            if (c->faltam == 0) {
+                if (c->resp == RESP_CORPO) {
+                    break;  // Completa
+                }
+                c->resp = RESP_CHUNK_FIM;
+                continue;
+            }
+            size_t k = n - i;
+            if (c->faltam > 0 && (long)k > c->faltam) {
+                k = (size_t)c->faltam;
+            }
+            if (c->faltam > 0) {
+                c->faltam -= (long)k;
+            }
+            i += k;
+            continue;
+        }
+
+        char ch = d[i++];
+        switch (c->resp) {
+            case RESP_CABECALHO:
+                if (c->cab_len < CARGA_CABECALHO_MAX - 1) {
+                    c->cab[c->cab_len++] = ch;
+                }
+                if (c->cab_len >= 4 && memcmp(c->cab + c->cab_len - 4, "\r\n\r\n", 4) == 0) {
+                    cliente_cabecalho(c);
+                }
+                break;
+            case RESP_CHUNK_TAMANHO:
+                if (ch == '\n') {
+                    if (c->faltam == 0) {
+                        c->resp = RESP_TRAILER;
+                        c->linha_len = 0;
+                    } else {
+                        c->resp = RESP_CHUNK_DADOS;
+                    }
+                } else if (ch >= '0' && ch <= '9') {
+                    c->faltam = c->faltam * 16 + (ch - '0');
+                } else if ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'f') {
+                    c->faltam = c->faltam * 16 + ((ch | 0x20) - 'a' + 10);
+                }
+                break;
+            case RESP_CHUNK_FIM:
+                if (ch == '\n') {
+                    c->resp = RESP_CHUNK_TAMANHO;
+                    c->faltam = 0;
+                }
+                break;
+            case RESP_TRAILER:
+                if (ch == '\n') {
+                    if (c->linha_len == 0) {
+                        c->resp = RESP_CORPO;   // Linha vazia: fim da resposta
+                        c->faltam = 0;
+                        return i;
+                    }
+                    c->linha_len = 0;
+                } else if (ch != '\r') {
+                    c->linha_len++;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return i;
+}
+
+static err_t cliente_resposta_completa(CLIENTE *c) {
+    uint32_t us = (uint32_t)(agora_us() - c->inicio_us);
+    bool falha = true;
+    if (c->status == 503) {
+        carga_falhas.respostas_503++;
+    } else if (c->status >= 400 || c->status < 100) {
+        c->rota->erros_http++;
+    } else {
+        carga_registrar(c->rota, us);
+        falha = false;
+    }
+    if (c->fechar) {
+        return cliente_desligar(c, espera_us(falha), false);
+    }
+    c->estado = CLIENTE_OCIOSO;
+    c->proxima_us = agora_us() + espera_us(falha);
+    return ERR_OK;
+}
+
+static err_t cliente_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
+    CLIENTE *c = arg;
+    if (!p) {
+        // O servidor fechou: ao fim de um corpo sem tamanho é o fim normal da resposta
+        if (c->estado == CLIENTE_AGUARDANDO && c->resp == RESP_CORPO && c->faltam < 0) {
+            c->faltam = 0;
+            c->fechar = true;
+            return cliente_resposta_completa(c);
+        }
+        bool falha = c->estado == CLIENTE_AGUARDANDO;
+        if (falha) {
+            carga_falhas.encerradas++;
+        }
+        return cliente_desligar(c, espera_us(falha), false);
+    }
+    if (err != ERR_OK) {
+        pbuf_free(p);
+        return err;
+    }
+
+    tcp_recved(pcb, p->tot_len);
+    carga_bytes_recebidos += p->tot_len;
+    err_t ret = ERR_OK;
+    if (c->estado == CLIENTE_AGUARDANDO) {
+        for (struct pbuf *q = p; q; q = q->next) {
+            cliente_consumir(c, q->payload, q->len);
+            if (c->resp == RESP_CORPO && c->faltam == 0) {
+                ret = cliente_resposta_completa(c);
+                break;
+            }
+        }
+    }
+    pbuf_free(p);
+    return ret;
+}
+
+static void cliente_err(void *arg, err_t err) {
+    CLIENTE *c = arg;
+    c->pcb = NULL;  // Já liberado pela lwIP
+    if (c->estado == CLIENTE_CONECTANDO) {
+        carga_falhas.recusadas++;
+    } else if (c->estado == CLIENTE_AGUARDANDO) {
+        carga_falhas.abortadas++;
+    }
+    (void)err;
+    c->estado = CLIENTE_DESCONECTADO;
+    c->proxima_us = agora_us() + espera_us(true);
+}
+
+static err_t cliente_conectado(void *arg, struct tcp_pcb *pcb, err_t err) {
+    CLIENTE *c = arg;
+    (void)pcb;
+    if (err != ERR_OK) {
+        return err;
+    }
+    carga_falhas.conexoes++;
+    return cliente_enviar(c);
+}
+
+static void cliente_conectar(CLIENTE *c) {
+    ip_addr_t servidor;
+    IP_ADDR4(&servidor, 127, 0, 0, 1);
+    c->pcb = tcp_new();
+    if (!c->pcb) {
+        carga_falhas.sem_memoria++;
+        c->proxima_us = agora_us() + espera_us(true);
+        return;
+    }
+    tcp_arg(c->pcb, c);
+    tcp_recv(c->pcb, cliente_recv);
+    tcp_err(c->pcb, cliente_err);
+    tcp_nagle_disable(c->pcb);
+    c->estado = CLIENTE_CONECTANDO;
+    if (tcp_connect(c->pcb, &servidor, CARGA_PORTA, cliente_conectado) != ERR_OK) {
+        carga_falhas.sem_memoria++;
+        cliente_desligar(c, espera_us(true), true);
+    }
+}
+
+// =================================================================================
+// RELATÓRIO
+// =================================================================================
+
+static int comparar_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentil_ms(const uint32_t *v, uint32_t n, double p) {
+    if (n == 0) {
+        return 0;
+    }
+    uint32_t i = (uint32_t)(p / 100.0 * (n - 1) + 0.5);
+    return v[i] / 1000.0;
+}
+
+static void imprimir_linha(const char *nome, uint32_t *v, uint32_t n, uint32_t erros, double segundos) {
+    qsort(v, n, sizeof(uint32_t), comparar_u32);
+    printf("%-20s %8u %9.1f %8.3f %8.3f %8.3f %8.3f %6u\n", nome, n, n / segundos,
+           percentil_ms(v, n, 50), percentil_ms(v, n, 90), percentil_ms(v, n, 99),
+           n ? v[n - 1] / 1000.0 : 0, erros);
+}
+
+static void carga_relatorio(double segundos) {
+    printf("\n%-20s %8s %9s %8s %8s %8s %8s %6s\n", "rota", "ok", "req/s", "p50 ms", "p90 ms",
+           "p99 ms", "max ms", "erros");
+
+    uint32_t total = 0, erros = 0;
+    for (int r = 0; r < (int)CARGA_N_ROTAS; r++) {
+        total += carga_rotas[r].n;
+        erros += carga_rotas[r].erros_http;
+    }
+    uint32_t *todas = malloc((total ? total : 1) * sizeof(uint32_t));
+    uint32_t k = 0;
+    for (int r = 0; r < (int)CARGA_N_ROTAS; r++) {
+        CARGA_ROTA *rota = &carga_rotas[r];
+        if (rota->n) {
+            memcpy(todas + k, rota->latencias_us, rota->n * sizeof(uint32_t));
+        }
+        k += rota->n;
+        imprimir_linha(rota->nome, rota->latencias_us, rota->n, rota->erros_http, segundos);
+    }
+    imprimir_linha("total", todas, total, erros, segundos);
+    free(todas);
+
+    printf("\nConexões abertas: %u; recebidos %.1f KiB\n", carga_falhas.conexoes,
+           carga_bytes_recebidos / 1024.0);
+    printf("Falhas: 503 %u, recusadas %u, abortadas %u, fechadas sem resposta %u, "
+           "tempo esgotado %u, sem memória no cliente %u\n",
+           carga_falhas.respostas_503, carga_falhas.recusadas, carga_falhas.abortadas,
+           carga_falhas.encerradas, carga_falhas.tempo_esgotado, carga_falhas.sem_memoria);
+
+    // O heap inclui as cópias feitas pela interface de loopback (na placa os pacotes
+    // recebidos vêm do pool do driver): o valor é um limite superior do uso real
+    printf("Heap lwIP: máximo %lu de %lu bytes, %lu falhas de alocação\n",
+           (unsigned long)lwip_stats.mem.max, (unsigned long)lwip_stats.mem.avail,
+           (unsigned long)lwip_stats.mem.err);
+    printf("Pools lwIP (máximo/total/falhas): PCB TCP %u/%u/%u, segmentos %u/%u/%u, pbuf pool %u/%u/%u\n",
+           (unsigned)lwip_stats.memp[MEMP_TCP_PCB]->max, (unsigned)lwip_stats.memp[MEMP_TCP_PCB]->avail,
+           (unsigned)lwip_stats.memp[MEMP_TCP_PCB]->err,
+           (unsigned)lwip_stats.memp[MEMP_TCP_SEG]->max, (unsigned)lwip_stats.memp[MEMP_TCP_SEG]->avail,
+           (unsigned)lwip_stats.memp[MEMP_TCP_SEG]->err,
+           (unsigned)lwip_stats.memp[MEMP_PBUF_POOL]->max, (unsigned)lwip_stats.memp[MEMP_PBUF_POOL]->avail,
+           (unsigned)lwip_stats.memp[MEMP_PBUF_POOL]->err);
+
+    HTTP_SERVER_STATS s;
+    http_server_get_stats(&s);
+    printf("Servidor: %u conexões simultâneas no máximo, %lu recusadas com 503, %lu bytes enviados\n",
+           s.conns_high_water, (unsigned long)s.conns_rejected, (unsigned long)s.bytes_sent);
+}
+
+// =================================================================================
+// PRINCIPAL
+// =================================================================================
+
+int main(int argc, char **argv) {
+    unsigned duracao_s = CARGA_DURACAO_PADRAO_S;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:d:i:h")) != -1) {
+        switch (opt) {
+            case 'c': carga_n_clientes = atoi(optarg); break;
+            case 'd': duracao_s = (unsigned)atoi(optarg); break;
+            case 'i': carga_intervalo_ms = (uint32_t)atoi(optarg); break;
+            default:
+                fprintf(stderr, "Uso: %s [-c clientes (1-%d)] [-d segundos] [-i intervalo_ms]\n",
+                        argv[0], CARGA_CLIENTES_MAX);
+                return 1;
+        }
+    }
+    if (carga_n_clientes < 1 || carga_n_clientes > CARGA_CLIENTES_MAX || duracao_s == 0) {
+        fprintf(stderr, "Parâmetros inválidos\n");
+        return 1;
+    }
+
+    lwip_init();
+    init_global_manager();
+    init_sensor_manager();
+    ler_sensores();
+    start_http_server();
+    carga_preparar_rotas();
+
+    printf("%d clientes, %u s, intervalo %u ms\n", carga_n_clientes, duracao_s, carga_intervalo_ms);
+
+    uint64_t inicio = agora_us();
+    uint64_t fim = inicio + (uint64_t)duracao_s * 1000000u;
+    uint64_t proxima_amostra = inicio + CARGA_AMOSTRAGEM_MS * 1000u;
+    for (int i = 0; i < carga_n_clientes; i++) {
+        carga_clientes[i].id = i;
+        carga_clientes[i].proxima_us = inicio;
+    }
+
+    uint64_t agora;
+    while ((agora = agora_us()) < fim) {
+        netif_poll_all();
+        sys_check_timeouts();
+
+        if (agora >= proxima_amostra) {
+            ler_sensores();
+            http_server_publicar();
+            proxima_amostra += CARGA_AMOSTRAGEM_MS * 1000u;
+        }
+
+        for (int i = 0; i < carga_n_clientes; i++) {
+            CLIENTE *c = &carga_clientes[i];
+            if (c->estado == CLIENTE_DESCONECTADO && agora >= c->proxima_us) {
+                cliente_conectar(c);
+            } else if (c->estado == CLIENTE_OCIOSO && agora >= c->proxima_us) {
+                cliente_enviar(c);
+            } else if (c->estado == CLIENTE_AGUARDANDO &&
+                       agora > c->inicio_us + CARGA_TIMEOUT_MS * 1000u) {
+                carga_falhas.tempo_esgotado++;
+                cliente_desligar(c, espera_us(true), true);
+            }
+        }
+    }
+
+    carga_relatorio((agora - inicio) / 1e6);
+    return 0;
+}
@@ -0,0 +1,12 @@
+// Ficheiro: pico/cyw43_arch.h (host)
+// No teste de carga a lwIP roda com NO_SYS=1 na mesma thread do servidor e dos clientes,
+// então o lock do núcleo da lwIP não tem efeito.
+#ifndef HOST_PICO_CYW43_ARCH_H
+#define HOST_PICO_CYW43_ARCH_H
+
+#include "pico/stdlib.h"
+
+static inline void cyw43_arch_lwip_begin(void) {}
+static inline void cyw43_arch_lwip_end(void) {}
+
+#endif
@@ -0,0 +1,30 @@
+// Ficheiro: pico/stdlib.h (host)
+// Substitui, no teste de carga, o pouco do Pico SDK que os módulos do servidor e dos
+// sensores usam. As implementações ficam em tools/carga/plataforma_host.c.
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define _u(x) x##u
+
+#define GPIO_FUNC_I2C 3
+
+absolute_time_t get_absolute_time(void);
+uint32_t to_ms_since_boot(absolute_time_t t);
+
+static inline uint64_t to_us_since_boot(absolute_time_t t) {
+    return t;
+}
+void sleep_ms(uint32_t ms);
+
+void gpio_set_function(uint gpio, int fn);
+void gpio_pull_up(uint gpio);
+
+#endif
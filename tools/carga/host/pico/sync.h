@@ -0,0 +1,16 @@
+// Ficheiro: pico/sync.h (host)
+// O teste de carga roda numa única thread: as seções críticas não precisam travar nada.
+#ifndef HOST_PICO_SYNC_H
+#define HOST_PICO_SYNC_H
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    int aninhamento;
+} critical_section_t;
+
+static inline void critical_section_init(critical_section_t *cs) { cs->aninhamento = 0; }
+static inline void critical_section_enter_blocking(critical_section_t *cs) { cs->aninhamento++; }
+static inline void critical_section_exit(critical_section_t *cs) { cs->aninhamento--; }
+
+#endif
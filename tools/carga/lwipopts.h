@@ -0,0 +1,32 @@
+// Ficheiro: lwipopts.h (teste de carga)
+// Mesmas opções do firmware (pools, buffers TCP, heap da lwIP), para que o teste no host
+// esbarre nos mesmos limites que a placa. Só muda o que a integração exige: sem sistema
+// operacional e com a interface de loopback no lugar do CYW43.
+
+#ifndef CARGA_LWIPOPTS_H
+#define CARGA_LWIPOPTS_H
+
+#include "../../include/lwipopts.h"
+
+// Servidor, clientes e lwIP na mesma thread: timers por sys_check_timeouts() e entrada
+// de pacotes por netif_poll_all()
+#undef NO_SYS
+#define NO_SYS                          1
+#define SYS_LIGHTWEIGHT_PROT            0
+
+// Clientes e servidor conversam por 127.0.0.1
+#define LWIP_HAVE_LOOPIF                1
+#define LWIP_NETIF_LOOPBACK             1
+
+// Contadores usados no relatório (uso máximo do heap e dos pools, falhas de alocação)
+#undef LWIP_STATS
+#define LWIP_STATS                      1
+#define MEM_STATS                       1
+#define MEMP_STATS                      1
+
+// Os clientes também consomem PCBs; o servidor continua limitado pelo próprio pool
+#undef MEMP_NUM_TCP_PCB
+#define MEMP_NUM_TCP_PCB                (16 + CARGA_CLIENTES_MAX)
+#define CARGA_CLIENTES_MAX              64
+
+#endif
@@ -0,0 +1,191 @@
+// Ficheiro: plataforma_host.c
+// Implementação, no host, das funções do Pico SDK usadas pelo servidor e pelos sensores,
+// e do relógio que a lwIP pede com NO_SYS=1. O barramento I2C simula um BMP280 e um
+// AHT20 com os valores de exemplo dos datasheets, para que /dados_sensores e /metrics
+// tenham leituras plausíveis, e o log de flash grava numa região em RAM.
+
+#include <string.h>
+#include <time.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "i2c_dma.h"
+#include "lwip/sys.h"
+#include "flash_log.h"
+#include "metricas.h"
+
+#define BMP280_ENDERECO     0x76
+#define AHT20_ENDERECO      0x38
+
+// =================================================================================
+// TEMPO
+// =================================================================================
+
+static uint64_t agora_us(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000u + (uint64_t)t.tv_nsec / 1000u;
+}
+
+absolute_time_t get_absolute_time(void) {
+    return agora_us();
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000u);
+}
+
+void sleep_ms(uint32_t ms) {
+    (void)ms;  // Os sensores simulados respondem na hora
+}
+
+u32_t sys_now(void) {
+    return (u32_t)(agora_us() / 1000u);
+}
+
+void gpio_set_function(uint gpio, int fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_pull_up(uint gpio) {
+    (void)gpio;
+}
+
+// =================================================================================
+// I2C SIMULADO
+// =================================================================================
+
+static struct i2c_inst { int id; } i2c_host[2] = { { 0 }, { 1 } };
+i2c_inst_t *i2c0 = &i2c_host[0];
+i2c_inst_t *i2c1 = &i2c_host[1];
+
+// Registradores do BMP280: calibração em 0x88 (exemplo da seção 3.12 do datasheet)
+// e a última conversão em 0xF7..0xFC (adc_P = 415148, adc_T = 519888)
+static uint8_t bmp280_regs[256];
+static uint8_t bmp280_ponteiro;
+static uint32_t bmp280_leituras;
+
+static void bmp280_preparar(void) {
+    static const uint16_t calib[12] = {
+        27504, 26435, (uint16_t)-1000,
+        36477, (uint16_t)-10685, 3024, 2855, 140, (uint16_t)-7, 15500, (uint16_t)-14600, 6000,
+    };
+    for (int i = 0; i < 12; i++) {
+        bmp280_regs[0x88 + 2 * i] = (uint8_t)calib[i];
+        bmp280_regs[0x89 + 2 * i] = (uint8_t)(calib[i] >> 8);
+    }
+}
+
+static void bmp280_converter(void) {
+    // A temperatura oscila alguns centésimos de grau entre as leituras
+    uint32_t adc_p = 415148;
+    uint32_t adc_t = 519888 + (bmp280_leituras++ % 16) * 40;
+    bmp280_regs[0xF7] = (uint8_t)(adc_p >> 12);
+    bmp280_regs[0xF8] = (uint8_t)(adc_p >> 4);
+    bmp280_regs[0xF9] = (uint8_t)(adc_p << 4);
+    bmp280_regs[0xFA] = (uint8_t)(adc_t >> 12);
+    bmp280_regs[0xFB] = (uint8_t)(adc_t >> 4);
+    bmp280_regs[0xFC] = (uint8_t)(adc_t << 4);
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    (void)i2c;
+    bmp280_preparar();
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    (void)i2c;
+    (void)nostop;
+    if (addr == BMP280_ENDERECO && len >= 1) {
+        bmp280_ponteiro = src[0];   // Escritas de 2 bytes (configuração) são aceitas e ignoradas
+    } else if (addr != AHT20_ENDERECO) {
+        return -1;
+    }
+    return (int)len;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    (void)i2c;
+    (void)nostop;
+    if (addr == BMP280_ENDERECO) {
+        if (bmp280_ponteiro == 0xF7) {
+            bmp280_converter();
+        }
+        for (size_t i = 0; i < len; i++) {
+            dst[i] = bmp280_regs[(uint8_t)(bmp280_ponteiro + i)];
+        }
+        return (int)len;
+    }
+    if (addr == AHT20_ENDERECO) {
+        // Status calibrado e livre; umidade 50% (0x80000) e temperatura 25 °C (0x60000)
+        static const uint8_t aht20[6] = { 0x18, 0x80, 0x00, 0x06, 0x00, 0x00 };
+        memcpy(dst, aht20, len < sizeof(aht20) ? len : sizeof(aht20));
+        return (int)len;
+    }
+    return -1;
+}
+
+// Transações de i2c_dma.h sobre o barramento simulado: escrita e leitura separadas, como
+// no caminho bloqueante do firmware
+static I2C_DMA_STATS i2c_stats[I2C_DMA_BARRAMENTOS];
+
+bool i2c_dma_iniciar(i2c_inst_t *i2c, size_t max_bytes) {
+    (void)i2c;
+    (void)max_bytes;
+    return true;
+}
+
+bool i2c_dma_transferir(i2c_inst_t *i2c, uint8_t destino,
+                        const uint8_t *escrita, size_t n_escrita,
+                        uint8_t *leitura, size_t n_leitura) {
+    bool ok = true;
+    if (n_escrita && i2c_write_blocking(i2c, destino, escrita, n_escrita, n_leitura > 0) != (int)n_escrita) {
+        ok = false;
+    } else if (n_leitura && i2c_read_blocking(i2c, destino, leitura, n_leitura, false) != (int)n_leitura) {
+        ok = false;
+    }
+    I2C_DMA_STATS *s = &i2c_stats[i2c->id];
+    s->transacoes++;
+    s->bytes += n_escrita + n_leitura;
+    s->erros += !ok;
+    s->bloqueantes++;
+    return ok;
+}
+
+void i2c_dma_get_stats(I2C_DMA_STATS stats[I2C_DMA_BARRAMENTOS]) {
+    memcpy(stats, i2c_stats, sizeof(i2c_stats));
+}
+
+// Sem FreeRTOS no host: o heap aparece vazio em /metrics
+void metricas_heap(METRICAS_HEAP *heap) {
+    heap->tamanho = heap->livre = heap->livre_minimo = 0;
+}
+
+// =================================================================================
+// FLASH SIMULADA
+// =================================================================================
+// Região do log (flash_log.c) em RAM, vazia a cada execução. Simulação completa, com
+// quedas de energia, em tools/flash_log.
+
+#define FLASH_HOST_TAMANHO  (64 * 1024)
+
+static uint32_t flash_host[FLASH_HOST_TAMANHO / sizeof(uint32_t)];
+
+static void flash_host_apagar(uint32_t offset) {
+    memset((uint8_t *)flash_host + offset, 0xFF, FLASH_LOG_SETOR);
+}
+
+static void flash_host_programar(uint32_t offset, const uint8_t *dados) {
+    uint8_t *p = (uint8_t *)flash_host + offset;
+    for (int i = 0; i < FLASH_LOG_PAGINA; i++) {
+        p[i] &= dados[i];
+    }
+}
+
+const FLASH_LOG_OPS *flash_log_regiao(void) {
+    static const FLASH_LOG_OPS ops = {
+        (const uint8_t *)flash_host, FLASH_HOST_TAMANHO, flash_host_apagar, flash_host_programar };
+    memset(flash_host, 0xFF, sizeof(flash_host));
+    return &ops;
+}
@@ -0,0 +1,454 @@
+// Ficheiro: compensacao.c
+// Testes e medição da compensação do BMP280 (bmp280_compensar, lib/bmp280.c).
+//
+//   compensacao [-n <repetições do benchmark>]
+//
+// 1. exemplo do datasheet (seção 3.12): adc_T = 519888 e adc_P = 415148 com a calibração
+//    de exemplo dão t_fine = 128422, 25,08 °C e 100653,27 Pa; a variante de 64 bits
+//    precisa ficar a 0,05 Pa disso e a de 32 bits a 5 Pa;
+// 2. vetores de ouro: para várias calibrações e leituras brutas entre -40 e 85 °C e entre
+//    300 e 1100 hPa, a saída precisa ser igual bit a bit à do código de referência da
+//    Bosch (as funções bmp280_compensate_*_int32/int64 do datasheet, transcritas abaixo
+//    sem alterações), nas duas variantes e nas funções separadas;
+// 3. precisão: erro de cada variante contra a compensação em ponto flutuante do
+//    datasheet (seção 8.1);
+// 4. benchmark: custo da compensação separada (t_fine calculado duas vezes) e das duas
+//    variantes unificadas. No host em ns por chamada; compilado para o Pico (PLACA=ON no
+//    CMake) em ciclos do M0+, contados pelo SysTick, com o resultado na serial USB.
+//
+// Sai com código 1 se algum vetor divergir.
+
+#if !PICO_ON_DEVICE
+#define _POSIX_C_SOURCE 200809L    // clock_gettime, getopt
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bmp280.h"
+#include "i2c_dma.h"
+
+#if PICO_ON_DEVICE
+#include "pico/stdlib.h"
+#include "hardware/structs/systick.h"
+#include "hardware/regs/m0plus.h"
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// O teste não usa o barramento: só a compensação do driver
+bool i2c_dma_transferir(i2c_inst_t *i2c, uint8_t destino,
+                        const uint8_t *escrita, size_t n_escrita,
+                        uint8_t *leitura, size_t n_leitura) {
+    (void)i2c;
+    (void)destino;
+    (void)escrita;
+    (void)n_escrita;
+    (void)leitura;
+    (void)n_leitura;
+    return false;
+}
+
+// =================================================================================
+// REFERÊNCIA DA BOSCH (datasheet do BMP280, seções 8.1 e 8.2)
+// =================================================================================
+// Transcrita sem alterações, inclusive os deslocamentos à esquerda de valores negativos
+// (o -fsanitize=undefined os aponta aqui; lib/bmp280.c usa multiplicações no lugar).
+
+typedef int32_t BMP280_S32_t;
+typedef uint32_t BMP280_U32_t;
+typedef int64_t BMP280_S64_t;
+
+static struct bmp280_calib_param ref_calib;
+#define dig_T1 ref_calib.dig_t1
+#define dig_T2 ref_calib.dig_t2
+#define dig_T3 ref_calib.dig_t3
+#define dig_P1 ref_calib.dig_p1
+#define dig_P2 ref_calib.dig_p2
+#define dig_P3 ref_calib.dig_p3
+#define dig_P4 ref_calib.dig_p4
+#define dig_P5 ref_calib.dig_p5
+#define dig_P6 ref_calib.dig_p6
+#define dig_P7 ref_calib.dig_p7
+#define dig_P8 ref_calib.dig_p8
+#define dig_P9 ref_calib.dig_p9
+
+static BMP280_S32_t t_fine;
+
+static BMP280_S32_t bmp280_compensate_T_int32(BMP280_S32_t adc_T) {
+    BMP280_S32_t var1, var2, T;
+    var1 = ((((adc_T>>3) - ((BMP280_S32_t)dig_T1<<1))) * ((BMP280_S32_t)dig_T2)) >> 11;
+    var2 = (((((adc_T>>4) - ((BMP280_S32_t)dig_T1)) * ((adc_T>>4) - ((BMP280_S32_t)dig_T1))) >> 12) *
+            ((BMP280_S32_t)dig_T3)) >> 14;
+    t_fine = var1 + var2;
+    T = (t_fine * 5 + 128) >> 8;
+    return T;
+}
+
+static BMP280_U32_t bmp280_compensate_P_int64(BMP280_S32_t adc_P) {
+    BMP280_S64_t var1, var2, p;
+    var1 = ((BMP280_S64_t)t_fine) - 128000;
+    var2 = var1 * var1 * (BMP280_S64_t)dig_P6;
+    var2 = var2 + ((var1*(BMP280_S64_t)dig_P5)<<17);
+    var2 = var2 + (((BMP280_S64_t)dig_P4)<<35);
+    var1 = ((var1 * var1 * (BMP280_S64_t)dig_P3)>>8) + ((var1 * (BMP280_S64_t)dig_P2)<<12);
+    var1 = (((((BMP280_S64_t)1)<<47)+var1))*((BMP280_S64_t)dig_P1)>>33;
+    if (var1 == 0) {
+        return 0; // avoid exception caused by division by zero
+    }
+    p = 1048576-adc_P;
+    p = (((p<<31)-var2)*3125)/var1;
+    var1 = (((BMP280_S64_t)dig_P9) * (p>>13) * (p>>13)) >> 25;
+    var2 = (((BMP280_S64_t)dig_P8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (((BMP280_S64_t)dig_P7)<<4);
+    return (BMP280_U32_t)p;
+}
+
+static BMP280_U32_t bmp280_compensate_P_int32(BMP280_S32_t adc_P) {
+    BMP280_S32_t var1, var2;
+    BMP280_U32_t p;
+    var1 = (((BMP280_S32_t)t_fine)>>1) - (BMP280_S32_t)64000;
+    var2 = (((var1>>2) * (var1>>2)) >> 11 ) * ((BMP280_S32_t)dig_P6);
+    var2 = var2 + ((var1*((BMP280_S32_t)dig_P5))<<1);
+    var2 = (var2>>2)+(((BMP280_S32_t)dig_P4)<<16);
+    var1 = (((dig_P3 * (((var1>>2) * (var1>>2)) >> 13 )) >> 3) + ((((BMP280_S32_t)dig_P2) * var1)>>1))>>18;
+    var1 =((((32768+var1))*((BMP280_S32_t)dig_P1))>>15);
+    if (var1 == 0) {
+        return 0; // avoid exception caused by division by zero
+    }
+    p = (((BMP280_U32_t)(((BMP280_S32_t)1048576)-adc_P)-(var2>>12)))*3125;
+    if (p < 0x80000000) {
+        p = (p << 1) / ((BMP280_U32_t)var1);
+    } else {
+        p = (p / (BMP280_U32_t)var1) * 2;
+    }
+    var1 = (((BMP280_S32_t)dig_P9) * ((BMP280_S32_t)(((p>>3) * (p>>3))>>13)))>>12;
+    var2 = (((BMP280_S32_t)(p>>2)) * ((BMP280_S32_t)dig_P8))>>13;
+    p = (BMP280_U32_t)((BMP280_S32_t)p + ((var1 + var2 + dig_P7) >> 4));
+    return p;
+}
+
+// Ponto flutuante (seção 8.1): temperatura em °C e pressão em Pa
+static double ref_t_fine_double;
+
+static double bmp280_compensate_T_double(BMP280_S32_t adc_T) {
+    double var1, var2, T;
+    var1 = (((double)adc_T)/16384.0 - ((double)dig_T1)/1024.0) * ((double)dig_T2);
+    var2 = ((((double)adc_T)/131072.0 - ((double)dig_T1)/8192.0) *
+            (((double)adc_T)/131072.0 - ((double) dig_T1)/8192.0)) * ((double)dig_T3);
+    ref_t_fine_double = var1 + var2;
+    T = (var1 + var2) / 5120.0;
+    return T;
+}
+
+static double bmp280_compensate_P_double(BMP280_S32_t adc_P) {
+    double var1, var2, p;
+    var1 = (ref_t_fine_double/2.0) - 64000.0;
+    var2 = var1 * var1 * ((double)dig_P6) / 32768.0;
+    var2 = var2 + var1 * ((double)dig_P5) * 2.0;
+    var2 = (var2/4.0)+(((double)dig_P4) * 65536.0);
+    var1 = (((double)dig_P3) * var1 * var1 / 524288.0 + ((double)dig_P2) * var1) / 524288.0;
+    var1 = (1.0 + var1 / 32768.0)*((double)dig_P1);
+    if (var1 == 0.0) {
+        return 0; // avoid exception caused by division by zero
+    }
+    p = 1048576.0 - (double)adc_P;
+    p = (p - (var2 / 4096.0)) * 6250.0 / var1;
+    var1 = ((double)dig_P9) * p * p / 2147483648.0;
+    var2 = p * ((double)dig_P8) / 32768.0;
+    p = p + (var1 + var2 + ((double)dig_P7)) / 16.0;
+    return p;
+}
+
+// =================================================================================
+// VETORES
+// =================================================================================
+
+// Calibração de exemplo do datasheet (seção 8.2) e de duas peças reais; as demais são
+// sorteadas em torno da primeira
+static const struct bmp280_calib_param CALIB_FIXAS[] = {
+    { 27504, 26435, -1000, 36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000 },
+    { 27821, 26379, 50, 37989, -10575, 3024, 6419, -51, -7, 15500, -14600, 6000 },
+    { 28009, 25654, 50, 36477, -10642, 3024, 7339, -99, -7, 15500, -14600, 6000 },
+};
+#define N_CALIB_SORTEADAS 5
+
+typedef struct {
+    int32_t adc_t;
+    int32_t adc_p;
+} VETOR;
+
+typedef struct {
+    struct bmp280_calib_param calib;
+    VETOR *v;
+    size_t n;
+} CONJUNTO;
+
+static CONJUNTO conjuntos[sizeof(CALIB_FIXAS) / sizeof(CALIB_FIXAS[0]) + N_CALIB_SORTEADAS];
+static size_t n_conjuntos;
+
+static int16_t perturbar(int16_t v, int amplitude) {
+    return (int16_t)(v + (rand() % (2 * amplitude + 1)) - amplitude);
+}
+
+/**
+ * @brief Leituras brutas de uma calibração com T entre -40 e 85 °C e P entre 300 e
+ * 1100 hPa (pela compensação em ponto flutuante).
+ */
+static void conjunto_gerar(CONJUNTO *c, size_t max) {
+    ref_calib = c->calib;
+    c->v = malloc(max * sizeof(VETOR));
+    c->n = 0;
+    for (int32_t adc_t = 300000; adc_t < 700000 && c->n < max; adc_t += 4111) {
+        double t = bmp280_compensate_T_double(adc_t);
+        if (t < -40.0 || t > 85.0) continue;
+        for (int32_t adc_p = 150000; adc_p < 750000 && c->n < max; adc_p += 2713) {
+            double p = bmp280_compensate_P_double(adc_p);
+            if (p < 30000.0 || p > 110000.0) continue;
+            c->v[c->n++] = (VETOR){ adc_t, adc_p };
+        }
+    }
+}
+
+static void conjuntos_gerar(void) {
+    n_conjuntos = 0;
+    for (size_t i = 0; i < sizeof(CALIB_FIXAS) / sizeof(CALIB_FIXAS[0]); i++) {
+        conjuntos[n_conjuntos++].calib = CALIB_FIXAS[i];
+    }
+    srand(1);
+    for (int i = 0; i < N_CALIB_SORTEADAS; i++) {
+        struct bmp280_calib_param c = CALIB_FIXAS[0];
+        c.dig_t1 = (uint16_t)(c.dig_t1 + rand() % 2001 - 1000);
+        c.dig_t2 = perturbar(c.dig_t2, 1000);
+        c.dig_t3 = perturbar(c.dig_t3, 1000);
+        c.dig_p1 = (uint16_t)(c.dig_p1 + rand() % 3001 - 1500);
+        c.dig_p2 = perturbar(c.dig_p2, 500);
+        c.dig_p4 = perturbar(c.dig_p4, 4000);
+        c.dig_p5 = perturbar(c.dig_p5, 200);
+        conjuntos[n_conjuntos++].calib = c;
+    }
+#if PICO_ON_DEVICE
+    const size_t max = 512;     // 264 KB de RAM: uma amostra da faixa basta para os ciclos
+#else
+    const size_t max = 200000;
+#endif
+    for (size_t i = 0; i < n_conjuntos; i++) {
+        conjunto_gerar(&conjuntos[i], max);
+    }
+}
+
+// =================================================================================
+// ETAPAS
+// =================================================================================
+
+static bool etapa_datasheet(void) {
+    ref_calib = CALIB_FIXAS[0];
+    bmp280_compensado_t c32, c64;
+    bool ok = bmp280_compensar(519888, 415148, &ref_calib, BMP280_PRESSAO_32BITS, &c32) &&
+              bmp280_compensar(519888, 415148, &ref_calib, BMP280_PRESSAO_64BITS, &c64);
+    bmp280_compensate_T_int32(519888);
+    double t = bmp280_compensate_T_double(519888);
+    double p = bmp280_compensate_P_double(415148);
+    ok = ok && t_fine == 128422 && c32.temperatura == 2508 && c64.temperatura == 2508 &&
+         fabs(t - 25.08) < 0.005 && fabs(p - 100653.27) < 0.005 &&
+         fabs(c64.pressao_q8 / 256.0 - p) < 0.05 && fabs((double)(c32.pressao_q8 >> 8) - p) < 5.0;
+    printf("datasheet: t_fine %ld, T %ld (0,01 °C), P64 %.2f Pa (Q24.8 %lu), P32 %lu Pa, "
+           "ponto flutuante %.2f °C e %.2f Pa: %s\n",
+           (long)t_fine, (long)c64.temperatura, c64.pressao_q8 / 256.0, (unsigned long)c64.pressao_q8,
+           (unsigned long)(c32.pressao_q8 >> 8), t, p, ok ? "ok" : "DIVERGE");
+    return ok;
+}
+
+static bool etapa_ouro(void) {
+    size_t total = 0, divergencias = 0;
+    for (size_t i = 0; i < n_conjuntos; i++) {
+        CONJUNTO *c = &conjuntos[i];
+        ref_calib = c->calib;
+        for (size_t k = 0; k < c->n; k++) {
+            const VETOR *v = &c->v[k];
+            int32_t t = bmp280_compensate_T_int32(v->adc_t);
+            uint32_t p32 = bmp280_compensate_P_int32(v->adc_p);
+            uint32_t p64 = bmp280_compensate_P_int64(v->adc_p);
+            bmp280_compensado_t c32, c64;
+            bmp280_compensar(v->adc_t, v->adc_p, &c->calib, BMP280_PRESSAO_32BITS, &c32);
+            bmp280_compensar(v->adc_t, v->adc_p, &c->calib, BMP280_PRESSAO_64BITS, &c64);
+            if (c32.temperatura != t || c64.temperatura != t || c32.pressao_q8 != p32 << 8 ||
+                c64.pressao_q8 != p64 ||
+                bmp280_convert_temp(v->adc_t, &c->calib) != t ||
+                bmp280_convert_pressure(v->adc_p, v->adc_t, &c->calib) != (int32_t)p32) {
+                if (divergencias++ < 5) {
+                    printf("  calibração %zu, adc_T %ld, adc_P %ld: T %ld/%ld, P32 %lu/%lu, P64 %lu/%lu\n",
+                           i, (long)v->adc_t, (long)v->adc_p, (long)c64.temperatura, (long)t,
+                           (unsigned long)(c32.pressao_q8 >> 8), (unsigned long)p32,
+                           (unsigned long)c64.pressao_q8, (unsigned long)p64);
+                }
+            }
+        }
+        total += c->n;
+    }
+    printf("vetores de ouro: %zu leituras em %zu calibrações, %zu divergências\n",
+           total, n_conjuntos, divergencias);
+    return divergencias == 0 && total > 0;
+}
+
+static void etapa_precisao(void) {
+    double erro_t = 0, erro_p32 = 0, erro_p64 = 0, soma_p32 = 0, soma_p64 = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < n_conjuntos; i++) {
+        CONJUNTO *c = &conjuntos[i];
+        ref_calib = c->calib;
+        for (size_t k = 0; k < c->n; k++) {
+            const VETOR *v = &c->v[k];
+            double t = bmp280_compensate_T_double(v->adc_t);
+            double p = bmp280_compensate_P_double(v->adc_p);
+            bmp280_compensado_t c32, c64;
+            bmp280_compensar(v->adc_t, v->adc_p, &c->calib, BMP280_PRESSAO_32BITS, &c32);
+            bmp280_compensar(v->adc_t, v->adc_p, &c->calib, BMP280_PRESSAO_64BITS, &c64);
+            double et = fabs(c64.temperatura / 100.0 - t);
+            double e32 = fabs(c32.pressao_q8 / 256.0 - p);
+            double e64 = fabs(c64.pressao_q8 / 256.0 - p);
+            if (et > erro_t) erro_t = et;
+            if (e32 > erro_p32) erro_p32 = e32;
+            if (e64 > erro_p64) erro_p64 = e64;
+            soma_p32 += e32;
+            soma_p64 += e64;
+        }
+        total += c->n;
+    }
+    printf("precisão contra o ponto flutuante: T máx %.4f °C; P32 máx %.3f Pa (média %.3f); "
+           "P64 máx %.3f Pa (média %.3f)\n",
+           erro_t, erro_p32, soma_p32 / total, erro_p64, soma_p64 / total);
+}
+
+// --- Benchmark ---
+
+static volatile uint32_t sorvedouro;    // Impede que o compilador descarte as chamadas
+
+#if PICO_ON_DEVICE
+static inline uint32_t contador(void) {
+    return systick_hw->cvr;
+}
+
+// SysTick decrementa a cada ciclo, com 24 bits: as medições são por chamada
+static inline uint32_t decorrido(uint32_t antes, uint32_t depois) {
+    return (antes - depois) & 0x00FFFFFFu;
+}
+#define UNIDADE "ciclos"
+#else
+static inline uint32_t contador(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint32_t)((uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec);
+}
+
+static inline uint32_t decorrido(uint32_t antes, uint32_t depois) {
+    return depois - antes;
+}
+#define UNIDADE "ns"
+#endif
+
+enum { BENCH_SEPARADA, BENCH_32, BENCH_64, N_BENCH };
+static const char *const BENCH_NOMES[N_BENCH] = {
+    "separada (convert_temp + convert_pressure)",
+    "unificada, 32 bits",
+    "unificada, 64 bits",
+};
+
+static void bench_chamada(int variante, CONJUNTO *c, const VETOR *v) {
+    bmp280_compensado_t saida;
+    switch (variante) {
+        case BENCH_SEPARADA:
+            sorvedouro += (uint32_t)bmp280_convert_temp(v->adc_t, &c->calib);
+            sorvedouro += (uint32_t)bmp280_convert_pressure(v->adc_p, v->adc_t, &c->calib);
+            break;
+        case BENCH_32:
+            bmp280_compensar(v->adc_t, v->adc_p, &c->calib, BMP280_PRESSAO_32BITS, &saida);
+            sorvedouro += saida.pressao_q8 + (uint32_t)saida.temperatura;
+            break;
+        default:
+            bmp280_compensar(v->adc_t, v->adc_p, &c->calib, BMP280_PRESSAO_64BITS, &saida);
+            sorvedouro += saida.pressao_q8 + (uint32_t)saida.temperatura;
+            break;
+    }
+}
+
+#if PICO_ON_DEVICE
+// Ciclos por chamada, descontado o custo de ler o SysTick; média e mínimo
+static void etapa_benchmark(uint32_t repeticoes) {
+    CONJUNTO *c = &conjuntos[0];
+    uint32_t vazio = 0xFFFFFFFFu;
+    for (int i = 0; i < 64; i++) {
+        uint32_t a = contador();
+        uint32_t d = decorrido(a, contador());
+        if (d < vazio) vazio = d;
+    }
+    for (int variante = 0; variante < N_BENCH; variante++) {
+        uint64_t soma = 0;
+        uint32_t minimo = 0xFFFFFFFFu;
+        for (uint32_t r = 0; r < repeticoes; r++) {
+            const VETOR *v = &c->v[(r * 7919u) % c->n];
+            uint32_t a = contador();
+            bench_chamada(variante, c, v);
+            uint32_t d = decorrido(a, contador()) - vazio;
+            soma += d;
+            if (d < minimo) minimo = d;
+        }
+        printf("  %-44s %8lu %s/chamada (mínimo %lu)\n", BENCH_NOMES[variante],
+               (unsigned long)(soma / repeticoes), UNIDADE, (unsigned long)minimo);
+    }
+}
+#else
+// No host uma chamada fica abaixo da resolução do relógio: mede o laço inteiro
+static void etapa_benchmark(uint32_t repeticoes) {
+    CONJUNTO *c = &conjuntos[0];
+    for (int variante = 0; variante < N_BENCH; variante++) {
+        uint32_t a = contador();
+        for (uint32_t r = 0; r < repeticoes; r++) {
+            bench_chamada(variante, c, &c->v[(r * 7919u) % c->n]);
+        }
+        uint32_t d = decorrido(a, contador());
+        printf("  %-44s %8.1f %s/chamada\n", BENCH_NOMES[variante], (double)d / repeticoes, UNIDADE);
+    }
+}
+#endif
+
+int main(int argc, char **argv) {
+    uint32_t repeticoes = 1000000;
+#if PICO_ON_DEVICE
+    (void)argc;
+    (void)argv;
+    stdio_init_all();
+    sleep_ms(3000);     // Tempo para o terminal abrir a serial USB
+    systick_hw->rvr = 0x00FFFFFFu;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+    repeticoes = 2000;
+#else
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n': repeticoes = (uint32_t)strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "uso: %s [-n repetições]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (repeticoes == 0) repeticoes = 1;
+#endif
+
+    conjuntos_gerar();
+    bool ok = etapa_datasheet();
+    ok = etapa_ouro() && ok;
+    etapa_precisao();
+    printf("benchmark (%lu chamadas):\n", (unsigned long)repeticoes);
+    etapa_benchmark(repeticoes);
+    printf(ok ? "OK\n" : "FALHOU\n");
+
+    for (size_t i = 0; i < n_conjuntos; i++) free(conjuntos[i].v);
+#if PICO_ON_DEVICE
+    while (true) tight_loop_contents();
+#endif
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+// Ficheiro: decode_telemetria.c
+// Decodificador de /dados.bin para o host. Usa o mesmo telemetria_bin.h do firmware,
+// então as duas pontas sempre concordam sobre o formato.
+//
+// Compilação:  cc -I../include -o decode_telemetria decode_telemetria.c
+// Uso:         curl -s http://<ip-da-placa>/dados.bin?since=0 | ./decode_telemetria
+//              ./decode_telemetria resposta.bin
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "telemetria_bin.h"
+
+static void imprimir_leitura(const char *rotulo, const TELEMETRIA_LEITURA *l) {
+    printf("%s seq=%lu temp=%.2f umid=%.2f press=%.2f alt=%.2f\n", rotulo, (unsigned long)l->seq,
+           l->temperatura / 100.0, l->umidade / 100.0, l->pressao / 100.0, l->altitude / 100.0);
+}
+
+int main(int argc, char **argv) {
+    FILE *f = stdin;
+    if (argc > 1 && !(f = fopen(argv[1], "rb"))) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    uint8_t cab[TELEMETRIA_CABECALHO_LEN];
+    TELEMETRIA_CABECALHO c;
+    if (fread(cab, 1, sizeof(cab), f) != sizeof(cab) || !telemetria_decodificar_cabecalho(cab, &c)) {
+        fprintf(stderr, "Resposta invalida ou versao nao suportada\n");
+        return 1;
+    }
+    printf("versao=%u alertas=0x%02X timestamp_ms=%lu amostras=%u\n",
+           c.versao, c.alertas, (unsigned long)c.timestamp_ms, c.n_amostras);
+    imprimir_leitura("atual", &c.atual);
+
+    for (unsigned i = 0; i < c.n_amostras; i++) {
+        uint8_t bloco[TELEMETRIA_AMOSTRA_LEN];
+        if (fread(bloco, 1, sizeof(bloco), f) != sizeof(bloco)) {
+            fprintf(stderr, "Resposta truncada na amostra %u\n", i);
+            return 1;
+        }
+        TELEMETRIA_LEITURA l;
+        telemetria_decodificar_amostra(bloco, &l);
+        if (l.seq == 0) {
+            printf("hist  (indisponivel)\n");
+        } else {
+            imprimir_leitura("hist ", &l);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,390 @@
+// Ficheiro: estresse.c
+// Teste de estresse, no host, da publicação das leituras (global_manage.c) com threads de
+// verdade. Uma thread faz o papel da tarefa dos sensores, chamando ler_sensores em laço
+// sobre um BMP280 e um AHT20 simulados cujos valores mudam a cada amostra. Outra alterna
+// entre duas configurações com aplicar_config. As demais tiram retratos com
+// get_sensor_data, como o servidor e a tarefa dos alertas.
+//
+//   estresse [-l <leitores>] [-n <amostras>]
+//
+// Cada retrato é conferido com o que a tarefa dos sensores publicou com aquela seq:
+// todos os campos precisam ser da mesma amostra, a configuração precisa ser uma das duas,
+// inteira e com a versão certa, a seq não pode voltar e a amostra precisa estar no
+// histórico com os mesmos valores. A pressão simulada percorre toda a faixa do BMP280
+// (300 a 1100 hPa), e a própria tarefa dos sensores confere o histórico de cada amostra.
+// Sai com código 1 na primeira divergência.
+
+#define _POSIX_C_SOURCE 200809L    // clock_gettime, getopt
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "i2c_dma.h"
+#include "global_manage.h"
+#include "flash_log.h"
+#include "bmp280.h"
+
+#define BMP280_ENDERECO     0x76
+#define AHT20_ENDERECO      0x38
+#define LEITORES_MAX        16
+
+// Uma leitura do AHT20 a cada AHT20_FALHA falha no barramento (a umidade anterior é mantida)
+#define AHT20_FALHA         7
+
+// =================================================================================
+// PLATAFORMA
+// =================================================================================
+// O relógio é avançado pela tarefa dos sensores (2 s por amostra), para que o tempo das
+// amostras também mude a cada publicação.
+
+static _Atomic uint64_t relogio_us;
+
+absolute_time_t get_absolute_time(void) {
+    return atomic_load(&relogio_us);
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000u);
+}
+
+void sleep_ms(uint32_t ms) {
+    (void)ms;  // Os sensores simulados respondem na hora
+}
+
+void gpio_set_function(uint gpio, int fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_pull_up(uint gpio) {
+    (void)gpio;
+}
+
+const FLASH_LOG_OPS *flash_log_regiao(void) {
+    return NULL;  // O log em flash tem a sua própria simulação (tools/flash_log)
+}
+
+// =================================================================================
+// I2C SIMULADO
+// =================================================================================
+// Só a tarefa dos sensores usa o barramento. As conversões dependem de `amostra`, o
+// número da leitura em andamento, para que duas amostras seguidas nunca coincidam.
+
+static struct i2c_inst { int id; } i2c_host[2] = { { 0 }, { 1 } };
+i2c_inst_t *i2c0 = &i2c_host[0];
+i2c_inst_t *i2c1 = &i2c_host[1];
+
+static uint8_t bmp280_regs[256];
+static uint8_t bmp280_ponteiro;
+static uint32_t amostra;
+
+static void bmp280_preparar(void) {
+    // Calibração do exemplo da seção 3.12 do datasheet
+    static const uint16_t calib[12] = {
+        27504, 26435, (uint16_t)-1000,
+        36477, (uint16_t)-10685, 3024, 2855, 140, (uint16_t)-7, 15500, (uint16_t)-14600, 6000,
+    };
+    for (int i = 0; i < 12; i++) {
+        bmp280_regs[0x88 + 2 * i] = (uint8_t)calib[i];
+        bmp280_regs[0x89 + 2 * i] = (uint8_t)(calib[i] >> 8);
+    }
+}
+
+static void bmp280_converter(void) {
+    // Com a calibração do datasheet: ~1100 hPa a ~300 hPa, a faixa de medida do sensor
+    uint32_t adc_p = 361000 + (amostra % 977) * 480;
+    uint32_t adc_t = 519888 + (amostra % 1000) * 37;
+    bmp280_regs[0xF7] = (uint8_t)(adc_p >> 12);
+    bmp280_regs[0xF8] = (uint8_t)(adc_p >> 4);
+    bmp280_regs[0xF9] = (uint8_t)(adc_p << 4);
+    bmp280_regs[0xFA] = (uint8_t)(adc_t >> 12);
+    bmp280_regs[0xFB] = (uint8_t)(adc_t >> 4);
+    bmp280_regs[0xFC] = (uint8_t)(adc_t << 4);
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    (void)i2c;
+    bmp280_preparar();
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    (void)i2c;
+    (void)nostop;
+    if (addr == BMP280_ENDERECO && len >= 1) {
+        bmp280_ponteiro = src[0];
+    } else if (addr != AHT20_ENDERECO) {
+        return -1;
+    }
+    return (int)len;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    (void)i2c;
+    (void)nostop;
+    if (addr == BMP280_ENDERECO) {
+        if (bmp280_ponteiro == 0xF7) {
+            bmp280_converter();
+        }
+        for (size_t i = 0; i < len; i++) {
+            dst[i] = bmp280_regs[(uint8_t)(bmp280_ponteiro + i)];
+        }
+        return (int)len;
+    }
+    if (addr == AHT20_ENDERECO) {
+        if (len == 1) {
+            dst[0] = 0x18;  // Calibrado e livre
+            return 1;
+        }
+        if (amostra % AHT20_FALHA == 0) {
+            return -1;
+        }
+        uint32_t umidade = 0x40000 + (amostra % 1013) * 300;
+        uint32_t temperatura = 0x60000;
+        uint8_t quadro[6] = { 0x18, (uint8_t)(umidade >> 12), (uint8_t)(umidade >> 4),
+                              (uint8_t)((umidade << 4) | (temperatura >> 16)),
+                              (uint8_t)(temperatura >> 8), (uint8_t)temperatura };
+        memcpy(dst, quadro, len < sizeof(quadro) ? len : sizeof(quadro));
+        return (int)len;
+    }
+    return -1;
+}
+
+// Transações de i2c_dma.h sobre o barramento simulado: escrita e leitura separadas, como
+// no caminho bloqueante do firmware
+bool i2c_dma_iniciar(i2c_inst_t *i2c, size_t max_bytes) {
+    (void)i2c;
+    (void)max_bytes;
+    return true;
+}
+
+bool i2c_dma_transferir(i2c_inst_t *i2c, uint8_t destino,
+                        const uint8_t *escrita, size_t n_escrita,
+                        uint8_t *leitura, size_t n_leitura) {
+    if (n_escrita && i2c_write_blocking(i2c, destino, escrita, n_escrita, n_leitura > 0) != (int)n_escrita) {
+        return false;
+    }
+    return n_leitura == 0 || i2c_read_blocking(i2c, destino, leitura, n_leitura, false) == (int)n_leitura;
+}
+
+// =================================================================================
+// THREADS
+// =================================================================================
+
+// Leitura publicada com cada seq, anotada pela tarefa dos sensores logo após publicá-la
+typedef struct {
+    float temperatura_bmp;
+    float umidade_aht;
+    float pressao_hpa;
+    float altitude;
+    uint32_t timestamp_ms;
+    uint32_t erros_i2c;
+} ESPERADO;
+
+static ESPERADO *esperados;
+static uint32_t n_amostras = 200000;
+static _Atomic uint32_t esperado_ate;
+static _Atomic bool terminou;
+static _Atomic bool falhou;
+
+static CONFIG_ESTACAO config_padrao, config_a, config_b;
+
+typedef struct {
+    pthread_t thread;
+    uint64_t retratos;
+    uint64_t fora_do_historico;
+    uint32_t seqs_distintas;
+} LEITOR;
+
+static void falhar(const char *motivo, uint32_t seq) {
+    if (!atomic_exchange(&falhou, true)) {
+        printf("FALHOU: %s (seq %u)\n", motivo, seq);
+    }
+}
+
+static bool proximo(float a, float b, float tolerancia) {
+    return fabsf(a - b) <= tolerancia;
+}
+
+// A amostra do histórico tem os valores do retrato até meio passo do ponto fixo de
+// HIST_REGISTRO, sem saturar em nenhuma parte da faixa do sensor
+static bool historico_confere(const AMOSTRA *a, const SENSOR_DATA *d) {
+    return proximo(a->temperatura, d->temperatura_bmp, 0.006f) && proximo(a->umidade, d->umidade_aht, 0.006f) &&
+           proximo(a->pressao, d->pressao_hpa, 0.6f / HIST_PRESSAO_ESCALA) &&
+           proximo(a->altitude, d->altitude, 0.6f / HIST_ALTITUDE_ESCALA);
+}
+
+static void *tarefa_sensores(void *arg) {
+    (void)arg;
+    for (amostra = 1; amostra <= n_amostras && !atomic_load(&falhou); amostra++) {
+        atomic_fetch_add(&relogio_us, 2000000);
+        ler_sensores();
+
+        // Só esta thread publica: a cópia tirada aqui é exatamente a que foi publicada
+        SENSOR_DATA d;
+        get_sensor_data(&d);
+        if (d.seq != amostra) {
+            falhar("seq publicada fora de ordem", d.seq);
+            break;
+        }
+        AMOSTRA a;
+        if (!get_amostra(d.seq, &a) || !historico_confere(&a, &d)) {
+            falhar("histórico diferente da leitura publicada", d.seq);
+            break;
+        }
+        esperados[d.seq] = (ESPERADO){ d.temperatura_bmp, d.umidade_aht, d.pressao_hpa, d.altitude,
+                                       d.timestamp_ms, d.erros_i2c };
+        atomic_store_explicit(&esperado_ate, d.seq, memory_order_release);
+    }
+    atomic_store(&terminou, true);
+    return NULL;
+}
+
+static void *tarefa_config(void *arg) {
+    uint64_t *aplicadas = arg;
+    while (!atomic_load(&terminou)) {
+        aplicar_config(++*aplicadas % 2 ? &config_a : &config_b);
+    }
+    return NULL;
+}
+
+static void conferir(const SENSOR_DATA *d) {
+    // Configuração: a versão ímpar é a A, a par é a B (a 0 é a padrão)
+    const CONFIG_ESTACAO *cfg = d->config_versao == 0 ? &config_padrao
+                              : d->config_versao % 2 ? &config_a : &config_b;
+    if (memcmp(&d->config, cfg, sizeof(*cfg)) != 0) {
+        falhar("configuração misturada ou de outra versão", d->seq);
+        return;
+    }
+    if (d->seq == 0) {
+        return;
+    }
+
+    // Leituras: todos os campos da mesma amostra
+    while (atomic_load_explicit(&esperado_ate, memory_order_acquire) < d->seq) {
+        if (atomic_load(&falhou)) {
+            return;
+        }
+        sched_yield();  // A tarefa dos sensores ainda vai anotar esta seq
+    }
+    const ESPERADO *e = &esperados[d->seq];
+    if (d->temperatura_bmp != e->temperatura_bmp || d->umidade_aht != e->umidade_aht ||
+        d->pressao_hpa != e->pressao_hpa || d->altitude != e->altitude ||
+        d->timestamp_ms != e->timestamp_ms || d->erros_i2c != e->erros_i2c) {
+        falhar("campos de amostras diferentes no mesmo retrato", d->seq);
+    }
+}
+
+static void *tarefa_leitor(void *arg) {
+    LEITOR *l = arg;
+    uint32_t anterior = 0;
+    while (!atomic_load(&terminou) && !atomic_load(&falhou)) {
+        SENSOR_DATA d;
+        get_sensor_data(&d);
+        l->retratos++;
+        if (d.seq < anterior) {
+            falhar("seq voltou", d.seq);
+            break;
+        }
+        l->seqs_distintas += d.seq != anterior;
+        anterior = d.seq;
+        conferir(&d);
+
+        // A amostra do retrato já está no histórico, com os mesmos valores
+        AMOSTRA a;
+        if (d.seq == 0) {
+            continue;
+        }
+        if (!get_amostra(d.seq, &a)) {
+            l->fora_do_historico++;  // O leitor ficou mais de HIST_LEN amostras para trás
+            continue;
+        }
+        if (!historico_confere(&a, &d)) {
+            falhar("histórico diferente do retrato", d.seq);
+        }
+    }
+    return NULL;
+}
+
+static double agora_s(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+    int n_leitores = 4;
+    int opt;
+    while ((opt = getopt(argc, argv, "l:n:")) != -1) {
+        switch (opt) {
+            case 'l': n_leitores = atoi(optarg); break;
+            case 'n': n_amostras = (uint32_t)atoi(optarg); break;
+            default:
+                fprintf(stderr, "uso: %s [-l leitores] [-n amostras]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (n_leitores < 1 || n_leitores > LEITORES_MAX || n_amostras < 1) {
+        fprintf(stderr, "de 1 a %d leitores e pelo menos 1 amostra\n", LEITORES_MAX);
+        return 2;
+    }
+    esperados = calloc(n_amostras + 1, sizeof(*esperados));
+
+    init_global_manager();
+    init_sensor_manager();
+    get_config(&config_padrao);
+    // Duas configurações que diferem em todos os campos, inclusive nos offsets (que mudam
+    // as leituras da amostra seguinte)
+    config_a = config_padrao;
+    config_b = (CONFIG_ESTACAO){
+        .offset_temp = 1.5f, .offset_press = -2.0f, .offset_umid = 3.0f, .offset_alt = -40.0f,
+        .pressao_nivel_mar = 1020.0f, .perfil_bmp280 = BMP280_PERFIL_ALTA_TAXA,
+        .limite_min_temp = 5, .limite_max_temp = 45, .limite_min_umid = 10, .limite_max_umid = 90,
+        .limite_min_press = 850, .limite_max_press = 1150, .limite_min_alt = -500, .limite_max_alt = 3000,
+    };
+    const char *invalido = validar_config(&config_b);
+    if (invalido) {
+        fprintf(stderr, "config_b invalida: %s\n", invalido);
+        return 2;
+    }
+
+    LEITOR leitores[LEITORES_MAX] = { 0 };
+    uint64_t aplicadas = 0;
+    pthread_t sensores, config;
+    double t0 = agora_s();
+    for (int i = 0; i < n_leitores; i++) {
+        pthread_create(&leitores[i].thread, NULL, tarefa_leitor, &leitores[i]);
+    }
+    pthread_create(&config, NULL, tarefa_config, &aplicadas);
+    pthread_create(&sensores, NULL, tarefa_sensores, NULL);
+    pthread_join(sensores, NULL);
+    pthread_join(config, NULL);
+    uint64_t retratos = 0;
+    for (int i = 0; i < n_leitores; i++) {
+        pthread_join(leitores[i].thread, NULL);
+        retratos += leitores[i].retratos;
+    }
+    double t = agora_s() - t0;
+
+    printf("%u amostras publicadas e %llu configurações aplicadas em %.2f s\n", atomic_load(&esperado_ate),
+           (unsigned long long)aplicadas, t);
+    for (int i = 0; i < n_leitores; i++) {
+        printf("  leitor %d: %llu retratos, %u seqs distintas, %llu fora do histórico\n", i,
+               (unsigned long long)leitores[i].retratos, leitores[i].seqs_distintas,
+               (unsigned long long)leitores[i].fora_do_historico);
+    }
+    printf("%.1f M retratos/s no total\n", retratos / t / 1e6);
+
+    bool ok = !atomic_load(&falhou) && atomic_load(&esperado_ate) == n_amostras;
+    printf(ok ? "OK\n" : "FALHOU\n");
+    free(esperados);
+    return ok ? 0 : 1;
+}
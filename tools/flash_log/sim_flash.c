@@ -0,0 +1,412 @@
+// Ficheiro: sim_flash.c
+// Simulação, no host, do log em flash (lib/flash_log.c) sobre uma NOR em RAM: apagar
+// deixa o setor em 0xFF e programar só leva bits de 1 para 0, como no W25Q16 do Pico W.
+//
+//   sim_flash [-t <KB da região>] [-q <quedas de energia>] [-s <semente>]
+//
+// Três etapas, cada uma falha com código de saída 1 se o log não se comportar:
+//  1. formato: várias voltas pela região, reabertura e consultas por faixa de tempo
+//     comparadas com um modelo em memória;
+//  2. quedas de energia: gravações e apagamentos interrompidos em pontos aleatórios,
+//     seguidos de recuperação; nenhum registro gravado por inteiro pode se perder, e os
+//     devolvidos precisam ser exatamente os gravados, em ordem;
+//  3. desempenho: vazão de escrita e de consulta no host, desgaste por setor e o tempo
+//     que a gravação tomaria do Pico (com os tempos típicos do datasheet da flash).
+
+#define _POSIX_C_SOURCE 200809L    // clock_gettime, getopt
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "flash_log.h"
+
+// Tempos típicos do W25Q16JV (datasheet, tabela de características AC)
+#define FLASH_PROGRAMAR_PAGINA_MS   0.4
+#define FLASH_APAGAR_SETOR_MS       45.0
+
+#define INTERVALO_S                 2       // Uma leitura a cada 2 s, como no firmware
+
+static uint8_t *flash;
+static uint32_t flash_tamanho;
+static uint32_t *apagamentos;               // Por setor
+static uint32_t programacoes;
+
+// Queda de energia: a operação de número `corte` é interrompida no meio
+static long operacoes;
+static long corte = -1;
+static jmp_buf queda;
+
+static unsigned aleatorio(unsigned n) {
+    return (unsigned)(rand() % (int)n);
+}
+
+static double agora_s(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// =================================================================================
+// FLASH NOR SIMULADA
+// =================================================================================
+
+static void sim_apagar_setor(uint32_t offset) {
+    uint32_t n = FLASH_LOG_SETOR;
+    bool interrompida = (operacoes++ == corte);
+    if (interrompida) {
+        n = aleatorio(FLASH_LOG_SETOR);
+    }
+    memset(flash + offset, 0xFF, n);
+    apagamentos[offset / FLASH_LOG_SETOR]++;
+    if (interrompida) {
+        longjmp(queda, 1);
+    }
+}
+
+static void sim_programar_pagina(uint32_t offset, const uint8_t *dados) {
+    uint32_t n = FLASH_LOG_PAGINA;
+    bool interrompida = (operacoes++ == corte);
+    if (interrompida) {
+        n = aleatorio(FLASH_LOG_PAGINA);
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        flash[offset + i] &= dados[i];
+    }
+    if (interrompida) {
+        // O byte em programação no momento da queda fica com bits quaisquer
+        flash[offset + n] &= (uint8_t)rand();
+        longjmp(queda, 1);
+    }
+    programacoes++;
+}
+
+static FLASH_LOG_OPS ops = { NULL, 0, sim_apagar_setor, sim_programar_pagina };
+
+// =================================================================================
+// MODELO
+// =================================================================================
+// Tudo o que foi acrescentado, na ordem. `gravados` marca quantos já estavam numa página
+// programada por inteiro, os únicos que o log é obrigado a devolver após uma queda.
+
+typedef struct {
+    FLASH_LOG_REGISTRO *r;
+    size_t n;
+    size_t cap;
+    size_t gravados;
+} MODELO;
+
+static MODELO modelo;
+static uint32_t uptime;
+
+static HIST_REGISTRO valores_de(size_t i) {
+    HIST_REGISTRO v = { (int16_t)(2000 + i % 700), (uint16_t)(5000 + i % 3000),
+                        (uint16_t)(51325 + i % 400), (int16_t)(7600 + i % 50) };
+    return v;
+}
+
+/**
+ * @brief Acrescenta uma leitura ao log e ao modelo. Pode não retornar (queda de energia).
+ */
+static void acrescentar(void) {
+    if (modelo.n == modelo.cap) {
+        modelo.cap = modelo.cap ? 2 * modelo.cap : 4096;
+        modelo.r = realloc(modelo.r, modelo.cap * sizeof(*modelo.r));
+    }
+    HIST_REGISTRO v = valores_de(modelo.n);
+    uint32_t gravadas = programacoes;
+    modelo.r[modelo.n].tempo_s = flash_log_agora(uptime);
+    modelo.r[modelo.n].valores = v;
+    modelo.n++;
+    flash_log_acrescentar(uptime, &v);
+    if (programacoes != gravadas) {
+        modelo.gravados = modelo.n;
+    }
+    uptime += INTERVALO_S;
+}
+
+static bool mesmo_registro(const FLASH_LOG_REGISTRO *a, const FLASH_LOG_REGISTRO *b) {
+    return a->tempo_s == b->tempo_s && memcmp(&a->valores, &b->valores, sizeof(a->valores)) == 0;
+}
+
+/**
+ * @brief Reinicia a estação: o log é reaberto a partir do conteúdo da flash.
+ * O que estava só no buffer em RAM se perde.
+ */
+static void reiniciar(void) {
+    uptime = 0;
+    flash_log_iniciar(&ops, uptime);
+    modelo.n = modelo.gravados;
+}
+
+/**
+ * @brief Percorre a consulta [de, ate] e confere com o modelo.
+ * @param exigir_todos Todos os registros gravados do modelo na faixa (a partir do mais
+ *        antigo ainda no log) precisam aparecer.
+ * @return Número de registros devolvidos, ou -1 em caso de divergência.
+ */
+static long conferir_faixa(uint32_t de, uint32_t ate, bool exigir_todos) {
+    FLASH_LOG_CURSOR c;
+    FLASH_LOG_REGISTRO r;
+    flash_log_buscar(&c, de, ate);
+
+    // Posição do modelo onde a consulta deve começar
+    size_t i = 0;
+    long n = 0;
+    while (flash_log_ler(&c, &r)) {
+        if (r.tempo_s < de || r.tempo_s > ate) {
+            printf("  registro fora da faixa: %u em [%u, %u]\n", r.tempo_s, de, ate);
+            return -1;
+        }
+        while (i < modelo.n && !mesmo_registro(&modelo.r[i], &r)) {
+            if (exigir_todos && n > 0 && i < modelo.gravados && modelo.r[i].tempo_s >= de) {
+                printf("  registro gravado perdido: tempo %u\n", modelo.r[i].tempo_s);
+                return -1;
+            }
+            i++;
+        }
+        if (i == modelo.n) {
+            printf("  registro desconhecido ou fora de ordem: tempo %u\n", r.tempo_s);
+            return -1;
+        }
+        i++;
+        n++;
+        flash_log_avancar(&c);
+    }
+    if (exigir_todos) {
+        // Do último devolvido até o fim da faixa, tudo o que foi gravado deveria ter vindo
+        for (; i < modelo.gravados; i++) {
+            if (modelo.r[i].tempo_s >= de && modelo.r[i].tempo_s <= ate && n > 0) {
+                printf("  registro gravado perdido no fim: tempo %u\n", modelo.r[i].tempo_s);
+                return -1;
+            }
+        }
+    }
+    return n;
+}
+
+// =================================================================================
+// ETAPAS
+// =================================================================================
+
+static uint32_t registros_por_volta(void) {
+    return flash_tamanho / FLASH_LOG_PAGINA * FLASH_LOG_REGISTROS_POR_PAGINA;
+}
+
+static bool etapa_formato(void) {
+    printf("1. formato e consultas\n");
+    memset(flash, 0xFF, flash_tamanho);
+    modelo.n = modelo.gravados = 0;
+    reiniciar();
+
+    // Log vazio
+    if (conferir_faixa(0, UINT32_MAX, true) != 0) {
+        printf("  log vazio devolveu registros\n");
+        return false;
+    }
+
+    // Duas voltas e meia pela região, reabrindo o log algumas vezes no caminho
+    uint32_t total = registros_por_volta() * 5 / 2;
+    for (uint32_t k = 0; k < total; k++) {
+        acrescentar();
+        if (k % (total / 7) == 0) {
+            flash_log_descarregar();
+            modelo.gravados = modelo.n;
+            reiniciar();
+        }
+    }
+    flash_log_descarregar();
+    modelo.gravados = modelo.n;
+    reiniciar();
+
+    long n = conferir_faixa(0, UINT32_MAX, true);
+    if (n < 0) {
+        return false;
+    }
+    // O log guarda a região inteira menos o setor que será apagado a seguir (no máximo)
+    long minimo = (long)(flash_tamanho / FLASH_LOG_SETOR - 1) * FLASH_LOG_PAGINAS_POR_SETOR *
+                  FLASH_LOG_REGISTROS_POR_PAGINA * 9 / 10;
+    printf("  %zu registros acrescentados, %ld no log (região de %u KB)\n", modelo.n, n, flash_tamanho / 1024);
+    if (n < minimo) {
+        printf("  log guardou menos que o esperado (%ld)\n", minimo);
+        return false;
+    }
+
+    // Faixas aleatórias, conferidas contra o modelo
+    uint32_t inicio = modelo.r[modelo.n - n].tempo_s, fim = modelo.r[modelo.n - 1].tempo_s;
+    for (int k = 0; k < 2000; k++) {
+        uint32_t de = inicio + aleatorio(fim - inicio + 1);
+        uint32_t ate = de + aleatorio(6 * 3600);
+        long esperado = 0;
+        for (size_t i = modelo.n - n; i < modelo.n; i++) {
+            esperado += modelo.r[i].tempo_s >= de && modelo.r[i].tempo_s <= ate;
+        }
+        long obtido = conferir_faixa(de, ate, true);
+        if (obtido != esperado) {
+            printf("  faixa [%u, %u]: %ld registros, esperado %ld\n", de, ate, obtido, esperado);
+            return false;
+        }
+    }
+    printf("  2000 consultas por faixa conferem com o modelo\n");
+    return true;
+}
+
+static bool etapa_quedas(int quedas) {
+    printf("2. quedas de energia durante a gravação\n");
+    memset(flash, 0xFF, flash_tamanho);
+    modelo.n = modelo.gravados = 0;
+    reiniciar();
+
+    int interrompidas = 0;
+    uint32_t paginas_invalidas = 0;
+    for (int k = 0; k < quedas; k++) {
+        // Interrompe uma das próximas operações de flash
+        operacoes = 0;
+        corte = aleatorio(40);
+        if (setjmp(queda) == 0) {
+            for (uint32_t i = 0; i < 50 * FLASH_LOG_REGISTROS_POR_PAGINA; i++) {
+                acrescentar();
+            }
+        } else {
+            interrompidas++;
+        }
+        corte = -1;
+        reiniciar();
+
+        FLASH_LOG_STATS s;
+        flash_log_get_stats(&s);
+        paginas_invalidas += s.paginas_invalidas;
+        if (conferir_faixa(0, UINT32_MAX, true) < 0) {
+            printf("  falhou após a queda %d\n", k + 1);
+            return false;
+        }
+        // A última leitura gravada por inteiro sobreviveu
+        FLASH_LOG_CURSOR c;
+        FLASH_LOG_REGISTRO r;
+        if (modelo.gravados > 0) {
+            const FLASH_LOG_REGISTRO *ultimo = &modelo.r[modelo.gravados - 1];
+            flash_log_buscar(&c, ultimo->tempo_s, ultimo->tempo_s);
+            if (!flash_log_ler(&c, &r) || !mesmo_registro(&r, ultimo)) {
+                printf("  última leitura gravada perdida após a queda %d\n", k + 1);
+                return false;
+            }
+        }
+    }
+    FLASH_LOG_STATS s;
+    flash_log_get_stats(&s);
+    printf("  %d quedas (%d no meio de uma gravação), %u páginas inválidas puladas na recuperação,"
+           " boot %u\n", quedas, interrompidas, paginas_invalidas, s.boot);
+    return true;
+}
+
+static bool etapa_desempenho(void) {
+    printf("3. desempenho\n");
+    memset(flash, 0xFF, flash_tamanho);
+    modelo.n = modelo.gravados = 0;
+    memset(apagamentos, 0, flash_tamanho / FLASH_LOG_SETOR * sizeof(*apagamentos));
+    programacoes = 0;
+    reiniciar();
+
+    // Dez voltas pela região
+    uint32_t total = registros_por_volta() * 10;
+    double t0 = agora_s();
+    for (uint32_t k = 0; k < total; k++) {
+        HIST_REGISTRO v = valores_de(k);
+        flash_log_acrescentar(uptime, &v);
+        uptime += INTERVALO_S;
+    }
+    double escrita = agora_s() - t0;
+    printf("  escrita: %.1f M registros/s no host (%u registros)\n", total / escrita / 1e6, total);
+
+    uint32_t n_setores = flash_tamanho / FLASH_LOG_SETOR, min = UINT32_MAX, max = 0;
+    for (uint32_t s = 0; s < n_setores; s++) {
+        if (apagamentos[s] < min) min = apagamentos[s];
+        if (apagamentos[s] > max) max = apagamentos[s];
+    }
+    printf("  desgaste: %u a %u apagamentos por setor em 10 voltas\n", min, max);
+
+    // Pico: tempo com a flash ocupada (interrupções desligadas) por hora de leituras
+    double leituras_h = 3600.0 / INTERVALO_S;
+    double paginas_h = leituras_h / FLASH_LOG_REGISTROS_POR_PAGINA;
+    double setores_h = paginas_h / FLASH_LOG_PAGINAS_POR_SETOR;
+    printf("  no Pico, por hora: %.0f páginas (%.1f ms cada) e %.1f setores (%.0f ms cada): %.2f s ocupada"
+           " (%.3f%%)\n", paginas_h, FLASH_PROGRAMAR_PAGINA_MS, setores_h, FLASH_APAGAR_SETOR_MS,
+           (paginas_h * FLASH_PROGRAMAR_PAGINA_MS + setores_h * FLASH_APAGAR_SETOR_MS) / 1000,
+           (paginas_h * FLASH_PROGRAMAR_PAGINA_MS + setores_h * FLASH_APAGAR_SETOR_MS) / 36000);
+    printf("  retenção: %.1f h de leituras a cada %d s\n",
+           (double)(n_setores - 1) * FLASH_LOG_PAGINAS_POR_SETOR * FLASH_LOG_REGISTROS_POR_PAGINA *
+           INTERVALO_S / 3600, INTERVALO_S);
+
+    // Consultas: a última hora (índice esparso) contra o log inteiro
+    uint32_t fim = flash_log_agora(uptime);
+    FLASH_LOG_CURSOR c;
+    FLASH_LOG_REGISTRO r;
+    long n_hora = 0, n_tudo = 0;
+    t0 = agora_s();
+    for (int k = 0; k < 100; k++) {
+        flash_log_buscar(&c, fim - 3600, fim);
+        while (flash_log_ler(&c, &r)) {
+            n_hora++;
+            flash_log_avancar(&c);
+        }
+    }
+    double t_hora = (agora_s() - t0) / 100;
+    t0 = agora_s();
+    for (int k = 0; k < 10; k++) {
+        flash_log_buscar(&c, 0, UINT32_MAX);
+        while (flash_log_ler(&c, &r)) {
+            n_tudo++;
+            flash_log_avancar(&c);
+        }
+    }
+    double t_tudo = (agora_s() - t0) / 10;
+    printf("  consulta da última hora: %ld registros em %.1f us; log inteiro: %ld registros em %.1f us\n",
+           n_hora / 100, t_hora * 1e6, n_tudo / 10, t_tudo * 1e6);
+
+    t0 = agora_s();
+    flash_log_iniciar(&ops, 0);
+    printf("  recuperação (varredura da região no boot): %.1f ms no host\n", (agora_s() - t0) * 1e3);
+    // A última hora inteira, a menos que a região guarde menos que isso
+    long esperado = (long)(n_setores - 1) * FLASH_LOG_PAGINAS_POR_SETOR * FLASH_LOG_REGISTROS_POR_PAGINA;
+    if (esperado > 3600 / INTERVALO_S) {
+        esperado = 3600 / INTERVALO_S;
+    }
+    return n_hora / 100 >= esperado - FLASH_LOG_REGISTROS_POR_PAGINA;
+}
+
+int main(int argc, char **argv) {
+    uint32_t kb = 1024;
+    int quedas = 500;
+    unsigned semente = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:q:s:")) != -1) {
+        switch (opt) {
+            case 't': kb = (uint32_t)atoi(optarg); break;
+            case 'q': quedas = atoi(optarg); break;
+            case 's': semente = (unsigned)atoi(optarg); break;
+            default:
+                fprintf(stderr, "uso: %s [-t KB] [-q quedas] [-s semente]\n", argv[0]);
+                return 2;
+        }
+    }
+    flash_tamanho = kb * 1024 / FLASH_LOG_SETOR * FLASH_LOG_SETOR;
+    if (flash_tamanho < 2 * FLASH_LOG_SETOR || flash_tamanho / FLASH_LOG_SETOR > FLASH_LOG_SETORES_MAX) {
+        fprintf(stderr, "região deve ter de %d a %d KB\n", 2 * FLASH_LOG_SETOR / 1024,
+                FLASH_LOG_SETORES_MAX * FLASH_LOG_SETOR / 1024);
+        return 2;
+    }
+    srand(semente);
+    flash = aligned_alloc(FLASH_LOG_SETOR, flash_tamanho);
+    apagamentos = calloc(flash_tamanho / FLASH_LOG_SETOR, sizeof(*apagamentos));
+    ops.base = flash;
+    ops.tamanho = flash_tamanho;
+
+    bool ok = etapa_formato() && etapa_quedas(quedas) && etapa_desempenho();
+    printf(ok ? "OK\n" : "FALHOU\n");
+    free(modelo.r);
+    free(apagamentos);
+    free(flash);
+    return ok ? 0 : 1;
+}
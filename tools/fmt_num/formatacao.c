@@ -0,0 +1,319 @@
+// Ficheiro: formatacao.c
+// Testes e medição da formatação de números sem printf (lib/fmt_num.c).
+//
+//   formatacao [-n <repetições do benchmark>] [-a <valores aleatórios>]
+//
+// 1. faixa do firmware: fmt_fixo com 0, 1 e 2 casas (as usadas no JSON, em /metrics e no
+//    display) precisa sair igual a snprintf("%.*f") para floats espalhados por todos os
+//    expoentes entre -16384 e 16384, que cobrem leituras, offsets, QNH e limites;
+// 2. empates: os valores exatamente no meio de duas saídas, (2k+1) / 2^(casas+1), e os
+//    floats vizinhos, de 0 a FMT_CASAS_MAX casas. O printf arredonda para o par;
+// 3. especiais: zero negativo, negativos que arredondam para zero ("-0.00"), subnormais,
+//    nan, inf e os maiores floats, que saturam (ver fmt_num.h);
+// 4. aleatórios: padrões de bits quaisquer com 0 a FMT_CASAS_MAX casas, até 2^63;
+// 5. inteiros: fmt_int e fmt_uint contra "%ld" e "%lu", extremos incluídos;
+// 6. benchmark: fmt_fixo contra o snprintf("%.2f") usado antes, sobre leituras da faixa
+//    dos sensores. No host em ns por chamada; compilado para o Pico (PLACA=ON no CMake)
+//    em ciclos do M0+, contados pelo SysTick, com o resultado na serial USB. Na placa só
+//    o benchmark roda: o printf do SDK não serve de referência para os dígitos.
+//
+// Sai com código 1 se alguma saída divergir.
+
+#if !PICO_ON_DEVICE
+#define _POSIX_C_SOURCE 200809L    // clock_gettime, getopt
+#endif
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fmt_num.h"
+
+#if PICO_ON_DEVICE
+#include "pico/stdlib.h"
+#include "hardware/structs/systick.h"
+#include "hardware/regs/m0plus.h"
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// Floats com módulo a partir daqui saturam em fmt_fixo e divergem do printf de propósito
+#define FORMATACAO_SATURA   9223372036854775808.0f     // 2^63
+
+static float float_de_bits(uint32_t u) {
+    union { uint32_t u; float f; } bits = { .u = u };
+    return bits.f;
+}
+
+#if !PICO_ON_DEVICE
+
+// =================================================================================
+// CORREÇÃO (só no host, contra o printf da glibc)
+// =================================================================================
+
+static uint64_t comparados, divergentes;
+
+static void conferir_fixo(float v, uint8_t casas) {
+    char esperado[400], obtido[FMT_NUM_MAX + 8];
+    snprintf(esperado, sizeof(esperado), "%.*f", casas, (double)v);
+    char *fim = fmt_fixo(obtido, v, casas);
+    comparados++;
+    if (strcmp(esperado, obtido) != 0 || fim != obtido + strlen(obtido)) {
+        if (divergentes++ < 10) {
+            printf("  divergência: %a com %u casas: printf \"%s\", fmt_fixo \"%s\"\n",
+                   (double)v, casas, esperado, obtido);
+        }
+    }
+}
+
+static bool etapa_resultado(const char *nome, uint64_t antes_comparados, uint64_t antes_divergentes) {
+    uint64_t n = comparados - antes_comparados, d = divergentes - antes_divergentes;
+    printf("%s: %llu valores, %llu divergências\n", nome, (unsigned long long)n, (unsigned long long)d);
+    return d == 0;
+}
+
+static bool etapa_faixa(void) {
+    uint64_t c0 = comparados, d0 = divergentes;
+    // Passo primo nos bits: percorre todos os expoentes até 2^14 com mantissas variadas
+    const uint32_t limite = 0x46800000u;    // 16384.0f
+    for (uint32_t u = 0; u <= limite; u += 1021) {
+        for (uint8_t casas = 0; casas <= 2; casas++) {
+            conferir_fixo(float_de_bits(u), casas);
+            conferir_fixo(float_de_bits(u | 0x80000000u), casas);
+        }
+    }
+    return etapa_resultado("faixa do firmware (0 a 2 casas, |v| < 16384)", c0, d0);
+}
+
+static bool etapa_empates(void) {
+    uint64_t c0 = comparados, d0 = divergentes;
+    for (uint8_t casas = 0; casas <= FMT_CASAS_MAX; casas++) {
+        // (2k+1) / 2^(casas+1) vezes 10^casas termina em ,5: é o empate exato
+        for (uint32_t k = 0; k < 200000; k++) {
+            float v = ldexpf((float)(2 * k + 1), -(int)(casas + 1));
+            conferir_fixo(v, casas);
+            conferir_fixo(-v, casas);
+            conferir_fixo(nextafterf(v, 0.0f), casas);
+            conferir_fixo(nextafterf(v, INFINITY), casas);
+        }
+    }
+    return etapa_resultado("empates e vizinhos (0 a 6 casas)", c0, d0);
+}
+
+static bool etapa_especiais(void) {
+    uint64_t c0 = comparados, d0 = divergentes;
+    const float especiais[] = {
+        0.0f, -0.0f, -0.001f, -0.004f, -0.005f, -0.0049999f, -0.4f, -0.5f, 0.5f, 1.5f, 2.5f,
+        0.125f, 0.375f, -0.125f, 1e-45f, -1e-45f, 1.17549435e-38f, 0.1f, 0.01f, 0.005f,
+        99.995f, 1013.25f, 1100.0f, -40.0f, 85.0f, 1000.0f, -1000.0f, 4294967295.0f,
+        4294967296.0f, 1e18f, 9.2233715e18f, -9.2233715e18f,
+    };
+    for (size_t i = 0; i < sizeof(especiais) / sizeof(especiais[0]); i++) {
+        for (uint8_t casas = 0; casas <= FMT_CASAS_MAX; casas++) {
+            conferir_fixo(especiais[i], casas);
+        }
+    }
+    bool ok = etapa_resultado("especiais", c0, d0);
+
+    // Fora da comparação: a glibc escreve "-nan" e os 39 dígitos de FLT_MAX
+    char obtido[FMT_NUM_MAX];
+    struct { float v; const char *esperado; } fixos[] = {
+        { NAN, "nan" }, { -NAN, "-nan" }, { INFINITY, "inf" }, { -INFINITY, "-inf" },
+        { float_de_bits(0x7F7FFFFFu), "9223372036854775807.00" },
+        { float_de_bits(0xFF7FFFFFu), "-9223372036854775807.00" },
+    };
+    for (size_t i = 0; i < sizeof(fixos) / sizeof(fixos[0]); i++) {
+        fmt_fixo(obtido, fixos[i].v, 2);
+        if (strcmp(obtido, fixos[i].esperado) != 0) {
+            printf("  %s saiu como \"%s\"\n", fixos[i].esperado, obtido);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// xorshift32: a mesma sequência em toda execução
+static uint32_t sorteio_estado = 2463534242u;
+
+static uint32_t sortear(void) {
+    sorteio_estado ^= sorteio_estado << 13;
+    sorteio_estado ^= sorteio_estado >> 17;
+    sorteio_estado ^= sorteio_estado << 5;
+    return sorteio_estado;
+}
+
+static bool etapa_aleatorios(uint32_t n) {
+    uint64_t c0 = comparados, d0 = divergentes;
+    for (uint32_t i = 0; i < n; i++) {
+        float v = float_de_bits(sortear());
+        if (isnan(v) || isinf(v) || fabsf(v) >= FORMATACAO_SATURA) {
+            continue;
+        }
+        conferir_fixo(v, (uint8_t)(sortear() % (FMT_CASAS_MAX + 1)));
+    }
+    return etapa_resultado("aleatórios (até 2^63, 0 a 6 casas)", c0, d0);
+}
+
+static bool etapa_inteiros(void) {
+    uint64_t n = 0, d = 0;
+    char esperado[24], obtido[FMT_NUM_MAX];
+    const uint32_t extremos[] = { 0, 1, 9, 10, 99, 100, 999999999u, 1000000000u,
+                                  2147483647u, 2147483648u, 4294967295u };
+    for (uint32_t i = 0; i < 2000000; i++) {
+        uint32_t u = i < 11 ? extremos[i] : sortear() >> (sortear() % 32);
+        snprintf(esperado, sizeof(esperado), "%lu", (unsigned long)u);
+        fmt_uint(obtido, u);
+        d += strcmp(esperado, obtido) != 0;
+        snprintf(esperado, sizeof(esperado), "%ld", (long)(int32_t)u);
+        fmt_int(obtido, (int32_t)u);
+        d += strcmp(esperado, obtido) != 0;
+        n += 2;
+    }
+    printf("inteiros: %llu valores, %llu divergências\n", (unsigned long long)n, (unsigned long long)d);
+    return d == 0;
+}
+
+#endif
+
+// =================================================================================
+// BENCHMARK
+// =================================================================================
+
+#define BENCH_VALORES 1024
+
+static volatile uint32_t sorvedouro;    // Impede que o compilador descarte as chamadas
+static float valores[BENCH_VALORES];
+
+#if PICO_ON_DEVICE
+static inline uint32_t contador(void) {
+    return systick_hw->cvr;
+}
+
+// SysTick decrementa a cada ciclo, com 24 bits: as medições são por chamada
+static inline uint32_t decorrido(uint32_t antes, uint32_t depois) {
+    return (antes - depois) & 0x00FFFFFFu;
+}
+#define UNIDADE "ciclos"
+#else
+static inline uint32_t contador(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint32_t)((uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec);
+}
+
+static inline uint32_t decorrido(uint32_t antes, uint32_t depois) {
+    return depois - antes;
+}
+#define UNIDADE "ns"
+#endif
+
+enum { BENCH_SNPRINTF, BENCH_FMT_FIXO, N_BENCH };
+static const char *const BENCH_NOMES[N_BENCH] = {
+    "snprintf(\"%.2f\") (caminho anterior)",
+    "fmt_fixo, 2 casas",
+};
+
+// Temperatura, umidade, pressão e altitude, como no JSON de /dados_sensores
+static void valores_gerar(void) {
+    for (int i = 0; i < BENCH_VALORES; i++) {
+        float t = (float)i / BENCH_VALORES;
+        switch (i % 4) {
+            case 0: valores[i] = -40.0f + 125.0f * t; break;
+            case 1: valores[i] = 100.0f * t; break;
+            case 2: valores[i] = 300.0f + 800.0f * t; break;
+            default: valores[i] = -500.0f + 9500.0f * t; break;
+        }
+    }
+}
+
+static void bench_chamada(int variante, float v) {
+    char buf[FMT_NUM_MAX];
+    if (variante == BENCH_SNPRINTF) {
+        sorvedouro += (uint32_t)snprintf(buf, sizeof(buf), "%.2f", (double)v);
+    } else {
+        sorvedouro += (uint32_t)(fmt_fixo(buf, v, 2) - buf);
+    }
+}
+
+#if PICO_ON_DEVICE
+// Ciclos por chamada, descontado o custo de ler o SysTick; média e mínimo
+static void etapa_benchmark(uint32_t repeticoes) {
+    uint32_t vazio = 0xFFFFFFFFu;
+    for (int i = 0; i < 64; i++) {
+        uint32_t a = contador();
+        uint32_t d = decorrido(a, contador());
+        if (d < vazio) vazio = d;
+    }
+    for (int variante = 0; variante < N_BENCH; variante++) {
+        uint64_t soma = 0;
+        uint32_t minimo = 0xFFFFFFFFu;
+        for (uint32_t r = 0; r < repeticoes; r++) {
+            float v = valores[(r * 7919u) % BENCH_VALORES];
+            uint32_t a = contador();
+            bench_chamada(variante, v);
+            uint32_t d = decorrido(a, contador()) - vazio;
+            soma += d;
+            if (d < minimo) minimo = d;
+        }
+        printf("  %-40s %8lu %s/chamada (mínimo %lu)\n", BENCH_NOMES[variante],
+               (unsigned long)(soma / repeticoes), UNIDADE, (unsigned long)minimo);
+    }
+}
+#else
+// No host uma chamada fica abaixo da resolução do relógio: mede o laço inteiro
+static void etapa_benchmark(uint32_t repeticoes) {
+    for (int variante = 0; variante < N_BENCH; variante++) {
+        uint32_t a = contador();
+        for (uint32_t r = 0; r < repeticoes; r++) {
+            bench_chamada(variante, valores[(r * 7919u) % BENCH_VALORES]);
+        }
+        uint32_t d = decorrido(a, contador());
+        printf("  %-40s %8.1f %s/chamada\n", BENCH_NOMES[variante], (double)d / repeticoes, UNIDADE);
+    }
+}
+#endif
+
+int main(int argc, char **argv) {
+    uint32_t repeticoes = 1000000;
+    bool ok = true;
+    valores_gerar();
+#if PICO_ON_DEVICE
+    (void)argc;
+    (void)argv;
+    stdio_init_all();
+    sleep_ms(3000);     // Tempo para o terminal abrir a serial USB
+    systick_hw->rvr = 0x00FFFFFFu;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+    repeticoes = 2000;
+#else
+    uint32_t aleatorios = 4000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:a:")) != -1) {
+        switch (opt) {
+            case 'n': repeticoes = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'a': aleatorios = (uint32_t)strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "uso: %s [-n repetições] [-a valores aleatórios]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (repeticoes == 0) repeticoes = 1;
+
+    ok = etapa_faixa();
+    ok = etapa_empates() && ok;
+    ok = etapa_especiais() && ok;
+    ok = etapa_aleatorios(aleatorios) && ok;
+    ok = etapa_inteiros() && ok;
+#endif
+    printf("benchmark (%lu chamadas):\n", (unsigned long)repeticoes);
+    etapa_benchmark(repeticoes);
+    printf(ok ? "OK\n" : "FALHOU\n");
+
+#if PICO_ON_DEVICE
+    while (true) tight_loop_contents();
+#endif
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// Ficheiro: latencia_rtt.c
+// Mede o tempo de ida e volta de requisições HTTP à placa, numa conexão keep-alive, e
+// imprime a distribuição (percentis e histograma). Entre as requisições há uma pausa
+// aleatória, para que os instantes de envio não fiquem sincronizados com nenhum período
+// do firmware (por exemplo um laço de polling da rede).
+//
+// Compilação:  cc -O2 -o latencia_rtt latencia_rtt.c
+// Uso:         ./latencia_rtt <ip-da-placa> [requisicoes] [caminho]
+//              ./latencia_rtt 192.168.0.50 500 /dados.bin
+
+#define _GNU_SOURCE     // strcasestr
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#define RTT_REQUISICOES_PADRAO  300
+#define RTT_CAMINHO_PADRAO      "/dados.bin"    // Resposta pequena, com Content-Length
+#define RTT_PAUSA_MAX_MS        100
+#define RTT_FAIXA_MS            5               // Largura de cada faixa do histograma
+#define RTT_FAIXAS              16              // A última faixa acumula o que passar dela
+
+static double agora_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static int conectar(const char *ip) {
+    struct sockaddr_in end = { .sin_family = AF_INET, .sin_port = htons(80) };
+    if (inet_pton(AF_INET, ip, &end.sin_addr) != 1) {
+        fprintf(stderr, "Endereco invalido: %s\n", ip);
+        return -1;
+    }
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    int um = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+    if (connect(s, (struct sockaddr *)&end, sizeof(end)) != 0) {
+        perror("connect");
+        close(s);
+        return -1;
+    }
+    return s;
+}
+
+/**
+ * @brief Lê uma resposta inteira (cabeçalho + Content-Length bytes).
+ * @return 0 se ok, -1 em erro ou se o servidor fechou a conexão.
+ */
+static int ler_resposta(int s, int *fechar) {
+    char buf[4096];
+    size_t n = 0;
+    char *fim_cab = NULL;
+    while (!fim_cab) {
+        if (n == sizeof(buf) - 1) {
+            return -1;
+        }
+        ssize_t r = recv(s, buf + n, sizeof(buf) - 1 - n, 0);
+        if (r <= 0) {
+            return -1;
+        }
+        n += (size_t)r;
+        buf[n] = '\0';
+        fim_cab = strstr(buf, "\r\n\r\n");
+    }
+
+    const char *cl = strcasestr(buf, "\r\nContent-Length:");
+    if (!cl || cl > fim_cab) {
+        fprintf(stderr, "Resposta sem Content-Length\n");
+        return -1;
+    }
+    long corpo = strtol(cl + 17, NULL, 10);
+    const char *conn = strcasestr(buf, "\r\nConnection: close");
+    *fechar = conn && conn < fim_cab;
+
+    long faltam = corpo - (long)(n - (size_t)(fim_cab + 4 - buf));
+    while (faltam > 0) {
+        ssize_t r = recv(s, buf, faltam < (long)sizeof(buf) ? (size_t)faltam : sizeof(buf), 0);
+        if (r <= 0) {
+            return -1;
+        }
+        faltam -= r;
+    }
+    return 0;
+}
+
+static int comparar(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentil(const double *v, int n, double p) {
+    int i = (int)(p / 100.0 * (n - 1) + 0.5);
+    return v[i];
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Uso: %s <ip-da-placa> [requisicoes] [caminho]\n", argv[0]);
+        return 1;
+    }
+    const char *ip = argv[1];
+    int total = argc > 2 ? atoi(argv[2]) : RTT_REQUISICOES_PADRAO;
+    const char *caminho = argc > 3 ? argv[3] : RTT_CAMINHO_PADRAO;
+    if (total <= 0) {
+        return 1;
+    }
+
+    char req[256];
+    int req_len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n", caminho, ip);
+    double *rtt = malloc(sizeof(double) * total);
+    int s = conectar(ip);
+    if (s < 0) {
+        return 1;
+    }
+
+    srand((unsigned)time(NULL));
+    int feitas = 0, falhas = 0;
+    while (feitas < total) {
+        usleep((useconds_t)(rand() % (RTT_PAUSA_MAX_MS * 1000)));
+        int fechar = 0;
+        double t0 = agora_ms();
+        if (send(s, req, (size_t)req_len, 0) != req_len || ler_resposta(s, &fechar) != 0) {
+            // O servidor encerra a conexão após um número de respostas; reconecta
+            falhas++;
+            fechar = 1;
+        } else {
+            rtt[feitas++] = agora_ms() - t0;
+        }
+        if (fechar) {
+            close(s);
+            if ((s = conectar(ip)) < 0) {
+                break;
+            }
+        }
+    }
+    if (s >= 0) {
+        close(s);
+    }
+    if (feitas == 0) {
+        fprintf(stderr, "Nenhuma resposta\n");
+        return 1;
+    }
+
+    qsort(rtt, (size_t)feitas, sizeof(double), comparar);
+    double soma = 0;
+    for (int i = 0; i < feitas; i++) {
+        soma += rtt[i];
+    }
+    printf("GET %s: %d respostas, %d falhas\n", caminho, feitas, falhas);
+    printf("rtt ms: min %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f  media %.2f\n",
+           rtt[0], percentil(rtt, feitas, 50), percentil(rtt, feitas, 90),
+           percentil(rtt, feitas, 99), rtt[feitas - 1], soma / feitas);
+
+    int faixas[RTT_FAIXAS] = { 0 };
+    for (int i = 0; i < feitas; i++) {
+        int f = (int)(rtt[i] / RTT_FAIXA_MS);
+        faixas[f < RTT_FAIXAS ? f : RTT_FAIXAS - 1]++;
+    }
+    for (int f = 0; f < RTT_FAIXAS; f++) {
+        int barra = faixas[f] * 60 / feitas;
+        if (f < RTT_FAIXAS - 1) {
+            printf("%3d-%-3d ms %5d ", f * RTT_FAIXA_MS, (f + 1) * RTT_FAIXA_MS, faixas[f]);
+        } else {
+            printf("%3d+    ms %5d ", f * RTT_FAIXA_MS, faixas[f]);
+        }
+        for (int i = 0; i < barra; i++) {
+            putchar('#');
+        }
+        putchar('\n');
+    }
+    free(rtt);
+    return 0;
+}
@@ -0,0 +1,123 @@
+// Ficheiro: quadros.c
+// Testes da leitura de quadros do cliente (ws_quadro_ler, lib/websocket.c) no host, com
+// quadros válidos, incompletos e hostis: sem máscara, com bits RSV, controle longo ou
+// fragmentado e tamanhos de 64 bits que não caberiam no buffer ou que dariam a volta
+// numa soma. Também o código devolvido a cada quadro de fechamento
+// (ws_codigo_fechamento): o recebido, 1000 sem código ou 1002 se reservado ou inválido.
+//
+//   quadros
+//
+// Sai com código 1 se algum caso falhar.
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "websocket.h"
+
+// Capacidade do buffer de recepção nos casos (a de um assinante no firmware é parecida)
+#define QUADROS_CAP 256
+
+typedef struct {
+    const char *nome;
+    uint8_t bytes[24];
+    size_t len;
+    int esperado;               // Retorno de ws_quadro_ler
+    const char *payload;        // Payload esperado sem a máscara, quando esperado > 0
+} CASO;
+
+static const CASO CASOS[] = {
+    // RFC 6455, seção 5.7: "Hello" mascarado
+    { "texto mascarado", { 0x81, 0x85, 0x37, 0xFA, 0x21, 0x3D, 0x7F, 0x9F, 0x4D, 0x51, 0x58 },
+      11, 11, "Hello" },
+    { "cabeçalho incompleto", { 0x81 }, 1, 0, NULL },
+    { "payload incompleto", { 0x81, 0x85, 0x37, 0xFA, 0x21, 0x3D, 0x7F, 0x9F }, 8, 0, NULL },
+    { "tamanho de 64 bits incompleto", { 0x82, 0xFF, 0x00, 0x00, 0x00 }, 5, 0, NULL },
+    { "sem máscara", { 0x81, 0x05, 'H', 'e', 'l', 'l', 'o' }, 7, WS_QUADRO_INVALIDO, NULL },
+    { "RSV1 sem extensão", { 0xC1, 0x85, 0x37, 0xFA, 0x21, 0x3D, 0x7F, 0x9F, 0x4D, 0x51, 0x58 },
+      11, WS_QUADRO_INVALIDO, NULL },
+    { "RSV2 sem extensão", { 0xA1, 0x85, 0x37, 0xFA, 0x21, 0x3D, 0x7F, 0x9F, 0x4D, 0x51, 0x58 },
+      11, WS_QUADRO_INVALIDO, NULL },
+    { "RSV3 em quadro de controle", { 0x99, 0x80, 1, 2, 3, 4 }, 6, WS_QUADRO_INVALIDO, NULL },
+    { "ping com 126 bytes", { 0x89, 0xFE, 0x00, 0x7E, 1, 2, 3, 4 }, 8, WS_QUADRO_INVALIDO, NULL },
+    { "ping fragmentado", { 0x09, 0x80, 1, 2, 3, 4 }, 6, WS_QUADRO_INVALIDO, NULL },
+    // Tamanho 2^64 - 1: somado ao cabeçalho daria a volta para um valor pequeno
+    { "tamanho 2^64 - 1", { 0x82, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 1, 2, 3, 4 },
+      14, WS_QUADRO_INVALIDO, NULL },
+    { "tamanho com o bit 63 em 1", { 0x82, 0xFF, 0x80, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4 },
+      14, WS_QUADRO_INVALIDO, NULL },
+    { "tamanho 2^63 - 1", { 0x82, 0xFF, 0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 1, 2, 3, 4 },
+      14, WS_QUADRO_GRANDE, NULL },
+    { "um byte além do buffer", { 0x82, 0xFE, 0x00, QUADROS_CAP - 8 + 1, 1, 2, 3, 4 },
+      8, WS_QUADRO_GRANDE, NULL },
+    { "exatamente o buffer (incompleto)", { 0x82, 0xFE, 0x00, QUADROS_CAP - 8, 1, 2, 3, 4 },
+      8, 0, NULL },
+};
+#define N_CASOS (sizeof(CASOS) / sizeof(CASOS[0]))
+
+typedef struct {
+    uint8_t payload[2];
+    size_t len;
+    uint16_t esperado;          // Retorno de ws_codigo_fechamento
+} CASO_FECHAMENTO;
+
+static const CASO_FECHAMENTO CASOS_FECHAMENTO[] = {
+    { { 0 }, 0, WS_FECHA_NORMAL },
+    { { 0x03 }, 1, WS_FECHA_PROTOCOLO },
+    { { 0x03, 0xE8 }, 2, 1000 },
+    { { 0x03, 0xEB }, 2, 1003 },
+    { { 0x03, 0xEC }, 2, WS_FECHA_PROTOCOLO },     // 1004, reservado
+    { { 0x03, 0xED }, 2, WS_FECHA_PROTOCOLO },     // 1005, só local
+    { { 0x03, 0xEE }, 2, WS_FECHA_PROTOCOLO },     // 1006, só local
+    { { 0x03, 0xEF }, 2, 1007 },
+    { { 0x03, 0xF6 }, 2, 1014 },
+    { { 0x03, 0xF7 }, 2, WS_FECHA_PROTOCOLO },     // 1015, só local
+    { { 0x00, 0x00 }, 2, WS_FECHA_PROTOCOLO },
+    { { 0x03, 0xE7 }, 2, WS_FECHA_PROTOCOLO },     // 999
+    { { 0x07, 0xD0 }, 2, WS_FECHA_PROTOCOLO },     // 2000
+    { { 0x0B, 0xB8 }, 2, 3000 },
+    { { 0x13, 0x87 }, 2, 4999 },
+    { { 0x13, 0x88 }, 2, WS_FECHA_PROTOCOLO },     // 5000
+    { { 0xFF, 0xFF }, 2, WS_FECHA_PROTOCOLO },
+};
+#define N_CASOS_FECHAMENTO (sizeof(CASOS_FECHAMENTO) / sizeof(CASOS_FECHAMENTO[0]))
+
+int main(void) {
+    int falhas = 0;
+    for (size_t i = 0; i < N_CASOS; i++) {
+        const CASO *c = &CASOS[i];
+        // O quadro vai no início de um buffer do tamanho declarado; o restante é uma
+        // guarda que não pode ser alterada
+        uint8_t buf[QUADROS_CAP + 16];
+        memset(buf, 0xA5, sizeof(buf));
+        memcpy(buf, c->bytes, c->len);
+        WS_QUADRO quadro = { 0 };
+        int r = ws_quadro_ler(buf, c->len, QUADROS_CAP, &quadro);
+
+        bool ok = r == c->esperado;
+        if (ok && r > 0) {
+            ok = quadro.payload_len == strlen(c->payload) &&
+                 memcmp(quadro.payload, c->payload, quadro.payload_len) == 0;
+        }
+        for (size_t j = r > 0 ? (size_t)r : c->len; j < sizeof(buf); j++) {
+            if (buf[j] != 0xA5) ok = false;
+        }
+        printf("  %-36s %4d (esperado %4d) %s\n", c->nome, r, c->esperado, ok ? "ok" : "FALHOU");
+        if (!ok) falhas++;
+    }
+
+    for (size_t i = 0; i < N_CASOS_FECHAMENTO; i++) {
+        const CASO_FECHAMENTO *c = &CASOS_FECHAMENTO[i];
+        uint8_t payload[2];
+        memcpy(payload, c->payload, sizeof(payload));
+        WS_QUADRO quadro = { true, WS_OP_FECHAR, payload, c->len };
+        uint16_t codigo = ws_codigo_fechamento(&quadro);
+        bool ok = codigo == c->esperado;
+        char nome[40];
+        snprintf(nome, sizeof(nome), "fechamento, %zu byte(s): %02X %02X", c->len,
+                 c->len > 0 ? c->payload[0] : 0, c->len > 1 ? c->payload[1] : 0);
+        printf("  %-36s %4u (esperado %4u) %s\n", nome, codigo, c->esperado, ok ? "ok" : "FALHOU");
+        if (!ok) falhas++;
+    }
+    printf(falhas ? "FALHOU (%d casos)\n" : "OK\n", falhas);
+    return falhas ? 1 : 0;
+}
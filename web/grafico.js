@@ -0,0 +1,40 @@
+// Gráfico de linha em <canvas>, no lugar do Chart.js. Implementa só o que a página usa,
+// com a mesma forma de dados: g.data.labels, g.data.datasets[0].data e g.update().
+// Servido em /grafico.js (gzip, em flash) com cache longo; a URL leva a versão do arquivo.
+function Grafico(canvas,rotulo,cor){
+const g=this,ctx=canvas.getContext('2d');
+g.data={labels:[],datasets:[{label:rotulo,data:[]}]};
+function desenhar(){
+const r=window.devicePixelRatio||1,larg=canvas.parentNode.clientWidth||300,alt=Math.round(larg/2);
+if(canvas.width!==Math.round(larg*r)){canvas.width=Math.round(larg*r);canvas.height=Math.round(alt*r);
+canvas.style.width=larg+'px';canvas.style.height=alt+'px'}
+ctx.setTransform(r,0,0,r,0,0);ctx.clearRect(0,0,larg,alt);
+ctx.font='12px sans-serif';ctx.textBaseline='middle';
+// Legenda
+ctx.fillStyle=cor;ctx.fillRect(larg/2-60,8,24,10);ctx.fillStyle='#555';ctx.textAlign='left';ctx.fillText(rotulo,larg/2-30,13);
+const d=g.data.datasets[0].data,rot=g.data.labels,n=d.length;
+let min=Infinity,max=-Infinity;
+for(const v of d){if(v<min)min=v;if(v>max)max=v}
+if(!n){min=0;max=1}
+if(min===max){min-=1;max+=1}
+const folga=(max-min)*0.05;min-=folga;max+=folga;
+const esq=50,topo=26,dir=larg-10,base=alt-22,w=dir-esq,h=base-topo;
+const y=v=>base-(v-min)/(max-min)*h,x=i=>esq+(n>1?i*w/(n-1):w/2);
+// Eixo Y: 5 divisões com linhas de grade
+ctx.strokeStyle='#e5e5e5';ctx.lineWidth=1;ctx.textAlign='right';ctx.fillStyle='#666';
+const casas=max-min<5?2:max-min<50?1:0;
+for(let k=0;k<=4;k++){const v=min+(max-min)*k/4,py=Math.round(y(v))+0.5;
+ctx.beginPath();ctx.moveTo(esq,py);ctx.lineTo(dir,py);ctx.stroke();ctx.fillText(v.toFixed(casas),esq-6,py)}
+// Eixo X: primeiro, meio e último rótulo
+ctx.textAlign='center';ctx.textBaseline='top';
+if(n)[0,n>>1,n-1].forEach(i=>{if(rot[i]!==undefined)ctx.fillText(rot[i],x(i),base+6)});
+if(!n)return;
+// Área e linha da série
+ctx.beginPath();ctx.moveTo(x(0),y(d[0]));
+for(let i=1;i<n;i++)ctx.lineTo(x(i),y(d[i]));
+ctx.strokeStyle=cor;ctx.lineWidth=2;ctx.lineJoin='round';ctx.stroke();
+ctx.lineTo(x(n-1),base);ctx.lineTo(x(0),base);ctx.closePath();
+ctx.globalAlpha=0.2;ctx.fillStyle=cor;ctx.fill();ctx.globalAlpha=1}
+g.update=desenhar;
+window.addEventListener('resize',()=>{canvas.width=0;desenhar()});
+desenhar()}